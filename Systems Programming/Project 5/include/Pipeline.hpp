@@ -3,6 +3,8 @@
 #include <cstdint>
 #include <string>
 
+class CheckpointFile;
+
 class Pipeline {
 public:
     enum Stage {
@@ -17,16 +19,20 @@ public:
         // IF/ID
         uint32_t if_id_pc;
         uint32_t if_id_instruction;
+        uint32_t if_id_predicted_pc;
         bool if_id_valid;
         
         // ID/EX
         uint32_t id_ex_pc;
+        uint32_t id_ex_instruction;
+        uint32_t id_ex_predicted_pc;
         uint32_t id_ex_rs_data;
         uint32_t id_ex_rt_data;
         uint32_t id_ex_immediate;
         uint8_t id_ex_rs;
         uint8_t id_ex_rt;
         uint8_t id_ex_rd;
+        uint8_t id_ex_dest;
         uint8_t id_ex_opcode;
         uint8_t id_ex_funct;
         bool id_ex_reg_write;
@@ -38,6 +44,8 @@ public:
         
         // EX/MEM
         uint32_t ex_mem_pc;
+        uint32_t ex_mem_instruction;
+        uint32_t ex_mem_predicted_pc;
         uint32_t ex_mem_alu_result;
         uint32_t ex_mem_rt_data;
         uint8_t ex_mem_rd;
@@ -48,12 +56,19 @@ public:
         bool ex_mem_valid;
         
         // MEM/WB
+        uint32_t mem_wb_pc;
+        uint32_t mem_wb_instruction;
         uint32_t mem_wb_alu_result;
         uint32_t mem_wb_mem_data;
         uint8_t mem_wb_rd;
         bool mem_wb_reg_write;
         bool mem_wb_mem_to_reg;
         bool mem_wb_valid;
+        
+        // Instruction leaving WB this cycle
+        uint32_t wb_pc;
+        uint32_t wb_instruction;
+        bool wb_valid;
     };
     
     Pipeline();
@@ -63,6 +78,8 @@ public:
     void advance();
     bool detectDataHazard() const;
     bool detectControlHazard() const;
+    bool detectLoadUseHazard() const;
+    void requestStall(Stage stage);
     void insertStall();
     void flush();
     
@@ -70,6 +87,11 @@ public:
     const PipelineRegister& getRegisters() const;
     std::string getStateString() const;
     
+    // Latch contents for checkpoints; pending stalls and flushes are not kept.
+    // loadState() fails if a flag or register number is out of range
+    void saveState(CheckpointFile& file) const;
+    bool loadState(CheckpointFile& file);
+    
 private:
     PipelineRegister registers;
     std::vector<bool> stall_stages;
@@ -17,16 +17,57 @@ public:
         SRA = 10
     };
     
+    // Lazy flags: the result keeps its operands and operation, and the
+    // condition flags are derived only when one is asked for
     struct Result {
         uint32_t value;
-        bool zero;
-        bool overflow;
-        bool carry;
+        uint32_t operand1;
+        uint32_t operand2;
+        Operation op;
+        
+        bool zero() const { return value == 0; }
+        bool overflow() const;
+        bool carry() const;
     };
     
+    // Value-only fast path for the execution engines
+    static uint32_t compute(uint32_t operand1, uint32_t operand2, Operation op);
+    static uint32_t compute(uint32_t operand1, uint32_t operand2, uint8_t shamt, Operation op);
+    
     static Result execute(uint32_t operand1, uint32_t operand2, Operation op);
     static Result execute(uint32_t operand1, uint32_t operand2, uint8_t shamt, Operation op);
     
 private:
     static bool detectOverflow(uint32_t a, uint32_t b, uint32_t result, bool is_sub);
 };
+
+inline uint32_t ALU::compute(uint32_t operand1, uint32_t operand2, Operation op) {
+    switch (op) {
+        case ADD:  return operand1 + operand2;
+        case SUB:  return operand1 - operand2;
+        case AND:  return operand1 & operand2;
+        case OR:   return operand1 | operand2;
+        case XOR:  return operand1 ^ operand2;
+        case NOR:  return ~(operand1 | operand2);
+        case SLT:  return ((int32_t)operand1 < (int32_t)operand2) ? 1 : 0;
+        case SLTU: return (operand1 < operand2) ? 1 : 0;
+        default:   return 0;
+    }
+}
+
+inline uint32_t ALU::compute(uint32_t operand1, uint32_t operand2, uint8_t shamt, Operation op) {
+    switch (op) {
+        case SLL: return operand2 << shamt;
+        case SRL: return operand2 >> shamt;
+        case SRA: return (uint32_t)((int32_t)operand2 >> shamt);
+        default:  return compute(operand1, operand2, op);
+    }
+}
+
+inline ALU::Result ALU::execute(uint32_t operand1, uint32_t operand2, Operation op) {
+    return Result{compute(operand1, operand2, op), operand1, operand2, op};
+}
+
+inline ALU::Result ALU::execute(uint32_t operand1, uint32_t operand2, uint8_t shamt, Operation op) {
+    return Result{compute(operand1, operand2, shamt, op), operand1, operand2, op};
+}
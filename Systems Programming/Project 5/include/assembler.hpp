@@ -0,0 +1,113 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+
+// One-pass MIPS assembler producing a memory image for the simulators.
+// Every instruction in the decode tables is accepted, with its operands in
+// the order the disassembler prints them, plus common pseudo-instructions
+// and the .text/.data/.word/.half/.byte/.space/.align/.ascii/.asciiz/
+// .float/.double directives. A label used before its definition is
+// recorded at the use and patched once the whole source has been read.
+class Assembler {
+public:
+    static const uint32_t TEXT_BASE = 0x00000000;
+    static const uint32_t DATA_BASE = 0x00004000;
+
+    struct Error {
+        int line;
+        std::string message;
+    };
+
+    explicit Assembler(uint32_t memory_size = 65536);
+
+    // Returns false if any line failed; getErrors() lists them
+    bool assemble(const std::string& source);
+    bool assembleFile(const std::string& filename);
+
+    // Memory image from address 0, memory_size bytes
+    const std::vector<uint8_t>& getImage() const;
+    uint32_t getInstructionCount() const;
+    int getLineCount() const;
+    const std::vector<Error>& getErrors() const;
+    std::string getErrorString() const;
+    bool getSymbol(const std::string& name, uint32_t& address) const;
+
+private:
+    // How a label value is placed into the word at a fixup address
+    enum FixupKind : uint8_t {
+        FIX_BRANCH,      // Word offset from the next instruction
+        FIX_JUMP,        // 26-bit word index
+        FIX_HI,          // Upper half, for lui/ori pairs
+        FIX_HI_ADJUSTED, // Upper half, for lui and a signed low half
+        FIX_LO,          // Lower half
+        FIX_SIMM16,      // Whole value in a signed 16-bit field
+        FIX_UIMM16,      // Whole value in an unsigned 16-bit field
+        FIX_WORD,
+        FIX_HALF,
+        FIX_BYTE
+    };
+
+    struct Fixup {
+        uint32_t address;
+        FixupKind kind;
+        int line;
+        std::string_view label;
+        int32_t addend;
+    };
+
+    uint32_t memory_size;
+    std::string source;
+    std::vector<uint8_t> image;
+    std::unordered_map<std::string_view, uint32_t> symbols;
+    std::vector<Fixup> fixups;
+    std::vector<Error> errors;
+    uint32_t text_cursor;
+    uint32_t data_cursor;
+    // Where the current .text and .data sections began; text that starts
+    // below the data section must end before it
+    uint32_t text_start;
+    uint32_t data_start;
+    bool in_text;
+    uint32_t instruction_count;
+    int line_number;
+
+    // Cursor over the line being assembled
+    const char* cursor;
+    const char* line_end;
+
+    void reset();
+    void assembleLine();
+    bool assembleInstruction(std::string_view mnemonic);
+    bool assembleDirective(std::string_view directive);
+    bool assemblePseudo(int pseudo);
+
+    // Operand parsing; each returns false after recording an error
+    void skipSpaces();
+    bool atLineEnd();
+    bool expectComma();
+    bool parseIdentifier(std::string_view& name);
+    bool parseNumber(int64_t& value);
+    bool parseValue(int64_t& value, std::string_view& label);
+    bool parseRegister(uint32_t& reg);
+    bool parseFPRegister(uint32_t& reg);
+    bool parseControlRegister(uint32_t& reg);
+    bool parseImmediate(uint32_t& word, bool is_signed, uint32_t at);
+    bool parseBranchTarget(uint32_t& word, uint32_t at);
+    bool parseJumpTarget(uint32_t& word, uint32_t at);
+    bool parseMemoryOperand(uint32_t word, uint32_t at);
+    bool parseString(std::string& text);
+
+    uint32_t& currentCursor() { return in_text ? text_cursor : data_cursor; }
+    bool emitWord(uint32_t word, bool is_instruction = true);
+    bool emitBytes(uint64_t value, uint32_t size);
+    bool alignCursor(uint32_t alignment);
+    bool checkRoom(uint32_t address, uint64_t size);
+    void addFixup(uint32_t address, FixupKind kind, std::string_view label, int32_t addend);
+    void resolveFixups(size_t first);
+    bool applyFixup(const Fixup& fixup, uint32_t value);
+    void error(const std::string& message);
+    void error(int line, const std::string& message);
+};
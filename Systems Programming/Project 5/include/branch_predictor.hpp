@@ -1,46 +1,220 @@
 #pragma once
 #include <cstdint>
-#include <map>
 #include <string>
 #include <vector>
 
+class CheckpointFile;
+
 class BranchPredictor {
 public:
     enum PredictorType {
         STATIC_NOT_TAKEN,
         STATIC_TAKEN,
         DYNAMIC_1BIT,
-        DYNAMIC_2BIT
+        DYNAMIC_2BIT,
+        GSHARE
     };
-    
+
+    // 2-bit predictor states
+    enum State2Bit {
+        STRONGLY_NOT_TAKEN = 0,
+        WEAKLY_NOT_TAKEN = 1,
+        WEAKLY_TAKEN = 2,
+        STRONGLY_TAKEN = 3
+    };
+
+    // One resolved conditional branch. The PC is word aligned, so bit 0
+    // carries the outcome and a record stays 8 bytes.
+    struct BranchRecord {
+        uint32_t pc_taken;
+        uint32_t target;
+
+        uint32_t pc() const { return pc_taken & ~1u; }
+        bool taken() const { return (pc_taken & 1u) != 0; }
+    };
+
     struct PredictionStats {
         int total_predictions;
         int correct_predictions;
         int incorrect_predictions;
         double accuracy;
+        
+        // Loop predictor overrides of the base prediction
+        int loop_overrides;
+        int loop_mispredicts_removed;
+        int loop_mispredicts_added;
     };
-    
-    BranchPredictor(PredictorType type = STATIC_NOT_TAKEN);
+
+    BranchPredictor(PredictorType type = STATIC_NOT_TAKEN, int table_bits = 10, int history_bits = 8);
     ~BranchPredictor();
-    
+
     bool predict(uint32_t pc);
     void update(uint32_t pc, bool actual_outcome);
     void reset();
-    
+
+    // Compile-time specialized paths used by the simulator's branch hot path.
+    // predictWith() is side-effect free (fetch); in_flight is the number of
+    // older instances of the same branch fetched but not yet resolved.
+    // resolveWith() scores the prediction, trains the table and returns
+    // what was predicted.
+    template <typename Policy> bool predictWith(uint32_t pc, uint32_t in_flight = 0) const;
+    template <typename Policy> bool resolveWith(uint32_t pc, bool actual_outcome, uint32_t target);
+
+    // Resolve every branch of a captured trace in order
+    void replayTrace(const std::vector<BranchRecord>& trace);
+
     PredictionStats getStats() const;
     std::string getStatsString() const;
     void setPredictorType(PredictorType type);
+    PredictorType getPredictorType() const;
     
+    // Loop predictor: learns trip counts of backward branches and overrides
+    // the base prediction once a loop has repeated the same count
+    void enableLoopPredictor(bool enable);
+    bool isLoopPredictorEnabled() const;
+
+    static bool parseType(const std::string& name, PredictorType& type);
+
+    // Tables, history and statistics for checkpoints. loadState() fails if
+    // the saved predictor type, loop predictor setting or table size differ.
+    void saveState(CheckpointFile& file) const;
+    bool loadState(CheckpointFile& file);
+
 private:
     PredictorType predictor_type;
-    std::map<uint32_t, uint8_t> branch_history_table;
+    std::vector<uint8_t> branch_history_table;
+    uint32_t index_mask;
+    uint32_t history_mask;
+    uint32_t global_history;
     PredictionStats stats;
     
-    // 2-bit predictor states
-    enum State2Bit {
-        STRONGLY_NOT_TAKEN = 0,
-        WEAKLY_NOT_TAKEN = 1,
-        WEAKLY_TAKEN = 2,
-        STRONGLY_TAKEN = 3
+    struct LoopEntry {
+        uint32_t tag;
+        uint16_t trip_count;
+        uint16_t current_iter;
+        uint8_t confidence;
+        bool valid;
     };
+    
+    static const int LOOP_TABLE_BITS = 6;
+    static const uint8_t LOOP_CONFIDENT = 2;
+    static const uint8_t LOOP_MAX_CONFIDENCE = 3;
+    
+    bool loop_predictor_enabled;
+    std::vector<LoopEntry> loop_table;
+    
+    const LoopEntry* findLoop(uint32_t pc) const {
+        const LoopEntry& entry = loop_table[(pc >> 2) & ((1u << LOOP_TABLE_BITS) - 1)];
+        return (entry.valid && entry.tag == pc && entry.confidence >= LOOP_CONFIDENT) ? &entry : nullptr;
+    }
+    bool resolveLoop(uint32_t pc, bool actual_outcome, bool base_prediction);
+
+    template <typename Policy> uint32_t tableIndex(uint32_t pc) const {
+        if (Policy::uses_history) {
+            return ((pc >> 2) ^ global_history) & index_mask;
+        }
+        return (pc >> 2) & index_mask;
+    }
+    template <typename Policy> void replayTraceWith(const std::vector<BranchRecord>& trace);
+    uint8_t initialState() const;
+    template <typename Policy> bool trainWith(uint32_t pc, bool actual_outcome);
+    void recordOutcome(bool predicted_outcome, bool actual_outcome);
 };
+
+// Direction policies. Each is a pure rule over one branch history table
+// entry, so selecting a policy as a template argument inlines it.
+namespace BranchPolicy {
+    struct Disabled {
+        static constexpr bool enabled = false;
+        static constexpr bool uses_history = false;
+        static constexpr uint8_t initial_state = 0;
+        static bool predict(uint8_t) { return false; }
+        static uint8_t next(uint8_t state, bool) { return state; }
+    };
+
+    struct StaticNotTaken {
+        static constexpr bool enabled = true;
+        static constexpr bool uses_history = false;
+        static constexpr uint8_t initial_state = 0;
+        static bool predict(uint8_t) { return false; }
+        static uint8_t next(uint8_t state, bool) { return state; }
+    };
+
+    struct StaticTaken {
+        static constexpr bool enabled = true;
+        static constexpr bool uses_history = false;
+        static constexpr uint8_t initial_state = 0;
+        static bool predict(uint8_t) { return true; }
+        static uint8_t next(uint8_t state, bool) { return state; }
+    };
+
+    // 1-bit: remember the last outcome
+    struct OneBit {
+        static constexpr bool enabled = true;
+        static constexpr bool uses_history = false;
+        static constexpr uint8_t initial_state = 0;
+        static bool predict(uint8_t state) { return state == 1; }
+        static uint8_t next(uint8_t, bool taken) { return taken ? 1 : 0; }
+    };
+
+    // 2-bit saturating counter
+    struct TwoBit {
+        static constexpr bool enabled = true;
+        static constexpr bool uses_history = false;
+        static constexpr uint8_t initial_state = BranchPredictor::WEAKLY_NOT_TAKEN;
+        static bool predict(uint8_t state) { return state >= BranchPredictor::WEAKLY_TAKEN; }
+        static uint8_t next(uint8_t state, bool taken) {
+            if (taken) {
+                return state < BranchPredictor::STRONGLY_TAKEN ? state + 1 : state;
+            }
+            return state > BranchPredictor::STRONGLY_NOT_TAKEN ? state - 1 : state;
+        }
+    };
+
+    // Gshare: 2-bit counters indexed by PC xor global outcome history
+    struct Gshare : TwoBit {
+        static constexpr bool uses_history = true;
+    };
+}
+
+template <typename Policy>
+inline bool BranchPredictor::predictWith(uint32_t pc, uint32_t in_flight) const {
+    if (loop_predictor_enabled) {
+        const LoopEntry* loop = findLoop(pc);
+        if (loop != nullptr) {
+            uint32_t iteration = (loop->current_iter + in_flight) % (loop->trip_count + 1u);
+            return iteration < loop->trip_count;
+        }
+    }
+    return Policy::predict(branch_history_table[tableIndex<Policy>(pc)]);
+}
+
+template <typename Policy>
+inline bool BranchPredictor::trainWith(uint32_t pc, bool actual_outcome) {
+    uint8_t& state = branch_history_table[tableIndex<Policy>(pc)];
+    bool predicted_outcome = Policy::predict(state);
+    state = Policy::next(state, actual_outcome);
+    if (Policy::uses_history) {
+        global_history = ((global_history << 1) | (actual_outcome ? 1 : 0)) & history_mask;
+    }
+    return predicted_outcome;
+}
+
+inline void BranchPredictor::recordOutcome(bool predicted_outcome, bool actual_outcome) {
+    if (predicted_outcome == actual_outcome) {
+        stats.correct_predictions++;
+    } else {
+        stats.incorrect_predictions++;
+    }
+}
+
+template <typename Policy>
+inline bool BranchPredictor::resolveWith(uint32_t pc, bool actual_outcome, uint32_t target) {
+    bool predicted_outcome = trainWith<Policy>(pc, actual_outcome);
+    if (loop_predictor_enabled && target <= pc) {
+        predicted_outcome = resolveLoop(pc, actual_outcome, predicted_outcome);
+    }
+    stats.total_predictions++;
+    recordOutcome(predicted_outcome, actual_outcome);
+    return predicted_outcome;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class CheckpointFile;
+
+// Target prediction for control transfers: a set-associative branch target
+// buffer, a return address stack for JAL/JR $ra pairs and a path-history
+// indexed table for the remaining indirect jumps.
+class BranchTargetPredictor {
+public:
+    enum BranchKind {
+        KIND_NONE = 0,
+        KIND_CONDITIONAL = 1, // BEQ, BNE, BLEZ, BGTZ, BLTZ(AL), BGEZ(AL), BC1F, BC1T
+        KIND_JUMP = 2,        // J
+        KIND_CALL = 3,        // JAL, JALR
+        KIND_RETURN = 4,      // JR $ra
+        KIND_INDIRECT = 5     // JR on any other register
+    };
+
+    struct Prediction {
+        bool hit;             // PC is a known control transfer
+        BranchKind kind;
+        uint32_t target;      // Predicted target when taken
+    };
+
+    struct TargetStats {
+        int lookups;
+        int btb_hits;
+        int btb_misses;
+        int ras_predictions;
+        int ras_correct;
+        int indirect_predictions;
+        int indirect_correct;
+        int target_mispredictions;
+    };
+
+    BranchTargetPredictor(int btb_sets = 64, int btb_ways = 4, int ras_depth = 16, int indirect_bits = 8);
+    ~BranchTargetPredictor();
+
+    Prediction predict(uint32_t pc) const;
+    void update(uint32_t pc, BranchKind kind, bool taken, uint32_t target);
+    void reset();
+
+    TargetStats getStats() const;
+    std::string getStatsString() const;
+
+    // BTB, return stack and indirect table for checkpoints; loadState()
+    // fails if the saved geometry differs or a value is out of range
+    void saveState(CheckpointFile& file) const;
+    bool loadState(CheckpointFile& file);
+
+private:
+    struct BTBEntry {
+        uint32_t tag;
+        uint32_t target;
+        uint32_t lru;
+        BranchKind kind;
+        bool valid;
+    };
+
+    struct IndirectEntry {
+        uint32_t target;
+        bool valid;
+    };
+
+    int num_sets;
+    int num_ways;
+    std::vector<BTBEntry> btb;
+    uint32_t lru_clock;
+
+    std::vector<uint32_t> return_stack;
+    int ras_top;
+    int ras_count;
+
+    std::vector<IndirectEntry> indirect_table;
+    uint32_t indirect_mask;
+    uint32_t path_history;
+
+    TargetStats stats;
+
+    const BTBEntry* findEntry(uint32_t pc) const;
+    void allocateEntry(uint32_t pc, BranchKind kind, uint32_t target);
+    uint32_t indirectIndex(uint32_t pc) const;
+};
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Timing-only set-associative cache: tags and LRU state, no data.
+// Write-back and write-allocate; a cache of zero bytes is disabled and
+// every access hits.
+class CacheModel {
+public:
+    struct CacheStats {
+        uint64_t accesses;
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t writebacks; // Dirty lines evicted
+    };
+
+    CacheModel();
+    ~CacheModel();
+
+    // Sizes in bytes; size and line must be powers of two and the cache
+    // must hold at least one set. Returns false and leaves the cache
+    // disabled otherwise.
+    bool configure(uint32_t size, uint32_t ways, uint32_t line_size);
+    bool isEnabled() const;
+    void reset();
+
+    // Look up and fill the line holding address; true on a hit
+    bool access(uint32_t address, bool write);
+
+    CacheStats getStats() const;
+    std::string getStatsString(const std::string& name) const;
+
+    // "SIZE[k]:WAYS:LINE", e.g. "8k:2:32"
+    static bool parseConfig(const std::string& text, uint32_t& size, uint32_t& ways, uint32_t& line_size);
+
+private:
+    struct Line {
+        uint32_t tag;
+        uint32_t lru;
+        bool valid;
+        bool dirty;
+    };
+
+    uint32_t size;
+    uint32_t num_ways;
+    uint32_t line_shift;
+    uint32_t set_mask;
+    std::vector<Line> lines;
+    uint32_t lru_clock;
+    CacheStats stats;
+};
@@ -0,0 +1,81 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <type_traits>
+
+// Simulator state saved to disk. The file is laid out as
+//
+//   header    MAGIC, VERSION, page size, memory size, and the offset and
+//             size of each section below
+//   pages     page number of each stored page (4 bytes each)
+//   state     values appended by the components in a fixed order, in
+//             host byte order
+//   memory    page size bytes per stored page, from a FILE_ALIGNMENT
+//             boundary so each page lies on a host page of the file
+//
+// Pages that are all zero are not stored. Reading maps the file private
+// (copy-on-write), so only the state and the stored pages are touched.
+class CheckpointFile {
+public:
+    static constexpr char MAGIC[8] = {'M', 'I', 'P', 'S', 'C', 'K', 'P', 'T'};
+    static const uint32_t VERSION = 2;
+    static const uint32_t FILE_ALIGNMENT = 4096;
+
+    CheckpointFile();
+    ~CheckpointFile();
+
+    // Writing: append the state and pages, then write() them out. Page
+    // data is referenced, not copied, until write() returns.
+    template <typename T> void put(const T& value) { putBytes(&value, sizeof(T)); }
+    void putBytes(const void* data, size_t size);
+    void addPage(uint32_t number, const uint8_t* data);
+    bool write(const std::string& filename, uint32_t page_size, uint32_t memory_size) const;
+
+    // Reading: false if the file is missing, truncated or another version.
+    // State values are read back in the order they were put.
+    bool read(const std::string& filename);
+    void close();
+    template <typename T> bool get(T& value) { return getBytes(&value, sizeof(T)); }
+    bool get(bool& value);
+    bool getBytes(void* data, size_t size);
+    bool isStateConsumed() const;
+
+    // Whether a bool read back inside a raw struct holds 0 or 1; any other
+    // byte is undefined to use, so loaders check before trusting it
+    static bool isFlag(const bool& flag);
+
+    uint32_t getPageSize() const;
+    uint32_t getMemorySize() const;
+    size_t getPageCount() const;
+    uint32_t getPageNumber(size_t index) const;
+    const uint8_t* getPageData(size_t index) const;
+
+private:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t page_size;
+        uint32_t memory_size;
+        uint32_t page_count;
+        uint64_t pages_offset;
+        uint64_t state_offset;
+        uint64_t state_size;
+        uint64_t memory_offset;
+    };
+    static_assert(std::is_trivially_copyable<Header>::value, "Header is written as raw bytes");
+
+    std::vector<uint8_t> state;
+    size_t cursor;
+    std::vector<uint32_t> page_numbers;
+    std::vector<const uint8_t*> page_data;
+    uint32_t page_size;
+    uint32_t memory_size;
+
+    // File mapping while reading
+    const uint8_t* base;
+    size_t length;
+    const uint8_t* state_data;
+    size_t state_size;
+};
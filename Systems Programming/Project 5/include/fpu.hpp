@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "instruction_decoder.hpp"
+
+// Coprocessor 1: 32 single-precision registers, with doubles held in
+// even/odd pairs (the even register has the low word), and the FCSR with
+// the compare condition bit and rounding mode. Arithmetic rounds to
+// nearest; FCSR rounding applies to cvt.w. Exceptions are not raised.
+class FPU {
+public:
+    static const uint32_t FCSR_CONDITION = 1u << 23;
+    static const uint32_t FCSR_ROUNDING_MASK = 0x3;
+    
+    FPU();
+    
+    void reset();
+    
+    // Raw register bits
+    uint32_t getRegister(int reg) const;
+    void setRegister(int reg, uint32_t bits);
+    
+    float getSingle(int reg) const;
+    void setSingle(int reg, float value);
+    double getDouble(int reg) const;
+    void setDouble(int reg, double value);
+    uint64_t getDoubleBits(int reg) const;
+    void setDoubleBits(int reg, uint64_t bits);
+    
+    // Control registers for cfc1/ctc1: $0 is the implementation register,
+    // $31 the FCSR
+    uint32_t readControl(int reg) const;
+    void writeControl(int reg, uint32_t value);
+    bool getCondition() const;
+    
+    // Arithmetic, conversion or compare of a COP1 S/D/W-format word
+    void execute(uint32_t instruction, MIPS::Operation operation);
+    
+    std::string getStateString() const;
+    
+    // R3010-style result latency per MIPS::FPLatency class, {single, double}
+    static const int DEFAULT_LATENCY[MIPS::FPLAT_COUNT][2];
+    
+    // Latency class and precision range (0 single, 1 double) named by e.g.
+    // "mul" or "div.d"; false if the name is unknown
+    static bool parseLatencyName(const std::string& name, int& latency_class,
+                                 int& first_precision, int& last_precision);
+    
+private:
+    std::vector<uint32_t> registers;
+    uint32_t fcsr;
+    
+    int32_t roundToWord(double value) const;
+    void compare(double a, double b, uint8_t condition);
+};
@@ -0,0 +1,131 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <algorithm>
+#include "instruction_decoder.hpp"
+
+// Interlock rules of the 5-stage pipeline, shared by the pipeline model and
+// trace replay so both time hazards the same way.
+//
+// Multi-cycle units are tracked in cycles: an instruction that reads or
+// writes a pending HI/LO or FP result moves into ID/EX no earlier than its
+// ready cycle, and a new operation for a busy unpipelined unit (the
+// multiply/divide unit, the FP divider) waits until it is free.
+class HazardScoreboard {
+public:
+    // Plain data, so checkpoints can store it
+    struct State {
+        uint64_t hilo_ready;
+        uint64_t muldiv_free;
+        uint64_t fpr_ready[32];
+        uint64_t condition_ready;
+        uint64_t fp_divider_free;
+    };
+
+    HazardScoreboard();
+
+    void reset(); // Clear pending results; latencies are kept
+    const State& getState() const;
+    void setState(const State& state);
+
+    void setMulDivLatency(int multiply_cycles, int divide_cycles);
+    void setMulDivPipelined(bool pipelined);
+    // "class[.s|.d]" as FPU::parseLatencyName() accepts; false if unknown
+    bool setFPLatency(const std::string& name, int cycles);
+    int getMultiplyLatency() const;
+    int getDivideLatency() const;
+    bool isMulDivPipelined() const;
+
+    // True if the instruction reads the GPR that a load one stage ahead of
+    // it writes; it must wait a cycle for the loaded value
+    static bool readsLoadResult(uint32_t instruction, const MIPS::InstructionInfo& info, uint8_t load_dest);
+
+    // Earliest cycle the instruction may enter ID/EX; 0 if it waits on nothing
+    uint64_t mulDivReadyCycle(const MIPS::InstructionInfo& info) const;
+    uint64_t fpReadyCycle(uint32_t instruction, const MIPS::InstructionInfo& info) const;
+
+    // Whether the instruction reserves a unit when it enters ID/EX
+    static bool startsUnit(const MIPS::InstructionInfo& info);
+    // Mark the results and units of an instruction entering ID/EX at cycle
+    void issue(uint32_t instruction, const MIPS::InstructionInfo& info, uint64_t cycle);
+
+private:
+    int multiply_latency;
+    int divide_latency;
+    bool muldiv_pipelined;
+    int fp_latency[MIPS::FPLAT_COUNT][2]; // [class][double]
+    State state;
+
+    uint64_t fpRegisterReady(uint8_t reg, bool is_double) const;
+};
+
+// Queried for every instruction, so inline
+inline bool HazardScoreboard::readsLoadResult(uint32_t instruction, const MIPS::InstructionInfo& info, uint8_t load_dest) {
+    if (load_dest == 0) {
+        return false;
+    }
+    uint8_t rs = (instruction >> 21) & 0x1F;
+    uint8_t rt = (instruction >> 16) & 0x1F;
+    return (info.control.reads_rs && rs == load_dest) || (info.control.reads_rt && rt == load_dest);
+}
+
+inline uint64_t HazardScoreboard::mulDivReadyCycle(const MIPS::InstructionInfo& info) const {
+    switch (info.operation) {
+        case MIPS::OP_MFHI:
+        case MIPS::OP_MFLO:
+        case MIPS::OP_MTHI:
+        case MIPS::OP_MTLO:
+            return state.hilo_ready;
+        case MIPS::OP_MULT:
+        case MIPS::OP_MULTU:
+        case MIPS::OP_DIV:
+        case MIPS::OP_DIVU:
+            return state.muldiv_free;
+        default:
+            return 0;
+    }
+}
+
+inline uint64_t HazardScoreboard::fpRegisterReady(uint8_t reg, bool is_double) const {
+    if (is_double) {
+        reg &= ~1;
+        return std::max(state.fpr_ready[reg], state.fpr_ready[reg + 1]);
+    }
+    return state.fpr_ready[reg];
+}
+
+// FP operands, the condition bit, the result register and, for divide and
+// square root, the divider must all be free
+inline uint64_t HazardScoreboard::fpReadyCycle(uint32_t instruction, const MIPS::InstructionInfo& info) const {
+    const MIPS::FPSignals& fp = info.fp;
+    uint8_t ft = (instruction >> 16) & 0x1F;
+    uint8_t fs = (instruction >> 11) & 0x1F;
+    uint8_t fd = (instruction >> 6) & 0x1F;
+    uint64_t ready = 0;
+    if (fp.reads_fs) ready = std::max(ready, fpRegisterReady(fs, fp.source_double));
+    if (fp.reads_ft) ready = std::max(ready, fpRegisterReady(ft, fp.source_double));
+    if (fp.reads_condition) ready = std::max(ready, state.condition_ready);
+    switch (fp.destination) {
+        case MIPS::FDEST_FD: ready = std::max(ready, fpRegisterReady(fd, fp.result_double)); break;
+        case MIPS::FDEST_FS: ready = std::max(ready, fpRegisterReady(fs, fp.result_double)); break;
+        case MIPS::FDEST_FT: ready = std::max(ready, fpRegisterReady(ft, fp.result_double)); break;
+        case MIPS::FDEST_CONDITION: ready = std::max(ready, state.condition_ready); break;
+        case MIPS::FDEST_NONE: break;
+    }
+    if (fp.latency == MIPS::FPLAT_DIV || fp.latency == MIPS::FPLAT_SQRT) {
+        ready = std::max(ready, state.fp_divider_free);
+    }
+    return ready;
+}
+
+inline bool HazardScoreboard::startsUnit(const MIPS::InstructionInfo& info) {
+    switch (info.operation) {
+        case MIPS::OP_MULT:
+        case MIPS::OP_MULTU:
+        case MIPS::OP_DIV:
+        case MIPS::OP_DIVU:
+            return true;
+        default:
+            return info.fp.latency != MIPS::FPLAT_NONE;
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+// Host time the simulator itself spends per phase, for tuning it. Built
+// with -DMIPS_SELF_PROFILE=ON, HOST_PHASE(PHASE_X) at the top of a scope
+// times it with the time stamp counter; nested scopes are subtracted, so
+// each phase reports its exclusive time. Otherwise HOST_PHASE expands to
+// nothing and the simulator pays nothing.
+//
+// Host hardware counters (cycles, instructions, cache and branch misses)
+// can be added with perf_event_open; they cover the whole process rather
+// than single phases.
+class HostProfiler {
+public:
+    enum Phase {
+        PHASE_FETCH,
+        PHASE_DECODE,
+        PHASE_EXECUTE,
+        PHASE_MEMORY,
+        PHASE_PREDICTOR, // Prediction and training
+        PHASE_PIPELINE,  // Latches, hazards and the scoreboard
+        PHASE_FORMAT,    // State and statistics strings
+        PHASE_COUNT
+    };
+
+#ifdef MIPS_SELF_PROFILE
+    static const bool ENABLED = true;
+#else
+    static const bool ENABLED = false;
+#endif
+
+    static HostProfiler& instance();
+
+    static uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+    }
+
+    void add(Phase phase, uint64_t ticks) {
+        phase_ticks[phase] += ticks;
+        phase_calls[phase]++;
+    }
+
+    // Open the perf_event_open counters; false if the host does not allow
+    // it (e.g. kernel.perf_event_paranoid, containers)
+    bool enableHardwareCounters();
+
+    // Phases by exclusive time, time outside any phase, and the hardware
+    // counters if enabled
+    std::string getReportString() const;
+
+private:
+    HostProfiler();
+    ~HostProfiler();
+    HostProfiler(const HostProfiler&) = delete;
+    HostProfiler& operator=(const HostProfiler&) = delete;
+
+    static const int HARDWARE_COUNTERS = 4;
+
+    uint64_t phase_ticks[PHASE_COUNT];
+    uint64_t phase_calls[PHASE_COUNT];
+    // Clock and steady_clock at construction, to convert ticks to time
+    uint64_t start_ticks;
+    int64_t start_nanoseconds;
+    uint64_t timer_cost; // Ticks between back-to-back clock reads
+    int counter_fds[HARDWARE_COUNTERS]; // -1 when not open
+};
+
+// Times the rest of its scope for one phase, minus nested timers
+class ScopedPhaseTimer {
+public:
+    explicit ScopedPhaseTimer(HostProfiler::Phase phase)
+        : phase(phase), parent(active), nested(0), start(HostProfiler::now()) {
+        active = this;
+    }
+    ~ScopedPhaseTimer() {
+        uint64_t elapsed = HostProfiler::now() - start;
+        HostProfiler::instance().add(phase, elapsed - nested);
+        if (parent != nullptr) parent->nested += elapsed;
+        active = parent;
+    }
+    ScopedPhaseTimer(const ScopedPhaseTimer&) = delete;
+    ScopedPhaseTimer& operator=(const ScopedPhaseTimer&) = delete;
+
+private:
+    static thread_local ScopedPhaseTimer* active;
+    HostProfiler::Phase phase;
+    ScopedPhaseTimer* parent;
+    uint64_t nested; // Ticks of timers inside this one
+    uint64_t start;
+};
+
+#ifdef MIPS_SELF_PROFILE
+#define HOST_PHASE(phase) ScopedPhaseTimer host_phase_timer(HostProfiler::phase)
+#else
+#define HOST_PHASE(phase) ((void)0)
+#endif
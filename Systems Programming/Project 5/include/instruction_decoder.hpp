@@ -1,11 +1,30 @@
 #pragma once
 #include <cstdint>
 #include <string>
+#include <cstddef>
 
 // MIPS instruction opcodes and function codes
 namespace MIPS {
     // R-type instructions (opcode = 0x00)
     const uint8_t OPCODE_RTYPE = 0x00;
+    const uint8_t FUNCT_SLL = 0x00;
+    const uint8_t FUNCT_SRL = 0x02;
+    const uint8_t FUNCT_SRA = 0x03;
+    const uint8_t FUNCT_SLLV = 0x04;
+    const uint8_t FUNCT_SRLV = 0x06;
+    const uint8_t FUNCT_SRAV = 0x07;
+    const uint8_t FUNCT_JR = 0x08;
+    const uint8_t FUNCT_JALR = 0x09;
+    const uint8_t FUNCT_SYSCALL = 0x0C;
+    const uint8_t FUNCT_BREAK = 0x0D;
+    const uint8_t FUNCT_MFHI = 0x10;
+    const uint8_t FUNCT_MTHI = 0x11;
+    const uint8_t FUNCT_MFLO = 0x12;
+    const uint8_t FUNCT_MTLO = 0x13;
+    const uint8_t FUNCT_MULT = 0x18;
+    const uint8_t FUNCT_MULTU = 0x19;
+    const uint8_t FUNCT_DIV = 0x1A;
+    const uint8_t FUNCT_DIVU = 0x1B;
     const uint8_t FUNCT_ADD = 0x20;
     const uint8_t FUNCT_ADDU = 0x21;
     const uint8_t FUNCT_SUB = 0x22;
@@ -14,31 +33,78 @@ namespace MIPS {
     const uint8_t FUNCT_OR = 0x25;
     const uint8_t FUNCT_XOR = 0x26;
     const uint8_t FUNCT_NOR = 0x27;
-    const uint8_t FUNCT_SLT = 0x28;
-    const uint8_t FUNCT_SLTU = 0x29;
-    const uint8_t FUNCT_SLL = 0x00;
-    const uint8_t FUNCT_SRL = 0x02;
-    const uint8_t FUNCT_SRA = 0x03;
-    const uint8_t FUNCT_JR = 0x08;
+    const uint8_t FUNCT_SLT = 0x2A;
+    const uint8_t FUNCT_SLTU = 0x2B;
+    
+    // REGIMM branches (opcode = 0x01), selected by the rt field
+    const uint8_t OPCODE_REGIMM = 0x01;
+    const uint8_t REGIMM_BLTZ = 0x00;
+    const uint8_t REGIMM_BGEZ = 0x01;
+    const uint8_t REGIMM_BLTZAL = 0x10;
+    const uint8_t REGIMM_BGEZAL = 0x11;
     
     // I-type instructions
+    const uint8_t OPCODE_BEQ = 0x04;
+    const uint8_t OPCODE_BNE = 0x05;
+    const uint8_t OPCODE_BLEZ = 0x06;
+    const uint8_t OPCODE_BGTZ = 0x07;
     const uint8_t OPCODE_ADDI = 0x08;
     const uint8_t OPCODE_ADDIU = 0x09;
+    const uint8_t OPCODE_SLTI = 0x0A;
+    const uint8_t OPCODE_SLTIU = 0x0B;
     const uint8_t OPCODE_ANDI = 0x0C;
     const uint8_t OPCODE_ORI = 0x0D;
     const uint8_t OPCODE_XORI = 0x0E;
     const uint8_t OPCODE_LUI = 0x0F;
+    const uint8_t OPCODE_LB = 0x20;
+    const uint8_t OPCODE_LH = 0x21;
+    const uint8_t OPCODE_LWL = 0x22;
     const uint8_t OPCODE_LW = 0x23;
+    const uint8_t OPCODE_LBU = 0x24;
+    const uint8_t OPCODE_LHU = 0x25;
+    const uint8_t OPCODE_LWR = 0x26;
+    const uint8_t OPCODE_SB = 0x28;
+    const uint8_t OPCODE_SH = 0x29;
+    const uint8_t OPCODE_SWL = 0x2A;
     const uint8_t OPCODE_SW = 0x2B;
-    const uint8_t OPCODE_BEQ = 0x04;
-    const uint8_t OPCODE_BNE = 0x05;
-    const uint8_t OPCODE_SLTI = 0x0A;
-    const uint8_t OPCODE_SLTIU = 0x0B;
+    const uint8_t OPCODE_SWR = 0x2E;
     
     // J-type instructions
     const uint8_t OPCODE_J = 0x02;
     const uint8_t OPCODE_JAL = 0x03;
     
+    // Coprocessor 1 (FPU): the rs field selects a move, a branch on the
+    // condition bit or the operand format of an arithmetic funct
+    const uint8_t OPCODE_COP1 = 0x11;
+    const uint8_t OPCODE_LWC1 = 0x31;
+    const uint8_t OPCODE_LDC1 = 0x35;
+    const uint8_t OPCODE_SWC1 = 0x39;
+    const uint8_t OPCODE_SDC1 = 0x3D;
+    const uint8_t COP1_MF = 0x00;
+    const uint8_t COP1_CF = 0x02;
+    const uint8_t COP1_MT = 0x04;
+    const uint8_t COP1_CT = 0x06;
+    const uint8_t COP1_BC = 0x08;
+    const uint8_t COP1_FMT_S = 0x10;
+    const uint8_t COP1_FMT_D = 0x11;
+    const uint8_t COP1_FMT_W = 0x14;
+    const uint8_t FUNCT_FADD = 0x00;
+    const uint8_t FUNCT_FSUB = 0x01;
+    const uint8_t FUNCT_FMUL = 0x02;
+    const uint8_t FUNCT_FDIV = 0x03;
+    const uint8_t FUNCT_FSQRT = 0x04;
+    const uint8_t FUNCT_FABS = 0x05;
+    const uint8_t FUNCT_FMOV = 0x06;
+    const uint8_t FUNCT_FNEG = 0x07;
+    const uint8_t FUNCT_CVT_S = 0x20;
+    const uint8_t FUNCT_CVT_D = 0x21;
+    const uint8_t FUNCT_CVT_W = 0x24;
+    const uint8_t FUNCT_FCMP = 0x30; // c.cond: low four bits are the condition
+    
+    // SYSCALL service numbers (in $v0) that end the program
+    const uint32_t SYSCALL_EXIT = 10;
+    const uint32_t SYSCALL_EXIT2 = 17;
+    
     // Register names
     const int REG_ZERO = 0;
     const int REG_AT = 1;
@@ -72,13 +138,427 @@ namespace MIPS {
     const int REG_SP = 29;
     const int REG_FP = 30;
     const int REG_RA = 31;
+    
+    // Instruction word layout
+    enum Format : uint8_t {
+        FORMAT_R,
+        FORMAT_I,
+        FORMAT_J
+    };
+    
+    // Operand order the disassembler prints
+    enum OperandLayout : uint8_t {
+        LAYOUT_NONE,          // syscall
+        LAYOUT_RD_RS_RT,      // add $rd, $rs, $rt
+        LAYOUT_RD_RT_SA,      // sll $rd, $rt, sa
+        LAYOUT_RD_RT_RS,      // sllv $rd, $rt, $rs
+        LAYOUT_RD_RS,         // jalr $rd, $rs
+        LAYOUT_RS_RT,         // mult $rs, $rt
+        LAYOUT_RD,            // mfhi $rd
+        LAYOUT_RS,            // jr $rs
+        LAYOUT_RT_RS_IMM,     // addi $rt, $rs, imm
+        LAYOUT_RT_RS_HEX,     // ori $rt, $rs, 0xffff
+        LAYOUT_RT_HEX,        // lui $rt, 0x1000
+        LAYOUT_RT_OFFSET_BASE, // lw $rt, offset($rs)
+        LAYOUT_RS_RT_OFFSET,  // beq $rs, $rt, offset
+        LAYOUT_RS_OFFSET,     // blez $rs, offset
+        LAYOUT_TARGET,        // j target
+        LAYOUT_FD_FS_FT,      // add.s $fd, $fs, $ft
+        LAYOUT_FD_FS,         // cvt.d.s $fd, $fs
+        LAYOUT_FS_FT,         // c.eq.d $fs, $ft
+        LAYOUT_RT_FS,         // mfc1 $rt, $fs
+        LAYOUT_RT_FCR,        // cfc1 $rt, $31
+        LAYOUT_FT_OFFSET_BASE, // lwc1 $ft, offset($rs)
+        LAYOUT_OFFSET         // bc1t offset
+    };
+    
+    // Operation the executor performs
+    enum Operation : uint8_t {
+        OP_INVALID,
+        OP_ADD, OP_ADDU, OP_SUB, OP_SUBU,
+        OP_AND, OP_OR, OP_XOR, OP_NOR,
+        OP_SLT, OP_SLTU,
+        OP_SLL, OP_SRL, OP_SRA, OP_SLLV, OP_SRLV, OP_SRAV,
+        OP_MULT, OP_MULTU, OP_DIV, OP_DIVU,
+        OP_MFHI, OP_MTHI, OP_MFLO, OP_MTLO,
+        OP_JR, OP_JALR, OP_SYSCALL, OP_BREAK,
+        OP_ADDI, OP_ADDIU, OP_SLTI, OP_SLTIU,
+        OP_ANDI, OP_ORI, OP_XORI, OP_LUI,
+        OP_LB, OP_LBU, OP_LH, OP_LHU, OP_LW, OP_LWL, OP_LWR,
+        OP_SB, OP_SH, OP_SW, OP_SWL, OP_SWR,
+        OP_BEQ, OP_BNE, OP_BLEZ, OP_BGTZ,
+        OP_BLTZ, OP_BGEZ, OP_BLTZAL, OP_BGEZAL,
+        OP_J, OP_JAL,
+        // Coprocessor 1; arithmetic takes its operand format from the rs field
+        OP_FADD, OP_FSUB, OP_FMUL, OP_FDIV, OP_FSQRT,
+        OP_FABS, OP_FMOV, OP_FNEG,
+        OP_CVT_S, OP_CVT_D, OP_CVT_W, OP_FCMP,
+        OP_MFC1, OP_MTC1, OP_CFC1, OP_CTC1,
+        OP_BC1F, OP_BC1T,
+        OP_LWC1, OP_LDC1, OP_SWC1, OP_SDC1
+    };
+    
+    // Register field written back, if any
+    enum Destination : uint8_t {
+        DEST_NONE,
+        DEST_RD,
+        DEST_RT,
+        DEST_RA
+    };
+    
+    struct ControlSignals {
+        bool reg_write;
+        bool mem_read;
+        bool mem_write;
+        bool branch;
+        bool jump;
+        bool reads_rs;
+        bool reads_rt;
+        Destination destination;
+    };
+    
+    // Floating-point register written, if any
+    enum FPDestination : uint8_t {
+        FDEST_NONE,
+        FDEST_FD,
+        FDEST_FS,
+        FDEST_FT,
+        FDEST_CONDITION
+    };
+    
+    // Latency class of an FPU operation, timed per precision by the pipeline
+    enum FPLatency : uint8_t {
+        FPLAT_NONE,
+        FPLAT_MOVE,
+        FPLAT_ADD,
+        FPLAT_MUL,
+        FPLAT_DIV,
+        FPLAT_SQRT,
+        FPLAT_CVT,
+        FPLAT_CMP,
+        FPLAT_LOAD,
+        FPLAT_COUNT
+    };
+    
+    // FP register file use; doubles occupy an even/odd register pair
+    struct FPSignals {
+        bool reads_fs;
+        bool reads_ft;
+        bool reads_condition;
+        bool source_double;
+        bool result_double;
+        FPDestination destination;
+        FPLatency latency;
+    };
+    
+    // Everything decode needs to know about one opcode or funct value
+    struct InstructionInfo {
+        const char* mnemonic;
+        Format format;
+        OperandLayout layout;
+        Operation operation;
+        ControlSignals control;
+        FPSignals fp;
+    };
+    
+    // Opcode table for most words, funct table for opcode 0, rt table for
+    // the REGIMM branches, and for COP1 an rs table plus one funct table per
+    // operand format
+    struct DecodeTables {
+        InstructionInfo opcode[64];
+        InstructionInfo funct[64];
+        InstructionInfo regimm[32];
+        InstructionInfo cop1[32];
+        InstructionInfo cop1_branch[2];
+        InstructionInfo fpu_s[64];
+        InstructionInfo fpu_d[64];
+        InstructionInfo fpu_w[64];
+    };
+    
+    enum SignalFlags : uint8_t {
+        SIG_MEM_READ = 1,
+        SIG_MEM_WRITE = 2,
+        SIG_BRANCH = 4,
+        SIG_JUMP = 8,
+        SIG_READS_RS = 16,
+        SIG_READS_RT = 32
+    };
+    
+    constexpr InstructionInfo makeInfo(const char* mnemonic, Format format, OperandLayout layout,
+                                       Operation operation, Destination destination, uint8_t flags) {
+        return {mnemonic, format, layout, operation,
+                {destination != DEST_NONE, (flags & SIG_MEM_READ) != 0, (flags & SIG_MEM_WRITE) != 0,
+                 (flags & SIG_BRANCH) != 0, (flags & SIG_JUMP) != 0,
+                 (flags & SIG_READS_RS) != 0, (flags & SIG_READS_RT) != 0, destination},
+                {false, false, false, false, false, FDEST_NONE, FPLAT_NONE}};
+    }
+    
+    enum FPSignalFlags : uint8_t {
+        FPSIG_READS_FS = 1,
+        FPSIG_READS_FT = 2,
+        FPSIG_READS_CONDITION = 4,
+        FPSIG_SOURCE_DOUBLE = 8,
+        FPSIG_RESULT_DOUBLE = 16
+    };
+    
+    constexpr InstructionInfo makeFPInfo(const char* mnemonic, Format format, OperandLayout layout,
+                                         Operation operation, Destination destination, uint8_t flags,
+                                         FPDestination fp_destination, uint8_t fp_flags, FPLatency latency) {
+        InstructionInfo info = makeInfo(mnemonic, format, layout, operation, destination, flags);
+        info.fp = {(fp_flags & FPSIG_READS_FS) != 0, (fp_flags & FPSIG_READS_FT) != 0,
+                   (fp_flags & FPSIG_READS_CONDITION) != 0, (fp_flags & FPSIG_SOURCE_DOUBLE) != 0,
+                   (fp_flags & FPSIG_RESULT_DOUBLE) != 0, fp_destination, latency};
+        return info;
+    }
+    
+    constexpr const char* FP_COMPARE_S[16] = {
+        "c.f.s", "c.un.s", "c.eq.s", "c.ueq.s", "c.olt.s", "c.ult.s", "c.ole.s", "c.ule.s",
+        "c.sf.s", "c.ngle.s", "c.seq.s", "c.ngl.s", "c.lt.s", "c.nge.s", "c.le.s", "c.ngt.s"
+    };
+    constexpr const char* FP_COMPARE_D[16] = {
+        "c.f.d", "c.un.d", "c.eq.d", "c.ueq.d", "c.olt.d", "c.ult.d", "c.ole.d", "c.ule.d",
+        "c.sf.d", "c.ngle.d", "c.seq.d", "c.ngl.d", "c.lt.d", "c.nge.d", "c.le.d", "c.ngt.d"
+    };
+    
+    // S and D arithmetic share funct values; only names and widths differ
+    constexpr void fillFPUTable(InstructionInfo (&table)[64], bool is_double) {
+        const uint8_t FS = FPSIG_READS_FS;
+        const uint8_t FS_FT = FPSIG_READS_FS | FPSIG_READS_FT;
+        const uint8_t WIDE = is_double ? FPSIG_SOURCE_DOUBLE | FPSIG_RESULT_DOUBLE : 0;
+        const uint8_t SOURCE = is_double ? FPSIG_SOURCE_DOUBLE : 0;
+        table[FUNCT_FADD] = makeFPInfo(is_double ? "add.d" : "add.s", FORMAT_R, LAYOUT_FD_FS_FT, OP_FADD,
+                                       DEST_NONE, 0, FDEST_FD, FS_FT | WIDE, FPLAT_ADD);
+        table[FUNCT_FSUB] = makeFPInfo(is_double ? "sub.d" : "sub.s", FORMAT_R, LAYOUT_FD_FS_FT, OP_FSUB,
+                                       DEST_NONE, 0, FDEST_FD, FS_FT | WIDE, FPLAT_ADD);
+        table[FUNCT_FMUL] = makeFPInfo(is_double ? "mul.d" : "mul.s", FORMAT_R, LAYOUT_FD_FS_FT, OP_FMUL,
+                                       DEST_NONE, 0, FDEST_FD, FS_FT | WIDE, FPLAT_MUL);
+        table[FUNCT_FDIV] = makeFPInfo(is_double ? "div.d" : "div.s", FORMAT_R, LAYOUT_FD_FS_FT, OP_FDIV,
+                                       DEST_NONE, 0, FDEST_FD, FS_FT | WIDE, FPLAT_DIV);
+        table[FUNCT_FSQRT] = makeFPInfo(is_double ? "sqrt.d" : "sqrt.s", FORMAT_R, LAYOUT_FD_FS, OP_FSQRT,
+                                        DEST_NONE, 0, FDEST_FD, FS | WIDE, FPLAT_SQRT);
+        table[FUNCT_FABS] = makeFPInfo(is_double ? "abs.d" : "abs.s", FORMAT_R, LAYOUT_FD_FS, OP_FABS,
+                                       DEST_NONE, 0, FDEST_FD, FS | WIDE, FPLAT_MOVE);
+        table[FUNCT_FMOV] = makeFPInfo(is_double ? "mov.d" : "mov.s", FORMAT_R, LAYOUT_FD_FS, OP_FMOV,
+                                       DEST_NONE, 0, FDEST_FD, FS | WIDE, FPLAT_MOVE);
+        table[FUNCT_FNEG] = makeFPInfo(is_double ? "neg.d" : "neg.s", FORMAT_R, LAYOUT_FD_FS, OP_FNEG,
+                                       DEST_NONE, 0, FDEST_FD, FS | WIDE, FPLAT_MOVE);
+        if (is_double) {
+            table[FUNCT_CVT_S] = makeFPInfo("cvt.s.d", FORMAT_R, LAYOUT_FD_FS, OP_CVT_S,
+                                            DEST_NONE, 0, FDEST_FD, FS | SOURCE, FPLAT_CVT);
+        } else {
+            table[FUNCT_CVT_D] = makeFPInfo("cvt.d.s", FORMAT_R, LAYOUT_FD_FS, OP_CVT_D,
+                                            DEST_NONE, 0, FDEST_FD, FS | FPSIG_RESULT_DOUBLE, FPLAT_CVT);
+        }
+        table[FUNCT_CVT_W] = makeFPInfo(is_double ? "cvt.w.d" : "cvt.w.s", FORMAT_R, LAYOUT_FD_FS, OP_CVT_W,
+                                        DEST_NONE, 0, FDEST_FD, FS | SOURCE, FPLAT_CVT);
+        for (int cond = 0; cond < 16; cond++) {
+            table[FUNCT_FCMP + cond] = makeFPInfo(is_double ? FP_COMPARE_D[cond] : FP_COMPARE_S[cond],
+                                                  FORMAT_R, LAYOUT_FS_FT, OP_FCMP, DEST_NONE, 0,
+                                                  FDEST_CONDITION, FS_FT | SOURCE, FPLAT_CMP);
+        }
+    }
+    
+    constexpr DecodeTables makeDecodeTables() {
+        const uint8_t RS = SIG_READS_RS;
+        const uint8_t RT = SIG_READS_RT;
+        const uint8_t RS_RT = SIG_READS_RS | SIG_READS_RT;
+        DecodeTables tables = {};
+        
+        // Unassigned encodings decode as no-ops in their word layout
+        for (int i = 0; i < 64; i++) {
+            tables.opcode[i] = makeInfo("unknown", FORMAT_I, LAYOUT_RT_RS_IMM, OP_INVALID, DEST_NONE, RS_RT);
+            tables.funct[i] = makeInfo("unknown", FORMAT_R, LAYOUT_RD_RS_RT, OP_INVALID, DEST_NONE, RS_RT);
+        }
+        for (int i = 0; i < 32; i++) {
+            tables.regimm[i] = makeInfo("unknown", FORMAT_I, LAYOUT_RS_OFFSET, OP_INVALID, DEST_NONE, RS);
+            tables.cop1[i] = makeInfo("unknown", FORMAT_R, LAYOUT_NONE, OP_INVALID, DEST_NONE, 0);
+        }
+        for (int i = 0; i < 64; i++) {
+            tables.fpu_s[i] = makeInfo("unknown", FORMAT_R, LAYOUT_NONE, OP_INVALID, DEST_NONE, 0);
+            tables.fpu_d[i] = tables.fpu_s[i];
+            tables.fpu_w[i] = tables.fpu_s[i];
+        }
+        tables.opcode[OPCODE_RTYPE] = makeInfo("unknown", FORMAT_R, LAYOUT_RD_RS_RT, OP_INVALID, DEST_NONE, RS_RT);
+        
+        // R-type
+        tables.funct[FUNCT_SLL] = makeInfo("sll", FORMAT_R, LAYOUT_RD_RT_SA, OP_SLL, DEST_RD, RT);
+        tables.funct[FUNCT_SRL] = makeInfo("srl", FORMAT_R, LAYOUT_RD_RT_SA, OP_SRL, DEST_RD, RT);
+        tables.funct[FUNCT_SRA] = makeInfo("sra", FORMAT_R, LAYOUT_RD_RT_SA, OP_SRA, DEST_RD, RT);
+        tables.funct[FUNCT_SLLV] = makeInfo("sllv", FORMAT_R, LAYOUT_RD_RT_RS, OP_SLLV, DEST_RD, RS_RT);
+        tables.funct[FUNCT_SRLV] = makeInfo("srlv", FORMAT_R, LAYOUT_RD_RT_RS, OP_SRLV, DEST_RD, RS_RT);
+        tables.funct[FUNCT_SRAV] = makeInfo("srav", FORMAT_R, LAYOUT_RD_RT_RS, OP_SRAV, DEST_RD, RS_RT);
+        tables.funct[FUNCT_JR] = makeInfo("jr", FORMAT_R, LAYOUT_RS, OP_JR, DEST_NONE, SIG_JUMP | RS);
+        tables.funct[FUNCT_JALR] = makeInfo("jalr", FORMAT_R, LAYOUT_RD_RS, OP_JALR, DEST_RD, SIG_JUMP | RS);
+        tables.funct[FUNCT_SYSCALL] = makeInfo("syscall", FORMAT_R, LAYOUT_NONE, OP_SYSCALL, DEST_NONE, 0);
+        tables.funct[FUNCT_BREAK] = makeInfo("break", FORMAT_R, LAYOUT_NONE, OP_BREAK, DEST_NONE, 0);
+        tables.funct[FUNCT_MFHI] = makeInfo("mfhi", FORMAT_R, LAYOUT_RD, OP_MFHI, DEST_RD, 0);
+        tables.funct[FUNCT_MTHI] = makeInfo("mthi", FORMAT_R, LAYOUT_RS, OP_MTHI, DEST_NONE, RS);
+        tables.funct[FUNCT_MFLO] = makeInfo("mflo", FORMAT_R, LAYOUT_RD, OP_MFLO, DEST_RD, 0);
+        tables.funct[FUNCT_MTLO] = makeInfo("mtlo", FORMAT_R, LAYOUT_RS, OP_MTLO, DEST_NONE, RS);
+        tables.funct[FUNCT_MULT] = makeInfo("mult", FORMAT_R, LAYOUT_RS_RT, OP_MULT, DEST_NONE, RS_RT);
+        tables.funct[FUNCT_MULTU] = makeInfo("multu", FORMAT_R, LAYOUT_RS_RT, OP_MULTU, DEST_NONE, RS_RT);
+        tables.funct[FUNCT_DIV] = makeInfo("div", FORMAT_R, LAYOUT_RS_RT, OP_DIV, DEST_NONE, RS_RT);
+        tables.funct[FUNCT_DIVU] = makeInfo("divu", FORMAT_R, LAYOUT_RS_RT, OP_DIVU, DEST_NONE, RS_RT);
+        tables.funct[FUNCT_ADD] = makeInfo("add", FORMAT_R, LAYOUT_RD_RS_RT, OP_ADD, DEST_RD, RS_RT);
+        tables.funct[FUNCT_ADDU] = makeInfo("addu", FORMAT_R, LAYOUT_RD_RS_RT, OP_ADDU, DEST_RD, RS_RT);
+        tables.funct[FUNCT_SUB] = makeInfo("sub", FORMAT_R, LAYOUT_RD_RS_RT, OP_SUB, DEST_RD, RS_RT);
+        tables.funct[FUNCT_SUBU] = makeInfo("subu", FORMAT_R, LAYOUT_RD_RS_RT, OP_SUBU, DEST_RD, RS_RT);
+        tables.funct[FUNCT_AND] = makeInfo("and", FORMAT_R, LAYOUT_RD_RS_RT, OP_AND, DEST_RD, RS_RT);
+        tables.funct[FUNCT_OR] = makeInfo("or", FORMAT_R, LAYOUT_RD_RS_RT, OP_OR, DEST_RD, RS_RT);
+        tables.funct[FUNCT_XOR] = makeInfo("xor", FORMAT_R, LAYOUT_RD_RS_RT, OP_XOR, DEST_RD, RS_RT);
+        tables.funct[FUNCT_NOR] = makeInfo("nor", FORMAT_R, LAYOUT_RD_RS_RT, OP_NOR, DEST_RD, RS_RT);
+        tables.funct[FUNCT_SLT] = makeInfo("slt", FORMAT_R, LAYOUT_RD_RS_RT, OP_SLT, DEST_RD, RS_RT);
+        tables.funct[FUNCT_SLTU] = makeInfo("sltu", FORMAT_R, LAYOUT_RD_RS_RT, OP_SLTU, DEST_RD, RS_RT);
+        
+        // REGIMM branches; the -al forms link even when not taken
+        tables.regimm[REGIMM_BLTZ] = makeInfo("bltz", FORMAT_I, LAYOUT_RS_OFFSET, OP_BLTZ, DEST_NONE, SIG_BRANCH | RS);
+        tables.regimm[REGIMM_BGEZ] = makeInfo("bgez", FORMAT_I, LAYOUT_RS_OFFSET, OP_BGEZ, DEST_NONE, SIG_BRANCH | RS);
+        tables.regimm[REGIMM_BLTZAL] = makeInfo("bltzal", FORMAT_I, LAYOUT_RS_OFFSET, OP_BLTZAL, DEST_RA,
+                                                SIG_BRANCH | RS);
+        tables.regimm[REGIMM_BGEZAL] = makeInfo("bgezal", FORMAT_I, LAYOUT_RS_OFFSET, OP_BGEZAL, DEST_RA,
+                                                SIG_BRANCH | RS);
+        
+        // I-type
+        tables.opcode[OPCODE_BEQ] = makeInfo("beq", FORMAT_I, LAYOUT_RS_RT_OFFSET, OP_BEQ, DEST_NONE, SIG_BRANCH | RS_RT);
+        tables.opcode[OPCODE_BNE] = makeInfo("bne", FORMAT_I, LAYOUT_RS_RT_OFFSET, OP_BNE, DEST_NONE, SIG_BRANCH | RS_RT);
+        tables.opcode[OPCODE_BLEZ] = makeInfo("blez", FORMAT_I, LAYOUT_RS_OFFSET, OP_BLEZ, DEST_NONE, SIG_BRANCH | RS);
+        tables.opcode[OPCODE_BGTZ] = makeInfo("bgtz", FORMAT_I, LAYOUT_RS_OFFSET, OP_BGTZ, DEST_NONE, SIG_BRANCH | RS);
+        tables.opcode[OPCODE_ADDI] = makeInfo("addi", FORMAT_I, LAYOUT_RT_RS_IMM, OP_ADDI, DEST_RT, RS);
+        tables.opcode[OPCODE_ADDIU] = makeInfo("addiu", FORMAT_I, LAYOUT_RT_RS_IMM, OP_ADDIU, DEST_RT, RS);
+        tables.opcode[OPCODE_SLTI] = makeInfo("slti", FORMAT_I, LAYOUT_RT_RS_IMM, OP_SLTI, DEST_RT, RS);
+        tables.opcode[OPCODE_SLTIU] = makeInfo("sltiu", FORMAT_I, LAYOUT_RT_RS_IMM, OP_SLTIU, DEST_RT, RS);
+        tables.opcode[OPCODE_ANDI] = makeInfo("andi", FORMAT_I, LAYOUT_RT_RS_HEX, OP_ANDI, DEST_RT, RS);
+        tables.opcode[OPCODE_ORI] = makeInfo("ori", FORMAT_I, LAYOUT_RT_RS_HEX, OP_ORI, DEST_RT, RS);
+        tables.opcode[OPCODE_XORI] = makeInfo("xori", FORMAT_I, LAYOUT_RT_RS_HEX, OP_XORI, DEST_RT, RS);
+        tables.opcode[OPCODE_LUI] = makeInfo("lui", FORMAT_I, LAYOUT_RT_HEX, OP_LUI, DEST_RT, 0);
+        tables.opcode[OPCODE_LB] = makeInfo("lb", FORMAT_I, LAYOUT_RT_OFFSET_BASE, OP_LB, DEST_RT, SIG_MEM_READ | RS);
+        tables.opcode[OPCODE_LH] = makeInfo("lh", FORMAT_I, LAYOUT_RT_OFFSET_BASE, OP_LH, DEST_RT, SIG_MEM_READ | RS);
+        tables.opcode[OPCODE_LWL] = makeInfo("lwl", FORMAT_I, LAYOUT_RT_OFFSET_BASE, OP_LWL, DEST_RT,
+                                             SIG_MEM_READ | RS_RT);
+        tables.opcode[OPCODE_LW] = makeInfo("lw", FORMAT_I, LAYOUT_RT_OFFSET_BASE, OP_LW, DEST_RT, SIG_MEM_READ | RS);
+        tables.opcode[OPCODE_LBU] = makeInfo("lbu", FORMAT_I, LAYOUT_RT_OFFSET_BASE, OP_LBU, DEST_RT, SIG_MEM_READ | RS);
+        tables.opcode[OPCODE_LHU] = makeInfo("lhu", FORMAT_I, LAYOUT_RT_OFFSET_BASE, OP_LHU, DEST_RT, SIG_MEM_READ | RS);
+        tables.opcode[OPCODE_LWR] = makeInfo("lwr", FORMAT_I, LAYOUT_RT_OFFSET_BASE, OP_LWR, DEST_RT,
+                                             SIG_MEM_READ | RS_RT);
+        tables.opcode[OPCODE_SB] = makeInfo("sb", FORMAT_I, LAYOUT_RT_OFFSET_BASE, OP_SB, DEST_NONE, SIG_MEM_WRITE | RS_RT);
+        tables.opcode[OPCODE_SH] = makeInfo("sh", FORMAT_I, LAYOUT_RT_OFFSET_BASE, OP_SH, DEST_NONE, SIG_MEM_WRITE | RS_RT);
+        tables.opcode[OPCODE_SWL] = makeInfo("swl", FORMAT_I, LAYOUT_RT_OFFSET_BASE, OP_SWL, DEST_NONE,
+                                             SIG_MEM_WRITE | RS_RT);
+        tables.opcode[OPCODE_SW] = makeInfo("sw", FORMAT_I, LAYOUT_RT_OFFSET_BASE, OP_SW, DEST_NONE, SIG_MEM_WRITE | RS_RT);
+        tables.opcode[OPCODE_SWR] = makeInfo("swr", FORMAT_I, LAYOUT_RT_OFFSET_BASE, OP_SWR, DEST_NONE,
+                                             SIG_MEM_WRITE | RS_RT);
+        
+        // J-type
+        tables.opcode[OPCODE_J] = makeInfo("j", FORMAT_J, LAYOUT_TARGET, OP_J, DEST_NONE, SIG_JUMP);
+        tables.opcode[OPCODE_JAL] = makeInfo("jal", FORMAT_J, LAYOUT_TARGET, OP_JAL, DEST_RA, SIG_JUMP);
+        
+        // Coprocessor 1 moves, loads/stores and condition branches
+        const uint8_t FS = FPSIG_READS_FS;
+        const uint8_t FT = FPSIG_READS_FT;
+        tables.cop1[COP1_MF] = makeFPInfo("mfc1", FORMAT_R, LAYOUT_RT_FS, OP_MFC1, DEST_RT, 0,
+                                          FDEST_NONE, FS, FPLAT_NONE);
+        tables.cop1[COP1_CF] = makeFPInfo("cfc1", FORMAT_R, LAYOUT_RT_FCR, OP_CFC1, DEST_RT, 0,
+                                          FDEST_NONE, FPSIG_READS_CONDITION, FPLAT_NONE);
+        tables.cop1[COP1_MT] = makeFPInfo("mtc1", FORMAT_R, LAYOUT_RT_FS, OP_MTC1, DEST_NONE, RT,
+                                          FDEST_FS, 0, FPLAT_MOVE);
+        tables.cop1[COP1_CT] = makeFPInfo("ctc1", FORMAT_R, LAYOUT_RT_FCR, OP_CTC1, DEST_NONE, RT,
+                                          FDEST_CONDITION, 0, FPLAT_MOVE);
+        tables.cop1_branch[0] = makeFPInfo("bc1f", FORMAT_I, LAYOUT_OFFSET, OP_BC1F, DEST_NONE, SIG_BRANCH,
+                                           FDEST_NONE, FPSIG_READS_CONDITION, FPLAT_NONE);
+        tables.cop1_branch[1] = makeFPInfo("bc1t", FORMAT_I, LAYOUT_OFFSET, OP_BC1T, DEST_NONE, SIG_BRANCH,
+                                           FDEST_NONE, FPSIG_READS_CONDITION, FPLAT_NONE);
+        tables.opcode[OPCODE_COP1] = makeInfo("unknown", FORMAT_R, LAYOUT_NONE, OP_INVALID, DEST_NONE, 0);
+        tables.opcode[OPCODE_LWC1] = makeFPInfo("lwc1", FORMAT_I, LAYOUT_FT_OFFSET_BASE, OP_LWC1, DEST_NONE,
+                                                SIG_MEM_READ | RS, FDEST_FT, 0, FPLAT_LOAD);
+        tables.opcode[OPCODE_LDC1] = makeFPInfo("ldc1", FORMAT_I, LAYOUT_FT_OFFSET_BASE, OP_LDC1, DEST_NONE,
+                                                SIG_MEM_READ | RS, FDEST_FT, FPSIG_RESULT_DOUBLE, FPLAT_LOAD);
+        tables.opcode[OPCODE_SWC1] = makeFPInfo("swc1", FORMAT_I, LAYOUT_FT_OFFSET_BASE, OP_SWC1, DEST_NONE,
+                                                SIG_MEM_WRITE | RS, FDEST_NONE, FT, FPLAT_NONE);
+        tables.opcode[OPCODE_SDC1] = makeFPInfo("sdc1", FORMAT_I, LAYOUT_FT_OFFSET_BASE, OP_SDC1, DEST_NONE,
+                                                SIG_MEM_WRITE | RS, FDEST_NONE, FT | FPSIG_SOURCE_DOUBLE,
+                                                FPLAT_NONE);
+        
+        // COP1 arithmetic, conversions and compares
+        fillFPUTable(tables.fpu_s, false);
+        fillFPUTable(tables.fpu_d, true);
+        tables.fpu_w[FUNCT_CVT_S] = makeFPInfo("cvt.s.w", FORMAT_R, LAYOUT_FD_FS, OP_CVT_S, DEST_NONE, 0,
+                                               FDEST_FD, FS, FPLAT_CVT);
+        tables.fpu_w[FUNCT_CVT_D] = makeFPInfo("cvt.d.w", FORMAT_R, LAYOUT_FD_FS, OP_CVT_D, DEST_NONE, 0,
+                                               FDEST_FD, FS | FPSIG_RESULT_DOUBLE, FPLAT_CVT);
+        return tables;
+    }
+    
+    inline constexpr DecodeTables DECODE_TABLES = makeDecodeTables();
 }
 
 class InstructionDecoder {
 public:
+    // Longest text disassemble() can produce, including the terminator
+    static const size_t MAX_DISASSEMBLY_LENGTH = 48;
+    
+    // Table entry for an instruction word: the funct table for R-type,
+    // the rt table for REGIMM, the COP1 tables for opcode 0x11, the opcode
+    // table otherwise
+    static const MIPS::InstructionInfo& info(uint32_t instruction) {
+        uint8_t opcode = (instruction >> 26) & 0x3F;
+        if (opcode == MIPS::OPCODE_RTYPE) {
+            return MIPS::DECODE_TABLES.funct[instruction & 0x3F];
+        }
+        if (opcode == MIPS::OPCODE_REGIMM) {
+            return MIPS::DECODE_TABLES.regimm[(instruction >> 16) & 0x1F];
+        }
+        if (opcode == MIPS::OPCODE_COP1) {
+            return cop1Info(instruction);
+        }
+        return MIPS::DECODE_TABLES.opcode[opcode];
+    }
+    
+    static const MIPS::InstructionInfo& cop1Info(uint32_t instruction) {
+        switch ((instruction >> 21) & 0x1F) {
+            case MIPS::COP1_FMT_S: return MIPS::DECODE_TABLES.fpu_s[instruction & 0x3F];
+            case MIPS::COP1_FMT_D: return MIPS::DECODE_TABLES.fpu_d[instruction & 0x3F];
+            case MIPS::COP1_FMT_W: return MIPS::DECODE_TABLES.fpu_w[instruction & 0x3F];
+            case MIPS::COP1_BC: return MIPS::DECODE_TABLES.cop1_branch[(instruction >> 16) & 1];
+            default: return MIPS::DECODE_TABLES.cop1[(instruction >> 21) & 0x1F];
+        }
+    }
+    
+    // Register the instruction writes back, 0 when it writes none
+    static uint8_t destinationRegister(uint32_t instruction) {
+        switch (info(instruction).control.destination) {
+            case MIPS::DEST_RD: return (instruction >> 11) & 0x1F;
+            case MIPS::DEST_RT: return (instruction >> 16) & 0x1F;
+            case MIPS::DEST_RA: return MIPS::REG_RA;
+            default: return 0;
+        }
+    }
+    
     static std::string getInstructionName(uint32_t instruction);
     static std::string disassemble(uint32_t instruction);
     static std::string getRegisterName(int reg);
+    
+    // Allocation-free variants. Names point into static tables; disassemble()
+    // writes into the caller's buffer, always NUL-terminates it (size > 0)
+    // and returns the number of characters written.
+    static const char* mnemonic(uint32_t instruction);
+    static const char* registerName(int reg);
+    static const char* fpRegisterName(int reg);
+    static size_t disassemble(uint32_t instruction, char* buffer, size_t size);
+    template <size_t N>
+    static size_t disassemble(uint32_t instruction, char (&buffer)[N]) {
+        return disassemble(instruction, buffer, N);
+    }
+    
+    // Bulk disassembly of a big-endian program image, one
+    // "0xADDRESS: 0xWORD  text" line per word. The buffer must hold
+    // imageTextCapacity(size) bytes; large images are split across threads
+    // (0 = one per host core) and the chunks are compacted in order.
+    static size_t imageTextCapacity(size_t size);
+    static size_t disassembleImage(const uint8_t* image, size_t size, uint32_t base_address,
+                                   char* buffer, size_t buffer_size, unsigned threads = 0);
+    static std::string disassembleImage(const uint8_t* image, size_t size, uint32_t base_address,
+                                        unsigned threads = 0);
+    
     static bool isRType(uint8_t opcode);
     static bool isIType(uint8_t opcode);
     static bool isJType(uint8_t opcode);
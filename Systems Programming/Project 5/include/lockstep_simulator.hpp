@@ -0,0 +1,87 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "instruction_decoder.hpp"
+
+// Runs many independent copies of one program in lock-step. Lanes are
+// processed in groups of VECTOR_LANES: a group issues one instruction for
+// every lane whose PC equals the group's lowest PC, so diverged lanes wait
+// and rejoin at the first common PC. Register state is stored per register
+// across lanes, so ALU operations work on whole vectors (AVX2 when built
+// with MIPS_LOCKSTEP_AVX2, a scalar loop otherwise).
+//
+// Every lane has private registers, HI/LO and data memory; instructions
+// are fetched from the shared program image, so self-modifying code is
+// not supported.
+class LockstepSimulator {
+public:
+    static const int VECTOR_LANES = 8;
+
+    struct LockstepStats {
+        uint64_t group_steps;       // Instructions issued by lane groups
+        uint64_t lane_instructions; // Instructions retired summed over lanes
+        uint64_t divergent_steps;   // Issues with some active lanes waiting
+        uint64_t lanes_halted;
+    };
+
+    LockstepSimulator(int lanes, uint32_t memory_size = 65536);
+    ~LockstepSimulator();
+
+    bool loadProgram(const std::string& filename);
+    bool loadProgramFromString(const std::string& program);
+    bool loadProgramImage(const std::vector<uint8_t>& program);
+    void reset();
+
+    // Run every lane until it halts, issuing at most max_steps
+    // instructions per group. Returns instructions retired over all lanes.
+    uint64_t run(uint64_t max_steps = UINT64_MAX);
+
+    // Per-lane state access
+    int getLaneCount() const;
+    uint32_t getRegister(int lane, int reg) const;
+    void setRegister(int lane, int reg, uint32_t value);
+    uint32_t getMemory(int lane, uint32_t address) const;
+    void setMemory(int lane, uint32_t address, uint32_t value);
+    uint32_t getPC(int lane) const;
+    bool isHalted(int lane) const;
+
+    LockstepStats getStats() const;
+    std::string getStatsString() const;
+
+    // True when the vector paths were compiled for AVX2
+    static bool usesAVX2();
+
+private:
+    struct DecodedInstruction {
+        const MIPS::InstructionInfo* info;
+        uint8_t rs, rt, rd, shamt;
+        uint32_t imm_extended;
+        uint16_t immediate;
+        uint32_t jump_addr;
+    };
+
+    int lane_count;
+    int padded_lanes; // Rounded up to whole groups
+    uint32_t memory_size;
+
+    // Structure-of-arrays state: registers[reg * padded_lanes + lane]
+    std::vector<uint32_t> registers;
+    std::vector<uint32_t> hi, lo;
+    std::vector<uint32_t> pcs;
+    std::vector<uint8_t> halted;
+    std::vector<uint8_t> memory; // memory_size bytes per lane
+
+    std::vector<uint8_t> image;
+    std::vector<DecodedInstruction> decoded;
+    LockstepStats stats;
+
+    bool storeImage(const std::string& program);
+    void predecodeImage();
+    uint64_t runGroup(int group, uint64_t max_steps);
+    uint32_t* reg(int r, int base) { return &registers[(size_t)r * padded_lanes + base]; }
+    uint8_t* laneMemory(int lane) { return &memory[(size_t)lane * memory_size]; }
+    const uint8_t* laneMemory(int lane) const { return &memory[(size_t)lane * memory_size]; }
+    bool loadLane(int lane, uint32_t address, uint32_t size, uint32_t& value) const;
+    bool storeLane(int lane, uint32_t address, uint32_t size, uint32_t value);
+};
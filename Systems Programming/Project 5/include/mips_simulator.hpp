@@ -4,9 +4,23 @@
 #include <string>
 #include <cstdint>
 #include <memory>
+#include <csignal>
+#include "pipeline.hpp"
+#include "branch_predictor.hpp"
+#include "branch_target_predictor.hpp"
+#include "instruction_decoder.hpp"
+#include "fpu.hpp"
+#include "trace_writer.hpp"
+#include "timeline_writer.hpp"
+#include "profiler.hpp"
+#include "cache_model.hpp"
+#include "hazard_scoreboard.hpp"
 
 class MIPSSimulator {
 public:
+    // Granularity of memory copies in checkpoints
+    static const uint32_t PAGE_SIZE = 4096;
+    
     // Constructor and destructor
     MIPSSimulator();
     ~MIPSSimulator();
@@ -14,10 +28,44 @@ public:
     // Main execution methods
     bool loadProgram(const std::string& filename);
     bool loadProgramFromString(const std::string& program);
+    bool loadProgramImage(const std::vector<uint8_t>& image); // e.g. from the Assembler
+    
+    // Save registers, PC, FPU, memory, predictor tables, pipeline latches
+    // and statistics to a file (see CheckpointFile), to resume later from
+    // the same point. Loading requires the pipeline and branch predictor
+    // settings the file was saved with and leaves the simulator unchanged
+    // on failure; timing parameters, breakpoints and watchpoints keep
+    // their current values, and a new reverse-execution history starts.
+    bool saveCheckpoint(const std::string& filename) const;
+    bool loadCheckpoint(const std::string& filename);
     void reset();
+    // Why the last step() or run() stopped
+    enum StopReason {
+        STOP_NONE,       // step() retired its instruction
+        STOP_HALTED,
+        STOP_BREAKPOINT,
+        STOP_WATCHPOINT,
+        STOP_INTERRUPTED,  // requestStop()
+        STOP_ADDRESS_ERROR // Unaligned or out-of-memory load or store
+    };
+    
     bool step();
-    void run();
+    StopReason run();
+    // Make the next step() stop before its instruction, and run() within a
+    // few thousand instructions (at once with reverse execution on). Safe
+    // to call from a signal handler.
+    void requestStop();
     bool isHalted() const;
+    StopReason getStopReason() const;
+    // The access that stopped execution with STOP_ADDRESS_ERROR
+    struct AddressError {
+        uint32_t pc;
+        uint32_t address;
+        uint32_t size; // Bytes; halfword and word accesses must be aligned to it
+        bool write;
+    };
+    const AddressError& getAddressError() const;
+    std::string getAddressErrorString() const;
     
     // State access methods
     uint32_t getRegister(int reg) const;
@@ -25,49 +73,293 @@ public:
     uint32_t getMemory(uint32_t address) const;
     void setMemory(uint32_t address, uint32_t value);
     uint32_t getPC() const;
+    uint32_t getHI() const;
+    uint32_t getLO() const;
+    FPU& getFPU();
+    const FPU& getFPU() const;
     void setPC(uint32_t pc);
     
     // Pipeline and statistics
     void enablePipeline(bool enable);
-    void enableBranchPrediction(bool enable, const std::string& type = "static");
+    bool enableBranchPrediction(bool enable, const std::string& type = "static");
+    void enableLoopPredictor(bool enable);
     std::string getStateString() const;
     std::string getPipelineStateString() const;
     std::string getBranchPredictionStats() const;
     
+    // Extra fetch bubbles charged after a misprediction flush, and the
+    // top-N branches by mispredictions with their disassembly
+    void setMispredictPenalty(int cycles);
+    int getMispredictPenalty() const;
+    std::string getBranchProfileString(int top_n = 10) const;
+    
+    // Multiply/divide unit timing in pipeline mode: cycles until HI/LO
+    // hold the result, and whether a new operation may start every cycle
+    // (pipelined) or must wait for the previous one to finish
+    void setMulDivLatency(int multiply_cycles, int divide_cycles);
+    void setMulDivPipelined(bool pipelined);
+    
+    // FPU result latency for one class (move, add, mul, div, sqrt, cvt,
+    // cmp, load), optionally limited to one precision with a ".s" or ".d"
+    // suffix. Divide and square root share one unpipelined unit.
+    bool setFPLatency(const std::string& name, int cycles);
+    
+    // Disassemble the words from start through end (inclusive) into one
+    // buffer; large ranges are formatted on several threads
+    std::string disassembleRange(uint32_t start, uint32_t end, unsigned threads = 0) const;
+    
+    // Append every resolved conditional branch to trace (nullptr stops recording)
+    void setBranchTrace(std::vector<BranchPredictor::BranchRecord>* trace);
+    
+    // Record every retired instruction to a binary trace file (see
+    // TraceWriter). stopTrace() flushes it and returns false on a write error.
+    bool startTrace(const std::string& filename);
+    bool stopTrace();
+    bool isTracing() const;
+    uint64_t getTraceRecordCount() const;
+    uint64_t getTraceByteCount() const;
+    
+    // Per-cycle stage occupancy, stalls and flushes in the Chrome trace
+    // format (see TimelineWriter), pipeline mode only; turning the pipeline
+    // off ends it. stopTimeline() returns false on a write error.
+    bool startTimeline(const std::string& filename);
+    bool stopTimeline();
+    bool isRecordingTimeline() const;
+    uint64_t getTimelineEventCount() const;
+    
+    // Per-instruction profile (see Profiler): executions per address, plus
+    // cycles and stalls in pipeline mode, and call paths for collapsed
+    // stacks. Enabling, reset() and switching the pipeline start a new one.
+    void enableProfiling(bool enable);
+    bool isProfiling() const;
+    std::string getProfileString(int top_n = 10) const;
+    bool writeCollapsedStacks(const std::string& filename) const;
+    
+    // Event counters of the simulated core, counted in both models. The
+    // execute path bumps plain integers; loads, stores, branches, jumps and
+    // the instruction total are derived from the class mix when read, and
+    // cycles equal instructions in the functional model. reset() and
+    // switching the pipeline zero them, and they are not rewound.
+    enum InstructionClass {
+        CLASS_ALU,
+        CLASS_MULDIV, // Multiply, divide and HI/LO moves
+        CLASS_LOAD,   // Including FP loads
+        CLASS_STORE,  // Including FP stores
+        CLASS_BRANCH, // Conditional
+        CLASS_JUMP,
+        CLASS_FP,
+        CLASS_SYSTEM, // SYSCALL, BREAK and invalid words
+        CLASS_COUNT
+    };
+    struct PerfCounters {
+        uint64_t cycles;
+        uint64_t instructions;
+        uint64_t loads;
+        uint64_t stores;
+        uint64_t branches;
+        uint64_t taken_branches;
+        uint64_t jumps;
+        uint64_t mispredicts;     // Fetch redirects
+        uint64_t stall_cycles;    // Sum of the four causes below
+        uint64_t load_use_stalls;
+        uint64_t hilo_stalls;
+        uint64_t fp_stalls;
+        uint64_t redirect_stalls; // Mispredict penalty bubbles
+        uint64_t icache_accesses;
+        uint64_t icache_misses;
+        uint64_t dcache_accesses;
+        uint64_t dcache_misses;
+        uint64_t class_counts[CLASS_COUNT];
+    };
+    PerfCounters getPerfCounters() const;
+    void resetPerfCounters();
+    std::string getPerfCountersString() const;
+    std::string getPerfCountersJSON() const;
+    static const char* getClassName(InstructionClass instruction_class);
+    
+    // Tag-only caches (see CacheModel) looked up by every executed fetch,
+    // load and store, for the miss counters; they do not add cycles.
+    // config is "SIZE[k]:WAYS:LINE" or "off".
+    bool configureCache(bool instruction, const std::string& config);
+    
     // Execution modes
     void setStepMode(bool step_mode);
     bool getStepMode() const;
+    
+    // Reverse execution, functional model only. While enabled, step() and
+    // run() count retired instructions and checkpoint the CPU state every
+    // few thousand of them; a memory page is copied the first time it is
+    // stored to after a checkpoint. Stepping back restores the nearest
+    // earlier checkpoint and re-executes forward, and the spacing adapts
+    // so that takes well under a millisecond. Predictor statistics are not
+    // rewound. Editing registers, memory or the PC starts a new history.
+    bool enableReverseExecution(bool enable); // false in pipeline mode
+    bool isReverseExecutionEnabled() const;
+    uint64_t getRetiredCount() const;
+    bool reverseStep(uint64_t count = 1);     // false past the start of history
+    bool reverseContinue();                   // Back to the last breakpoint stop
+    
+    // Breakpoints, functional model only. The predecoded word at a
+    // breakpoint address is swapped for a trap, so only that instruction
+    // checks anything and run() is unchanged when none are set. A stop
+    // leaves the instruction unexecuted; the next step() or run() executes
+    // the instruction at the current PC before trapping again.
+    struct Breakpoint {
+        uint32_t address;
+        int reg;        // Stop only if this register equals value; -1 always
+        uint32_t value;
+    };
+    bool addBreakpoint(uint32_t address, int reg = -1, uint32_t value = 0);
+    bool removeBreakpoint(uint32_t address);
+    void clearBreakpoints();
+    const std::vector<Breakpoint>& getBreakpoints() const;
+    bool isAtBreakpoint() const; // The last step() or run() stopped at one
+    
+    // Watchpoints, functional model only. Each memory page has a watched
+    // bit per access kind, so loads and stores to other pages pay a single
+    // branch; on a watched page the exact ranges are checked. A hit lets
+    // the instruction complete and then stops with STOP_WATCHPOINT.
+    struct Watchpoint {
+        uint32_t address;
+        uint32_t size; // 1, 2 or 4 bytes
+        bool read;
+        bool write;
+    };
+    struct WatchHit {
+        uint32_t pc;             // Instruction that made the access
+        uint32_t address;        // Watchpoint address
+        uint32_t access_address;
+        bool write;
+        uint32_t old_value;      // Watched bytes before and after the access
+        uint32_t new_value;
+    };
+    bool addWatchpoint(uint32_t address, uint32_t size = 4, bool read = false, bool write = true);
+    bool removeWatchpoint(uint32_t address);
+    void clearWatchpoints();
+    const std::vector<Watchpoint>& getWatchpoints() const;
+    const WatchHit& getWatchHit() const; // The most recent hit
 
 private:
     // Core components
     std::vector<uint32_t> registers;
     std::vector<uint8_t> memory;
+    uint32_t hi, lo; // Multiply/divide results
+    FPU fpu;
+    bool fpu_used; // Show FP state once a COP1 instruction has run
     uint32_t pc;
     bool halted;
     bool step_mode;
     
     // Pipeline components
     bool pipeline_enabled;
-    struct PipelineStage {
-        uint32_t instruction;
-        uint32_t pc;
-        bool valid;
-        bool stall;
-        bool flush;
-    };
+    Pipeline pipeline;
+    uint32_t fetch_pc;
+    int mispredict_penalty;
+    int redirect_stall;
+    struct PipelineStats {
+        uint64_t cycles;
+        uint64_t instructions;
+        uint64_t stall_cycles;
+        uint64_t flushes;
+        uint64_t hilo_stalls; // Part of stall_cycles
+        uint64_t fp_stalls;   // Part of stall_cycles
+    } pipeline_stats;
     
-    std::vector<PipelineStage> pipeline_stages;
+    // Multi-cycle units; the state before the last issue is restored if
+    // that instruction turns out to be on the wrong path
+    HazardScoreboard scoreboard;
+    HazardScoreboard::State scoreboard_before_issue;
     
     // Branch prediction
     bool branch_prediction_enabled;
-    std::string prediction_type;
-    std::map<uint32_t, bool> branch_history_table;
+    BranchPredictor branch_predictor;
     struct BranchStats {
-        int total_branches;
-        int correct_predictions;
-        int incorrect_predictions;
+        int fetch_redirects;
+        uint64_t cycles_lost;
     } branch_stats;
     
+    // Per-branch counters, indexed by PC / 4
+    struct BranchProfileEntry {
+        uint64_t executions;
+        uint64_t taken;
+        uint64_t mispredicts;
+        uint64_t cycles_lost;
+    };
+    std::vector<BranchProfileEntry> branch_profile;
+    BranchTargetPredictor target_predictor;
+    std::vector<BranchPredictor::BranchRecord>* branch_trace;
+    std::unique_ptr<TraceWriter> trace_writer; // Null unless tracing
+    uint64_t trace_records, trace_bytes;       // Totals of the last closed trace
+    std::unique_ptr<Profiler> profiler;        // Null unless profiling
+    std::unique_ptr<TimelineWriter> timeline_writer; // Null unless recording
+    uint64_t timeline_events;                  // Total of the last closed timeline
+    
+    // Counted directly; the derived fields of PerfCounters stay zero here
+    PerfCounters perf;
+    CacheModel instruction_cache;
+    CacheModel data_cache;
+    bool caches_enabled; // Either cache is configured
+    
+    // Reverse execution history. Each checkpoint keeps the contents, as of
+    // that checkpoint, of the pages stored to before the next one, so
+    // restoring one applies the page copies of it and every later
+    // checkpoint, newest first. Blocks of the branch profile are kept the
+    // same way, so a rewind also forgets the branches it undoes.
+    struct TrainedPredictors {
+        BranchPredictor branch;
+        BranchTargetPredictor target;
+    };
+    struct Checkpoint {
+        uint64_t position; // Instructions retired
+        uint32_t registers[32];
+        uint32_t hi, lo, pc;
+        FPU fpu;
+        bool fpu_used;
+        std::vector<uint32_t> pages;
+        std::vector<uint8_t> page_data; // PAGE_SIZE bytes per entry of pages
+        BranchStats branch_stats;
+        std::unique_ptr<TrainedPredictors> predictors; // Null unless predicting
+        std::vector<uint32_t> profile_blocks;
+        std::vector<BranchProfileEntry> profile_data; // PROFILE_BLOCK entries per block
+    };
+    static const size_t MAX_CHECKPOINTS = 512;
+    static const uint32_t PROFILE_BLOCK = 64;
+    bool history_enabled;
+    std::vector<Checkpoint> checkpoints;
+    std::vector<uint8_t> page_saved;    // Page already copied into the newest checkpoint
+    std::vector<uint8_t> profile_saved; // Same for blocks of branch_profile
+    uint64_t retired;
+    uint64_t next_checkpoint;
+    uint64_t checkpoint_interval;
+    
+    // Breakpoints; predecoded entries at their addresses point at TRAP_INFO
+    static const MIPS::InstructionInfo TRAP_INFO;
+    std::vector<Breakpoint> breakpoints;
+    StopReason stop_reason;
+    volatile std::sig_atomic_t stop_requested;
+    bool stops_suspended; // Replaying history
+    uint32_t resume_pc;   // Execute rather than trap here once
+    
+    // Watchpoints; page_watch holds the access kinds watched on each page,
+    // including pages whose last bytes start an access reaching a watch
+    enum WatchKind : uint8_t {
+        WATCH_READ = 1,
+        WATCH_WRITE = 2
+    };
+    std::vector<Watchpoint> watchpoints;
+    std::vector<uint8_t> page_watch;
+    WatchHit watch_hit;
+    AddressError address_error;
+    bool watch_seen; // A watched access happened, even while stops are suspended
+    
+    // step() dispatches through an instantiation for the active predictor
+    // policy, so the branch path never re-checks the predictor type. run()
+    // uses the fusing instantiation; step() always retires one instruction.
+    bool (MIPSSimulator::*step_function)();
+    bool (MIPSSimulator::*run_function)();
+    void selectStepFunction();
+    template <typename Policy> void useStepFunctions();
+    
     // Instruction processing
     struct Instruction {
         uint32_t raw;
@@ -77,24 +369,99 @@ private:
         uint32_t jump_addr;
         uint8_t funct;
         uint8_t shamt;
-        std::string type; // "R", "I", "J"
+        uint8_t fusion;       // Fusion with the next word, see Fusion
+        uint8_t dest;         // GPR written, 0 if none
+        uint8_t trace_flags;  // TraceWriter flags other than TRACE_TAKEN
+        uint8_t perf_class;   // InstructionClass
+        uint32_t fused_value; // Constant built by FUSE_LUI_ORI
+        const MIPS::InstructionInfo* info; // Decode table entry
     };
     
+    // Idioms executed as one micro-op by run() in the functional model
+    enum Fusion : uint8_t {
+        FUSE_NONE,
+        FUSE_LUI_ORI,        // lui rX, hi; ori rX, rX, lo
+        FUSE_COMPARE_BRANCH, // slt(i)(u) rX, ...; beq/bne on rX
+        FUSE_ADD_BRANCH      // addi(u) rX, ...; beq/bne on rX
+    };
+    
+    // Predecoded words indexed by address / 4. An entry with a null info
+    // is decoded on its next fetch; stores invalidate the words they touch
+    // and the word before them, whose fusion depends on its successor.
+    std::vector<Instruction> decode_cache;
+    
     Instruction decodeInstruction(uint32_t instruction);
-    bool executeInstruction(const Instruction& instr);
+    const Instruction& fetchDecoded(uint32_t address);
+    void fuseInstruction(Instruction& first, uint32_t address);
+    void invalidateDecoded(uint32_t address, uint32_t size);
+    void invalidateDecodeCache();
+    template <typename Policy, bool Fuse> bool stepWith();
+    template <typename Policy> bool executeInstruction(const Instruction& instr);
+    template <typename Policy> bool executeFused(const Instruction& first);
+    void traceRetired(const Instruction& instr, uint32_t at, uint32_t address, uint32_t next_pc);
+    void profileRetired(uint32_t at, BranchTargetPredictor::BranchKind kind, uint32_t next_pc);
+    void accessCaches(const Instruction& instr, uint32_t at, uint32_t address);
+    static InstructionClass classify(const MIPS::InstructionInfo& info);
+    
+    // Reverse execution history
+    bool stepRecorded();
+    void restartHistory();
+    void takeCheckpoint();
+    void savePage(uint32_t page);
+    void saveProfileBlock(uint32_t block);
+    BranchProfileEntry& profileEntry(uint32_t branch_pc);
+    void thinCheckpoints();
+    void restoreCheckpoint(size_t index);
+    bool rewindTo(uint64_t position);
+    
+    // Breakpoints
+    const Breakpoint* findBreakpoint(uint32_t address) const;
+    bool breakpointStops(uint32_t address) const;
+    void beginExecution();
+    void endExecution();
+    bool takeStopRequest(); // Consume a pending requestStop()
+    
+    // Watchpoints
+    void updatePageWatch();
+    const Watchpoint* findWatchpoint(uint32_t address, uint32_t size, uint8_t kind) const;
+    uint32_t watchedValue(const Watchpoint& watch) const;
+    void watchTriggered(const Watchpoint& watch, uint32_t address, bool write, uint32_t old_value);
+    template <typename Policy> void retireBranch(uint32_t branch_pc, BranchTargetPredictor::BranchKind kind,
+                                                 bool taken, uint32_t target, uint32_t next_pc);
     
     // Pipeline methods
     void initializePipeline();
-    void advancePipeline();
-    bool detectHazards();
+    template <typename Policy> void advancePipeline();
+    template <typename Policy> void fetchInstruction();
+    // Why the instruction in IF/ID is held this cycle
+    enum StallCause : uint8_t {
+        STALL_NONE,
+        STALL_LOAD_USE,
+        STALL_HILO,
+        STALL_FP
+    };
+    StallCause detectHazards();
+    bool detectMulDivHazard() const;
+    bool detectFPHazard() const;
+    bool issueUnits();
     void handleHazards();
     
     // Branch prediction methods
-    bool predictBranch(uint32_t pc);
-    void updateBranchPredictor(uint32_t pc, bool taken);
+    template <typename Policy> uint32_t predictNextPC(uint32_t pc, uint32_t in_flight = 0);
+    void recordRedirect(uint32_t branch_pc);
+    void resetBranchStats();
     
     // Helper methods
     uint32_t signExtend16(uint16_t value);
     bool isValidAddress(uint32_t address) const;
+    // In memory and word-aligned; fetching anywhere else is an address error
+    bool isValidFetchAddress(uint32_t address) const;
+    
+    // Big-endian accesses of 1, 2 or 4 bytes; false outside memory or not
+    // aligned to the size. Stores invalidate the predecoded words they touch.
+    bool loadMemory(uint32_t address, uint32_t size, uint32_t& value);
+    bool storeMemory(uint32_t address, uint32_t size, uint32_t value);
+    // Record a failed access and stop; returns false for the execute path
+    bool addressError(uint32_t address, uint32_t size, bool write);
     void printInstruction(const Instruction& instr) const;
 };
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// Per-instruction execution profile. Counters live in a flat array indexed
+// by PC / 4. Calls (JAL, JALR) and returns (JR $ra) move along a tree of
+// call paths, and the instructions (or, counting cycles, the cycles) since
+// the last move are charged to the path being left, for collapsed-stack
+// output that flame graph tools read.
+class Profiler {
+public:
+    struct Entry {
+        uint64_t executions;
+        uint64_t cycles;       // Pipeline mode: cycles up to its retirement
+        uint64_t stall_cycles; // Pipeline mode: interlocks held in ID, and refills after a mispredict
+    };
+
+    Profiler(uint32_t memory_size, bool count_cycles);
+
+    // Clear the counters and start the call tree at entry_pc
+    void reset(uint32_t entry_pc, bool count_cycles);
+    bool isCountingCycles() const;
+
+    void recordInstruction(uint32_t pc) {
+        entries[pc >> 2].executions++;
+        instructions++;
+    }
+    void recordCall(uint32_t target);
+    void recordReturn();
+
+    // Pipeline mode, once per cycle and per instruction leaving WB
+    void recordCycle() { cycles++; }
+    void recordRetire(uint32_t pc) {
+        entries[pc >> 2].cycles += cycles - last_retire;
+        last_retire = cycles;
+    }
+    void recordStall(uint32_t pc, uint64_t stall_cycles) { entries[pc >> 2].stall_cycles += stall_cycles; }
+
+    const Entry& getEntry(uint32_t pc) const;
+    uint64_t getInstructionCount() const;
+    uint64_t getCycleCount() const;
+
+    // Top instructions and basic blocks by cycles (or executions), with the
+    // disassembly of the words in image
+    std::string getReportString(const uint8_t* image, size_t size, int top_n = 10) const;
+
+    // One "caller;callee;... weight" line per call path; functions are
+    // named by their entry address
+    std::string getCollapsedStacks() const;
+    bool writeCollapsedStacks(const std::string& filename) const;
+
+private:
+    struct CallNode {
+        uint32_t function;
+        int32_t parent;
+        uint64_t weight; // Charged while this path was innermost
+    };
+
+    std::vector<Entry> entries;
+    bool count_cycles;
+    uint64_t instructions;
+    uint64_t cycles;
+    uint64_t last_retire;
+
+    std::vector<CallNode> call_nodes;
+    std::unordered_map<uint64_t, int32_t> call_children; // parent << 32 | function
+    int32_t current_node;
+    uint64_t path_start; // Clock when current_node became innermost
+
+    uint64_t clock() const { return count_cycles ? cycles : instructions; }
+    void chargePath();
+    std::string pathName(int32_t node) const;
+};
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <fstream>
+#include "pipeline.hpp"
+
+// Pipeline timeline in the Chrome trace event format (JSON), which
+// chrome://tracing, Perfetto and speedscope open. Each stage is a track
+// holding one slice per instruction for the cycles it occupied the stage,
+// named by its disassembly; a further track holds the stall cycles by
+// cause, and flushes are instant events on the EX track. One cycle is
+// one microsecond of trace time.
+//
+// A slice is written once its instruction leaves the stage, so only the
+// current occupants are kept; events are formatted into a fixed buffer
+// that is written out whenever it fills.
+class TimelineWriter {
+public:
+    enum Track {
+        TRACK_IF,
+        TRACK_ID,
+        TRACK_EX,
+        TRACK_MEM,
+        TRACK_WB,
+        TRACK_STALLS,
+        TRACK_COUNT
+    };
+
+    TimelineWriter();
+    ~TimelineWriter();
+
+    bool open(const std::string& filename);
+    // End the open slices, terminate the JSON and close; false if any
+    // write failed
+    bool close();
+    bool isOpen() const;
+
+    // Once per cycle, with the latches as they were during it; held means
+    // the instruction in IF/ID was held there from the previous cycle (an
+    // interlock), rather than a new fetch of the same PC
+    void recordCycle(const Pipeline::PipelineRegister& latches, bool held);
+    // Events of the cycle last passed to recordCycle()
+    void recordStall(const char* cause);
+    void recordFlush(uint32_t branch_pc, int bubbles);
+
+    uint64_t getCycleCount() const;
+    uint64_t getEventCount() const; // Slices and flushes written
+    uint64_t getByteCount() const;
+
+private:
+    static const size_t BUFFER_SIZE = 1 << 20;
+    static const size_t MAX_EVENT_SIZE = 256;
+
+    struct Occupant {
+        bool valid;
+        uint32_t pc;
+        uint32_t instruction;
+        uint64_t start; // Cycle it entered the track
+    };
+
+    std::ofstream file;
+    std::vector<char> buffer;
+    size_t used;
+    bool write_failed;
+    uint64_t bytes_written;
+    uint64_t events;
+
+    uint64_t cycle; // Cycles recorded so far; the current one is cycle - 1
+    Occupant stages[TRACK_STALLS];
+    const char* stall_cause; // Open stall slice, or null
+    uint64_t stall_start;
+    uint64_t stall_cycle;    // Last cycle of the open stall slice
+
+    void endSlice(int track, const Occupant& occupant);
+    void endStall();
+    char* reserve(); // Room for one event at the end of the buffer
+    void commit(int length);
+    void flushBuffer();
+};
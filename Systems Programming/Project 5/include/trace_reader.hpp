@@ -0,0 +1,132 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include "trace_writer.hpp"
+
+// Sequential decoder for TraceWriter files. The file is memory-mapped and
+// consumed in CHUNK_SIZE windows: the kernel is asked to read the next
+// window ahead and to drop the one just finished, so traces larger than
+// RAM stream through a bounded working set.
+class TraceReader {
+public:
+    struct Record {
+        uint32_t pc;
+        uint32_t word;
+        uint8_t flags;      // TraceWriter::RecordFlags
+        uint8_t dest;       // Valid with TRACE_DEST
+        uint32_t dest_value;
+        uint32_t address;   // Valid with TRACE_MEMORY
+    };
+
+    TraceReader();
+    ~TraceReader();
+
+    // False if the file cannot be mapped or is not a trace
+    bool open(const std::string& filename);
+    void close();
+    bool isOpen() const;
+
+    // Decode the next record; false at the end of the trace, or on a
+    // truncated record, after which isCorrupt() is true
+    bool next(Record& record);
+    bool isCorrupt() const;
+
+    // Last value traced for a GPR; registers start at zero
+    uint32_t getRegister(int reg) const { return last_value[reg & 0x1F]; }
+
+    uint64_t getRecordCount() const;
+    uint64_t getFileSize() const;
+
+private:
+    static const size_t CHUNK_SIZE = 1 << 24;
+    static const size_t MAX_RECORD_SIZE = 1 + 5 + 4 + 1 + 5 + 5;
+
+    const uint8_t* base;
+    size_t length;
+    const uint8_t* cursor;
+    const uint8_t* end;
+    const uint8_t* chunk_end; // Advise the kernel once the cursor passes it
+    bool corrupt;
+
+    // Decoder state, mirroring the writer's encoder
+    uint32_t last_pc;
+    uint32_t last_address;
+    uint32_t last_value[32];
+    uint32_t word_pc[TraceWriter::WORD_TABLE_SIZE];
+    uint32_t word_value[TraceWriter::WORD_TABLE_SIZE];
+    uint64_t records;
+
+    void resetDecoder();
+    void nextChunk();
+    bool nextTail(Record& record);
+    const uint8_t* decode(const uint8_t* in, Record& record);
+
+    static const uint8_t* getVarint(const uint8_t* in, uint32_t& value) {
+        uint32_t result = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            uint8_t byte = *in++;
+            result |= (uint32_t)(byte & 0x7F) << shift;
+            if (byte < 0x80) break;
+        }
+        value = result;
+        return in;
+    }
+};
+
+// Decode one record starting at in; the caller guarantees MAX_RECORD_SIZE
+// readable bytes
+inline const uint8_t* TraceReader::decode(const uint8_t* in, Record& record) {
+    uint8_t flags = *in++;
+    record.flags = flags;
+
+    uint32_t pc = last_pc + 4;
+    if (!(flags & TraceWriter::TRACE_PC_SEQUENTIAL)) {
+        uint32_t delta;
+        in = getVarint(in, delta);
+        pc += TraceWriter::unzigzag(delta);
+    }
+    last_pc = pc;
+    record.pc = pc;
+
+    uint32_t slot = (pc >> 2) & (TraceWriter::WORD_TABLE_SIZE - 1);
+    if (flags & TraceWriter::TRACE_WORD_KNOWN) {
+        record.word = word_value[slot];
+    } else {
+        uint32_t word = ((uint32_t)in[0] << 24) | ((uint32_t)in[1] << 16) | ((uint32_t)in[2] << 8) | in[3];
+        in += 4;
+        word_pc[slot] = pc;
+        word_value[slot] = word;
+        record.word = word;
+    }
+
+    if (flags & TraceWriter::TRACE_DEST) {
+        uint8_t dest = *in++ & 0x1F;
+        uint32_t delta;
+        in = getVarint(in, delta);
+        last_value[dest] += TraceWriter::unzigzag(delta);
+        record.dest = dest;
+        record.dest_value = last_value[dest];
+    } else {
+        record.dest = 0;
+    }
+    if (flags & TraceWriter::TRACE_MEMORY) {
+        uint32_t delta;
+        in = getVarint(in, delta);
+        last_address += TraceWriter::unzigzag(delta);
+        record.address = last_address;
+    }
+    return in;
+}
+
+inline bool TraceReader::next(Record& record) {
+    if ((size_t)(end - cursor) < MAX_RECORD_SIZE) {
+        return nextTail(record);
+    }
+    cursor = decode(cursor, record);
+    records++;
+    if (cursor >= chunk_end) {
+        nextChunk();
+    }
+    return true;
+}
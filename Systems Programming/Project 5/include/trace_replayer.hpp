@@ -0,0 +1,84 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "trace_reader.hpp"
+#include "branch_predictor.hpp"
+#include "branch_target_predictor.hpp"
+#include "cache_model.hpp"
+#include "instruction_decoder.hpp"
+#include "hazard_scoreboard.hpp"
+
+// Drives the timing models from a recorded trace instead of executing the
+// program. Every record is fetched through the instruction cache, its
+// load or store address goes through the data cache, and control
+// transfers train the direction and target predictors exactly as the
+// functional model does, so one captured run can be re-timed under many
+// configurations.
+//
+// Timing follows the 5-stage pipeline in program order: each instruction
+// enters ID/EX one cycle after its predecessor unless held back by a
+// load-use hazard, a busy multiply/divide unit or pending HI/LO, a pending
+// FP result, a cache miss, or the refill after a fetch redirect. The
+// interlock rules are the pipeline model's HazardScoreboard.
+class TraceReplayer {
+public:
+    struct ReplayStats {
+        uint64_t instructions;
+        uint64_t cycles;
+        uint64_t load_use_stalls;
+        uint64_t hilo_stalls;
+        uint64_t fp_stalls;
+        uint64_t cache_stalls;
+        uint64_t redirects;
+        uint64_t redirect_cycles;
+    };
+
+    TraceReplayer();
+    ~TraceReplayer();
+
+    bool enableBranchPrediction(bool enable, const std::string& type = "static");
+    void enableLoopPredictor(bool enable);
+    void setMispredictPenalty(int cycles);
+    void setMulDivLatency(int multiply_cycles, int divide_cycles);
+    void setMulDivPipelined(bool pipelined);
+    bool setFPLatency(const std::string& name, int cycles);
+
+    // Caches start disabled; configure() them to enable. A miss holds the
+    // pipeline for the miss penalty.
+    CacheModel& getInstructionCache();
+    CacheModel& getDataCache();
+    void setCacheMissPenalty(int cycles);
+
+    // Reset every model and replay the whole trace; false if the trace
+    // ended in a truncated record
+    bool replay(TraceReader& reader);
+
+    ReplayStats getStats() const;
+    std::string getStatsString() const;
+
+private:
+    bool branch_prediction_enabled;
+    BranchPredictor branch_predictor;
+    BranchTargetPredictor target_predictor;
+    CacheModel instruction_cache;
+    CacheModel data_cache;
+
+    int mispredict_penalty;
+    int miss_penalty;
+    HazardScoreboard units;
+
+    // Issue cycle (entry into ID/EX) of the last instruction and cycles
+    // owed by the next one
+    struct Scoreboard {
+        uint64_t last_issue;
+        uint64_t bubbles;
+        uint8_t load_dest; // GPR loaded by the last instruction, 0 if none
+    } scoreboard;
+    ReplayStats stats;
+
+    void resetModels();
+    template <typename Policy> void replayWith(TraceReader& reader);
+    template <typename Policy> uint32_t predictNextPC(uint32_t pc);
+    template <typename Policy> void retire(const TraceReader::Record& record, uint32_t next_pc);
+    uint64_t issueCycle(const TraceReader::Record& record, const MIPS::InstructionInfo& info);
+};
@@ -0,0 +1,136 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Binary trace of retired instructions. The file starts with MAGIC; each
+// record is a flags byte followed by the fields its flags call for:
+//
+//   PC        zigzag varint of pc - (previous pc + 4), unless PC_SEQUENTIAL
+//   word      4 bytes big-endian, unless WORD_KNOWN
+//   dest      register number byte, then zigzag varint of the value minus
+//             the last value traced for that register
+//   memory    zigzag varint of address - previous traced address
+//
+// WORD_KNOWN means the word equals the one last traced in the PC's slot of
+// a direct-mapped table of WORD_TABLE_SIZE entries indexed by pc / 4.
+// Records are encoded into one buffer while a background thread writes
+// the other to disk.
+class TraceWriter {
+public:
+    static constexpr char MAGIC[8] = {'M', 'I', 'P', 'S', 'T', 'R', 'C', '1'};
+    static const uint32_t WORD_TABLE_SIZE = 4096;
+
+    enum RecordFlags : uint8_t {
+        TRACE_PC_SEQUENTIAL = 1,
+        TRACE_WORD_KNOWN = 2,
+        TRACE_DEST = 4,   // Nonzero register written
+        TRACE_MEMORY = 8, // Load or store effective address
+        TRACE_BRANCH = 16,
+        TRACE_TAKEN = 32  // Branch or jump left the sequential path
+    };
+
+    TraceWriter();
+    ~TraceWriter();
+
+    bool open(const std::string& filename);
+    // Flush, stop the writer thread and close; false if any write failed
+    bool close();
+    bool isOpen() const;
+
+    // flags is a mix of TRACE_DEST, TRACE_MEMORY, TRACE_BRANCH and TRACE_TAKEN
+    void record(uint32_t pc, uint32_t word, uint8_t flags, uint8_t dest, uint32_t dest_value, uint32_t address);
+
+    uint64_t getRecordCount() const;
+    uint64_t getByteCount() const;
+
+    static uint32_t zigzag(uint32_t delta) { return (delta << 1) ^ (uint32_t)((int32_t)delta >> 31); }
+    static uint32_t unzigzag(uint32_t value) { return (value >> 1) ^ (0u - (value & 1)); }
+
+private:
+    static const size_t BUFFER_SIZE = 1 << 18;
+    static const size_t MAX_RECORD_SIZE = 1 + 5 + 4 + 1 + 5 + 5;
+
+    std::ofstream file;
+    std::vector<uint8_t> buffers[2];
+    int active;
+    uint8_t* cursor;
+    uint8_t* limit; // Hand the buffer over once a record may not fit
+
+    // Writer thread state, guarded by mutex
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable ready;
+    bool pending;
+    int pending_buffer;
+    size_t pending_size;
+    bool stopping;
+    bool write_failed;
+    uint64_t bytes_written;
+
+    // Encoder state mirrored by readers
+    uint32_t last_pc;
+    uint32_t last_address;
+    uint32_t last_value[32];
+    uint32_t word_pc[WORD_TABLE_SIZE];
+    uint32_t word_value[WORD_TABLE_SIZE];
+    uint64_t records;
+
+    void resetEncoder();
+    void submit();
+    void writerLoop();
+
+    static uint8_t* putVarint(uint8_t* out, uint32_t value) {
+        while (value >= 0x80) {
+            *out++ = (uint8_t)(value | 0x80);
+            value >>= 7;
+        }
+        *out++ = (uint8_t)value;
+        return out;
+    }
+};
+
+inline void TraceWriter::record(uint32_t pc, uint32_t word, uint8_t flags, uint8_t dest,
+                                uint32_t dest_value, uint32_t address) {
+    uint8_t* out = cursor + 1;
+    if (pc == last_pc + 4) {
+        flags |= TRACE_PC_SEQUENTIAL;
+    } else {
+        out = putVarint(out, zigzag(pc - last_pc - 4));
+    }
+    last_pc = pc;
+
+    uint32_t slot = (pc >> 2) & (WORD_TABLE_SIZE - 1);
+    if (word_pc[slot] == pc && word_value[slot] == word) {
+        flags |= TRACE_WORD_KNOWN;
+    } else {
+        word_pc[slot] = pc;
+        word_value[slot] = word;
+        out[0] = (uint8_t)(word >> 24);
+        out[1] = (uint8_t)(word >> 16);
+        out[2] = (uint8_t)(word >> 8);
+        out[3] = (uint8_t)word;
+        out += 4;
+    }
+
+    if (flags & TRACE_DEST) {
+        *out++ = dest;
+        out = putVarint(out, zigzag(dest_value - last_value[dest]));
+        last_value[dest] = dest_value;
+    }
+    if (flags & TRACE_MEMORY) {
+        out = putVarint(out, zigzag(address - last_address));
+        last_address = address;
+    }
+
+    *cursor = flags;
+    cursor = out;
+    records++;
+    if (cursor > limit) {
+        submit();
+    }
+}
@@ -1,5 +1,7 @@
 #include "pipeline.hpp"
 #include "instruction_decoder.hpp"
+#include "hazard_scoreboard.hpp"
+#include "checkpoint_file.hpp"
 #include <sstream>
 #include <iomanip>
 
@@ -15,16 +17,20 @@ void Pipeline::reset() {
     // Initialize IF/ID pipeline register
     registers.if_id_pc = 0;
     registers.if_id_instruction = 0;
+    registers.if_id_predicted_pc = 0;
     registers.if_id_valid = false;
     
     // Initialize ID/EX pipeline register
     registers.id_ex_pc = 0;
+    registers.id_ex_instruction = 0;
+    registers.id_ex_predicted_pc = 0;
     registers.id_ex_rs_data = 0;
     registers.id_ex_rt_data = 0;
     registers.id_ex_immediate = 0;
     registers.id_ex_rs = 0;
     registers.id_ex_rt = 0;
     registers.id_ex_rd = 0;
+    registers.id_ex_dest = 0;
     registers.id_ex_opcode = 0;
     registers.id_ex_funct = 0;
     registers.id_ex_reg_write = false;
@@ -36,6 +42,8 @@ void Pipeline::reset() {
     
     // Initialize EX/MEM pipeline register
     registers.ex_mem_pc = 0;
+    registers.ex_mem_instruction = 0;
+    registers.ex_mem_predicted_pc = 0;
     registers.ex_mem_alu_result = 0;
     registers.ex_mem_rt_data = 0;
     registers.ex_mem_rd = 0;
@@ -46,6 +54,8 @@ void Pipeline::reset() {
     registers.ex_mem_valid = false;
     
     // Initialize MEM/WB pipeline register
+    registers.mem_wb_pc = 0;
+    registers.mem_wb_instruction = 0;
     registers.mem_wb_alu_result = 0;
     registers.mem_wb_mem_data = 0;
     registers.mem_wb_rd = 0;
@@ -53,6 +63,10 @@ void Pipeline::reset() {
     registers.mem_wb_mem_to_reg = false;
     registers.mem_wb_valid = false;
     
+    registers.wb_pc = 0;
+    registers.wb_instruction = 0;
+    registers.wb_valid = false;
+    
     // Reset stall and flush flags
     std::fill(stall_stages.begin(), stall_stages.end(), false);
     std::fill(flush_stages.begin(), flush_stages.end(), false);
@@ -73,15 +87,14 @@ void Pipeline::advance() {
         return;
     }
     
-    if (should_stall) {
-        insertStall();
-        return;
-    }
-    
-    // Normal pipeline advancement
-    // Move data from MEM/WB (no advancement needed for WB stage)
+    // Retire the instruction in MEM/WB
+    registers.wb_pc = registers.mem_wb_pc;
+    registers.wb_instruction = registers.mem_wb_instruction;
+    registers.wb_valid = registers.mem_wb_valid;
     
     // Move data from EX/MEM to MEM/WB
+    registers.mem_wb_pc = registers.ex_mem_pc;
+    registers.mem_wb_instruction = registers.ex_mem_instruction;
     registers.mem_wb_alu_result = registers.ex_mem_alu_result;
     registers.mem_wb_mem_data = 0; // Would be loaded from memory in real implementation
     registers.mem_wb_rd = registers.ex_mem_rd;
@@ -91,17 +104,27 @@ void Pipeline::advance() {
     
     // Move data from ID/EX to EX/MEM
     registers.ex_mem_pc = registers.id_ex_pc;
+    registers.ex_mem_instruction = registers.id_ex_instruction;
+    registers.ex_mem_predicted_pc = registers.id_ex_predicted_pc;
     registers.ex_mem_alu_result = 0; // Would be computed by ALU
     registers.ex_mem_rt_data = registers.id_ex_rt_data;
-    registers.ex_mem_rd = (registers.id_ex_opcode == 0) ? registers.id_ex_rd : registers.id_ex_rt;
+    registers.ex_mem_rd = registers.id_ex_dest;
     registers.ex_mem_reg_write = registers.id_ex_reg_write;
     registers.ex_mem_mem_read = registers.id_ex_mem_read;
     registers.ex_mem_mem_write = registers.id_ex_mem_write;
     registers.ex_mem_zero = false; // Would be set by ALU
     registers.ex_mem_valid = registers.id_ex_valid;
     
+    // A stalled ID stage keeps IF/ID in place and sends a bubble into EX
+    if (should_stall) {
+        insertStall();
+        return;
+    }
+    
     // Move data from IF/ID to ID/EX
     registers.id_ex_pc = registers.if_id_pc;
+    registers.id_ex_instruction = registers.if_id_instruction;
+    registers.id_ex_predicted_pc = registers.if_id_predicted_pc;
     
     if (registers.if_id_valid) {
         uint32_t instruction = registers.if_id_instruction;
@@ -116,17 +139,17 @@ void Pipeline::advance() {
         registers.id_ex_rt = rt;
         registers.id_ex_rd = rd;
         registers.id_ex_immediate = immediate;
+        registers.id_ex_dest = InstructionDecoder::destinationRegister(instruction);
         registers.id_ex_opcode = opcode;
         registers.id_ex_funct = funct;
         
-        // Set control signals based on instruction type
-        registers.id_ex_reg_write = (opcode == 0 && funct != MIPS::FUNCT_JR) || 
-                                   (opcode == MIPS::OPCODE_ADDI) || 
-                                   (opcode == MIPS::OPCODE_LW);
-        registers.id_ex_mem_read = (opcode == MIPS::OPCODE_LW);
-        registers.id_ex_mem_write = (opcode == MIPS::OPCODE_SW);
-        registers.id_ex_branch = (opcode == MIPS::OPCODE_BEQ) || (opcode == MIPS::OPCODE_BNE);
-        registers.id_ex_jump = (opcode == MIPS::OPCODE_J) || (opcode == MIPS::OPCODE_JAL);
+        // Control signals come straight from the decode table
+        const MIPS::ControlSignals& control = InstructionDecoder::info(instruction).control;
+        registers.id_ex_reg_write = control.reg_write;
+        registers.id_ex_mem_read = control.mem_read;
+        registers.id_ex_mem_write = control.mem_write;
+        registers.id_ex_branch = control.branch;
+        registers.id_ex_jump = control.jump;
     }
     
     registers.id_ex_valid = registers.if_id_valid;
@@ -163,6 +186,21 @@ bool Pipeline::detectControlHazard() const {
     return registers.id_ex_valid && (registers.id_ex_branch || registers.id_ex_jump);
 }
 
+bool Pipeline::detectLoadUseHazard() const {
+    if (!registers.if_id_valid || !registers.id_ex_valid) {
+        return false;
+    }
+    
+    // Load in EX whose result the instruction in ID needs one cycle too early
+    uint32_t instruction = registers.if_id_instruction;
+    return registers.id_ex_mem_read &&
+           HazardScoreboard::readsLoadResult(instruction, InstructionDecoder::info(instruction), registers.id_ex_dest);
+}
+
+void Pipeline::requestStall(Stage stage) {
+    stall_stages[stage] = true;
+}
+
 void Pipeline::insertStall() {
     // Insert bubble in ID/EX stage
     registers.id_ex_valid = false;
@@ -256,3 +294,36 @@ std::string Pipeline::getStateString() const {
     
     return oss.str();
 }
+
+void Pipeline::saveState(CheckpointFile& file) const {
+    static_assert(std::is_trivially_copyable<PipelineRegister>::value, "Latches are saved as raw bytes");
+    file.put(registers);
+}
+
+bool Pipeline::loadState(CheckpointFile& file) {
+    PipelineRegister loaded;
+    if (!file.get(loaded)) {
+        return false;
+    }
+    const bool* flags[] = {
+        &loaded.if_id_valid,
+        &loaded.id_ex_reg_write, &loaded.id_ex_mem_read, &loaded.id_ex_mem_write,
+        &loaded.id_ex_branch, &loaded.id_ex_jump, &loaded.id_ex_valid,
+        &loaded.ex_mem_reg_write, &loaded.ex_mem_mem_read, &loaded.ex_mem_mem_write,
+        &loaded.ex_mem_zero, &loaded.ex_mem_valid,
+        &loaded.mem_wb_reg_write, &loaded.mem_wb_mem_to_reg, &loaded.mem_wb_valid,
+        &loaded.wb_valid};
+    for (const bool* flag : flags) {
+        if (!CheckpointFile::isFlag(*flag)) return false;
+    }
+    const uint8_t register_numbers[] = {loaded.id_ex_rs, loaded.id_ex_rt, loaded.id_ex_rd,
+                                        loaded.id_ex_dest, loaded.ex_mem_rd, loaded.mem_wb_rd};
+    for (uint8_t reg : register_numbers) {
+        if (reg >= 32) return false;
+    }
+
+    registers = loaded;
+    std::fill(stall_stages.begin(), stall_stages.end(), false);
+    std::fill(flush_stages.begin(), flush_stages.end(), false);
+    return true;
+}
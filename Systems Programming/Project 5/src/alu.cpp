@@ -1,80 +1,25 @@
 #include "alu.hpp"
 
-ALU::Result ALU::execute(uint32_t operand1, uint32_t operand2, Operation op) {
-    Result result;
-    result.carry = false;
-    result.overflow = false;
-    
+bool ALU::Result::overflow() const {
     switch (op) {
         case ADD:
-            result.value = operand1 + operand2;
-            result.overflow = detectOverflow(operand1, operand2, result.value, false);
-            result.carry = (result.value < operand1);
-            break;
-            
+            return detectOverflow(operand1, operand2, value, false);
         case SUB:
-            result.value = operand1 - operand2;
-            result.overflow = detectOverflow(operand1, operand2, result.value, true);
-            result.carry = (operand1 < operand2);
-            break;
-            
-        case AND:
-            result.value = operand1 & operand2;
-            break;
-            
-        case OR:
-            result.value = operand1 | operand2;
-            break;
-            
-        case XOR:
-            result.value = operand1 ^ operand2;
-            break;
-            
-        case NOR:
-            result.value = ~(operand1 | operand2);
-            break;
-            
-        case SLT:
-            result.value = ((int32_t)operand1 < (int32_t)operand2) ? 1 : 0;
-            break;
-            
-        case SLTU:
-            result.value = (operand1 < operand2) ? 1 : 0;
-            break;
-            
+            return detectOverflow(operand1, operand2, value, true);
         default:
-            result.value = 0;
-            break;
+            return false;
     }
-    
-    result.zero = (result.value == 0);
-    return result;
 }
 
-ALU::Result ALU::execute(uint32_t operand1, uint32_t operand2, uint8_t shamt, Operation op) {
-    Result result;
-    result.carry = false;
-    result.overflow = false;
-    
+bool ALU::Result::carry() const {
     switch (op) {
-        case SLL:
-            result.value = operand2 << shamt;
-            break;
-            
-        case SRL:
-            result.value = operand2 >> shamt;
-            break;
-            
-        case SRA:
-            result.value = (int32_t)operand2 >> shamt;
-            break;
-            
+        case ADD:
+            return value < operand1;
+        case SUB:
+            return operand1 < operand2;
         default:
-            return execute(operand1, operand2, op);
+            return false;
     }
-    
-    result.zero = (result.value == 0);
-    return result;
 }
 
 bool ALU::detectOverflow(uint32_t a, uint32_t b, uint32_t result, bool is_sub) {
@@ -0,0 +1,1062 @@
+#include "assembler.hpp"
+#include "instruction_decoder.hpp"
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+namespace {
+    enum Pseudo : uint8_t {
+        PSEUDO_NONE,
+        PSEUDO_NOP,
+        PSEUDO_MOVE,
+        PSEUDO_LI,
+        PSEUDO_LA,
+        PSEUDO_B,
+        PSEUDO_BEQZ,
+        PSEUDO_BNEZ,
+        PSEUDO_BLT,
+        PSEUDO_BGE,
+        PSEUDO_BGT,
+        PSEUDO_BLE,
+        PSEUDO_BLTU,
+        PSEUDO_BGEU,
+        PSEUDO_BGTU,
+        PSEUDO_BLEU,
+        PSEUDO_NOT,
+        PSEUDO_NEG,
+        PSEUDO_NEGU,
+        PSEUDO_MUL
+    };
+
+    struct Mnemonic {
+        std::string_view name;
+        const MIPS::InstructionInfo* info; // Null for pseudo-instructions
+        uint32_t base;                     // Opcode, funct and selector fields
+        uint8_t pseudo;
+    };
+
+    // Open-addressed hash of every mnemonic, built once from the decode tables
+    class MnemonicTable {
+    public:
+        MnemonicTable() {
+            const MIPS::DecodeTables& tables = MIPS::DECODE_TABLES;
+            for (uint32_t i = 0; i < 64; i++) {
+                if (i != MIPS::OPCODE_RTYPE && i != MIPS::OPCODE_REGIMM && i != MIPS::OPCODE_COP1) {
+                    addInstruction(tables.opcode[i], i << 26);
+                }
+                addInstruction(tables.funct[i], i);
+                addInstruction(tables.fpu_s[i], COP1 | (uint32_t)MIPS::COP1_FMT_S << 21 | i);
+                addInstruction(tables.fpu_d[i], COP1 | (uint32_t)MIPS::COP1_FMT_D << 21 | i);
+                addInstruction(tables.fpu_w[i], COP1 | (uint32_t)MIPS::COP1_FMT_W << 21 | i);
+            }
+            for (uint32_t i = 0; i < 32; i++) {
+                addInstruction(tables.regimm[i], (uint32_t)MIPS::OPCODE_REGIMM << 26 | i << 16);
+                addInstruction(tables.cop1[i], COP1 | i << 21);
+            }
+            for (uint32_t i = 0; i < 2; i++) {
+                addInstruction(tables.cop1_branch[i], COP1 | (uint32_t)MIPS::COP1_BC << 21 | i << 16);
+            }
+
+            // Assembler spellings of the FP loads and stores
+            add({"l.s", find("lwc1")->info, find("lwc1")->base, PSEUDO_NONE});
+            add({"s.s", find("swc1")->info, find("swc1")->base, PSEUDO_NONE});
+            add({"l.d", find("ldc1")->info, find("ldc1")->base, PSEUDO_NONE});
+            add({"s.d", find("sdc1")->info, find("sdc1")->base, PSEUDO_NONE});
+
+            const std::pair<const char*, Pseudo> PSEUDOS[] = {
+                {"nop", PSEUDO_NOP}, {"move", PSEUDO_MOVE}, {"li", PSEUDO_LI}, {"la", PSEUDO_LA},
+                {"b", PSEUDO_B}, {"beqz", PSEUDO_BEQZ}, {"bnez", PSEUDO_BNEZ},
+                {"blt", PSEUDO_BLT}, {"bge", PSEUDO_BGE}, {"bgt", PSEUDO_BGT}, {"ble", PSEUDO_BLE},
+                {"bltu", PSEUDO_BLTU}, {"bgeu", PSEUDO_BGEU}, {"bgtu", PSEUDO_BGTU}, {"bleu", PSEUDO_BLEU},
+                {"not", PSEUDO_NOT}, {"neg", PSEUDO_NEG}, {"negu", PSEUDO_NEGU}, {"mul", PSEUDO_MUL}
+            };
+            for (const auto& pseudo : PSEUDOS) {
+                add({pseudo.first, nullptr, 0, pseudo.second});
+            }
+        }
+
+        const Mnemonic* find(std::string_view name) const {
+            for (uint32_t slot = hash(name);; slot = (slot + 1) & (SIZE - 1)) {
+                if (slots[slot].name.empty()) return nullptr;
+                if (slots[slot].name == name) return &slots[slot];
+            }
+        }
+
+    private:
+        static const uint32_t SIZE = 512;
+        static const uint32_t COP1 = (uint32_t)MIPS::OPCODE_COP1 << 26;
+        Mnemonic slots[SIZE] = {};
+
+        static uint32_t hash(std::string_view name) {
+            uint32_t h = 2166136261u;
+            for (char c : name) h = (h ^ (uint8_t)c) * 16777619u;
+            return h & (SIZE - 1);
+        }
+
+        void add(const Mnemonic& entry) {
+            uint32_t slot = hash(entry.name);
+            while (!slots[slot].name.empty()) slot = (slot + 1) & (SIZE - 1);
+            slots[slot] = entry;
+        }
+
+        void addInstruction(const MIPS::InstructionInfo& info, uint32_t base) {
+            if (info.operation != MIPS::OP_INVALID) {
+                add({info.mnemonic, &info, base, PSEUDO_NONE});
+            }
+        }
+    };
+
+    const MnemonicTable& mnemonics() {
+        static const MnemonicTable table;
+        return table;
+    }
+
+    inline bool isIdentifierStart(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == '.';
+    }
+
+    inline bool isIdentifierChar(char c) {
+        return isIdentifierStart(c) || (c >= '0' && c <= '9');
+    }
+
+    inline uint32_t encodeR(uint32_t funct, uint32_t rs, uint32_t rt, uint32_t rd) {
+        return rs << 21 | rt << 16 | rd << 11 | funct;
+    }
+
+    inline uint32_t encodeI(uint32_t opcode, uint32_t rs, uint32_t rt, uint32_t immediate) {
+        return opcode << 26 | rs << 21 | rt << 16 | (immediate & 0xFFFF);
+    }
+
+    std::string hexString(uint32_t value) {
+        std::ostringstream oss;
+        oss << "0x" << std::hex << value;
+        return oss.str();
+    }
+}
+
+Assembler::Assembler(uint32_t memory_size)
+    : memory_size(memory_size), image(memory_size, 0) {
+    reset();
+}
+
+void Assembler::reset() {
+    std::fill(image.begin(), image.end(), 0);
+    symbols.clear();
+    fixups.clear();
+    errors.clear();
+    text_cursor = TEXT_BASE;
+    data_cursor = DATA_BASE;
+    text_start = TEXT_BASE;
+    data_start = DATA_BASE;
+    in_text = true;
+    instruction_count = 0;
+    line_number = 0;
+}
+
+bool Assembler::assembleFile(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        reset();
+        errors.push_back({0, "cannot open " + filename});
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return assemble(buffer.str());
+}
+
+bool Assembler::assemble(const std::string& text) {
+    reset();
+    source = text;
+
+    const char* line = source.data();
+    const char* end = line + source.size();
+    while (line < end) {
+        const char* newline = (const char*)std::memchr(line, '\n', end - line);
+        line_end = newline != nullptr ? newline : end;
+        cursor = line;
+        line_number++;
+        assembleLine();
+        line = line_end + 1;
+    }
+
+    // Backpatch the forward references
+    for (const Fixup& fixup : fixups) {
+        auto symbol = symbols.find(fixup.label);
+        if (symbol == symbols.end()) {
+            error(fixup.line, "undefined label '" + std::string(fixup.label) + "'");
+        } else {
+            applyFixup(fixup, symbol->second);
+        }
+    }
+    fixups.clear();
+    std::stable_sort(errors.begin(), errors.end(),
+                     [](const Error& a, const Error& b) { return a.line < b.line; });
+    return errors.empty();
+}
+
+void Assembler::assembleLine() {
+    while (true) {
+        skipSpaces();
+        if (atLineEnd()) return;
+        if (!isIdentifierStart(*cursor)) {
+            error(std::string("unexpected character '") + *cursor + "'");
+            return;
+        }
+
+        std::string_view name;
+        parseIdentifier(name);
+        skipSpaces();
+        if (cursor < line_end && *cursor == ':') {
+            cursor++;
+            if (!symbols.emplace(name, currentCursor()).second) {
+                error("duplicate label '" + std::string(name) + "'");
+            }
+            continue;
+        }
+
+        // A failed line may have queued fixups for words it never emitted;
+        // drop them so they cannot patch past the image
+        size_t first_fixup = fixups.size();
+        bool assembled = name[0] == '.' ? assembleDirective(name) : assembleInstruction(name);
+        if (!assembled) {
+            fixups.resize(first_fixup);
+            return;
+        }
+        resolveFixups(first_fixup);
+        return;
+    }
+}
+
+bool Assembler::assembleInstruction(std::string_view name) {
+    char lower[16];
+    if (name.size() >= sizeof(lower)) {
+        error("unknown instruction '" + std::string(name) + "'");
+        return false;
+    }
+    for (size_t i = 0; i < name.size(); i++) {
+        char c = name[i];
+        lower[i] = (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+    }
+    const Mnemonic* mnemonic = mnemonics().find(std::string_view(lower, name.size()));
+    if (mnemonic == nullptr) {
+        error("unknown instruction '" + std::string(name) + "'");
+        return false;
+    }
+
+    if (in_text && !alignCursor(4)) return false;
+    if (mnemonic->pseudo != PSEUDO_NONE) {
+        return assemblePseudo(mnemonic->pseudo);
+    }
+
+    uint32_t at = currentCursor();
+    uint32_t word = mnemonic->base;
+    uint32_t a = 0, b = 0, c = 0;
+    switch (mnemonic->info->layout) {
+        case MIPS::LAYOUT_NONE:
+            break;
+        case MIPS::LAYOUT_RD_RS_RT:
+            if (!parseRegister(a) || !expectComma() || !parseRegister(b) || !expectComma() ||
+                !parseRegister(c)) return false;
+            word |= a << 11 | b << 21 | c << 16;
+            break;
+        case MIPS::LAYOUT_RD_RT_SA: {
+            int64_t shift;
+            if (!parseRegister(a) || !expectComma() || !parseRegister(b) || !expectComma() ||
+                !parseNumber(shift)) return false;
+            if (shift < 0 || shift > 31) {
+                error("shift amount out of range");
+                return false;
+            }
+            word |= a << 11 | b << 16 | (uint32_t)shift << 6;
+            break;
+        }
+        case MIPS::LAYOUT_RD_RT_RS:
+            if (!parseRegister(a) || !expectComma() || !parseRegister(b) || !expectComma() ||
+                !parseRegister(c)) return false;
+            word |= a << 11 | b << 16 | c << 21;
+            break;
+        case MIPS::LAYOUT_RD_RS:
+            // jalr $rs links through $ra
+            if (!parseRegister(a)) return false;
+            skipSpaces();
+            if (cursor < line_end && *cursor == ',') {
+                if (!expectComma() || !parseRegister(b)) return false;
+                word |= a << 11 | b << 21;
+            } else {
+                word |= (uint32_t)MIPS::REG_RA << 11 | a << 21;
+            }
+            break;
+        case MIPS::LAYOUT_RS_RT:
+            // div/divu also take the "$zero, $rs, $rt" form
+            if (!parseRegister(a) || !expectComma() || !parseRegister(b)) return false;
+            skipSpaces();
+            if (cursor < line_end && *cursor == ',') {
+                if (a != 0 || !expectComma() || !parseRegister(c)) {
+                    if (a != 0) error("destination of a three-operand divide must be $zero");
+                    return false;
+                }
+                a = b;
+                b = c;
+            }
+            word |= a << 21 | b << 16;
+            break;
+        case MIPS::LAYOUT_RD:
+            if (!parseRegister(a)) return false;
+            word |= a << 11;
+            break;
+        case MIPS::LAYOUT_RS:
+            if (!parseRegister(a)) return false;
+            word |= a << 21;
+            break;
+        case MIPS::LAYOUT_RT_RS_IMM:
+            if (!parseRegister(a) || !expectComma() || !parseRegister(b) || !expectComma() ||
+                !parseImmediate(word, true, at)) return false;
+            word |= a << 16 | b << 21;
+            break;
+        case MIPS::LAYOUT_RT_RS_HEX:
+            if (!parseRegister(a) || !expectComma() || !parseRegister(b) || !expectComma() ||
+                !parseImmediate(word, false, at)) return false;
+            word |= a << 16 | b << 21;
+            break;
+        case MIPS::LAYOUT_RT_HEX:
+            if (!parseRegister(a) || !expectComma() || !parseImmediate(word, false, at)) return false;
+            word |= a << 16;
+            break;
+        case MIPS::LAYOUT_RT_OFFSET_BASE:
+            if (!parseRegister(a) || !expectComma()) return false;
+            return parseMemoryOperand(word | a << 16, at);
+        case MIPS::LAYOUT_FT_OFFSET_BASE:
+            if (!parseFPRegister(a) || !expectComma()) return false;
+            return parseMemoryOperand(word | a << 16, at);
+        case MIPS::LAYOUT_RS_RT_OFFSET:
+            if (!parseRegister(a) || !expectComma() || !parseRegister(b) || !expectComma() ||
+                !parseBranchTarget(word, at)) return false;
+            word |= a << 21 | b << 16;
+            break;
+        case MIPS::LAYOUT_RS_OFFSET:
+            if (!parseRegister(a) || !expectComma() || !parseBranchTarget(word, at)) return false;
+            word |= a << 21;
+            break;
+        case MIPS::LAYOUT_OFFSET:
+            if (!parseBranchTarget(word, at)) return false;
+            break;
+        case MIPS::LAYOUT_TARGET:
+            if (!parseJumpTarget(word, at)) return false;
+            break;
+        case MIPS::LAYOUT_FD_FS_FT:
+            if (!parseFPRegister(a) || !expectComma() || !parseFPRegister(b) || !expectComma() ||
+                !parseFPRegister(c)) return false;
+            word |= a << 6 | b << 11 | c << 16;
+            break;
+        case MIPS::LAYOUT_FD_FS:
+            if (!parseFPRegister(a) || !expectComma() || !parseFPRegister(b)) return false;
+            word |= a << 6 | b << 11;
+            break;
+        case MIPS::LAYOUT_FS_FT:
+            if (!parseFPRegister(a) || !expectComma() || !parseFPRegister(b)) return false;
+            word |= a << 11 | b << 16;
+            break;
+        case MIPS::LAYOUT_RT_FS:
+            if (!parseRegister(a) || !expectComma() || !parseFPRegister(b)) return false;
+            word |= a << 16 | b << 11;
+            break;
+        case MIPS::LAYOUT_RT_FCR:
+            if (!parseRegister(a) || !expectComma() || !parseControlRegister(b)) return false;
+            word |= a << 16 | b << 11;
+            break;
+    }
+
+    if (!atLineEnd()) {
+        error("unexpected text after operands");
+        return false;
+    }
+    return emitWord(word);
+}
+
+bool Assembler::assemblePseudo(int pseudo) {
+    const uint32_t AT = MIPS::REG_AT;
+    uint32_t at = currentCursor();
+    uint32_t rd = 0, rs = 0, rt = 0;
+    int64_t value = 0;
+    std::string_view label;
+    uint32_t branch = 0;
+
+    switch (pseudo) {
+        case PSEUDO_NOP:
+            break;
+        case PSEUDO_MOVE:
+        case PSEUDO_NOT:
+        case PSEUDO_NEG:
+        case PSEUDO_NEGU:
+            if (!parseRegister(rd) || !expectComma() || !parseRegister(rs)) return false;
+            break;
+        case PSEUDO_LI:
+        case PSEUDO_LA:
+            if (!parseRegister(rd) || !expectComma() || !parseValue(value, label)) return false;
+            if (label.empty() && (value < INT32_MIN || value > (int64_t)UINT32_MAX)) {
+                error("immediate out of range");
+                return false;
+            }
+            break;
+        case PSEUDO_B:
+            if (!parseBranchTarget(branch, at)) return false;
+            break;
+        case PSEUDO_BEQZ:
+        case PSEUDO_BNEZ:
+            if (!parseRegister(rs) || !expectComma() || !parseBranchTarget(branch, at)) return false;
+            break;
+        case PSEUDO_MUL:
+            if (!parseRegister(rd) || !expectComma() || !parseRegister(rs) || !expectComma() ||
+                !parseRegister(rt)) return false;
+            break;
+        default:
+            // Compare-and-branch through $at; the branch is the second word
+            if (!parseRegister(rs) || !expectComma() || !parseRegister(rt) || !expectComma() ||
+                !parseBranchTarget(branch, at + 4)) return false;
+            break;
+    }
+    if (!atLineEnd()) {
+        error("unexpected text after operands");
+        return false;
+    }
+
+    switch (pseudo) {
+        case PSEUDO_NOP:
+            return emitWord(0);
+        case PSEUDO_MOVE:
+            return emitWord(encodeR(MIPS::FUNCT_ADDU, rs, 0, rd));
+        case PSEUDO_NOT:
+            return emitWord(encodeR(MIPS::FUNCT_NOR, rs, 0, rd));
+        case PSEUDO_NEG:
+            return emitWord(encodeR(MIPS::FUNCT_SUB, 0, rs, rd));
+        case PSEUDO_NEGU:
+            return emitWord(encodeR(MIPS::FUNCT_SUBU, 0, rs, rd));
+        case PSEUDO_MUL:
+            return emitWord(encodeR(MIPS::FUNCT_MULT, rs, rt, 0)) &&
+                   emitWord(encodeR(MIPS::FUNCT_MFLO, 0, 0, rd));
+        case PSEUDO_LI:
+        case PSEUDO_LA:
+            if (!label.empty()) {
+                addFixup(at, FIX_HI, label, (int32_t)value);
+                addFixup(at + 4, FIX_LO, label, (int32_t)value);
+                return emitWord(encodeI(MIPS::OPCODE_LUI, 0, rd, 0)) &&
+                       emitWord(encodeI(MIPS::OPCODE_ORI, rd, rd, 0));
+            }
+            if (value >= -32768 && value <= 32767) {
+                return emitWord(encodeI(MIPS::OPCODE_ADDIU, 0, rd, (uint32_t)value));
+            }
+            if (value >= 0 && value <= 0xFFFF) {
+                return emitWord(encodeI(MIPS::OPCODE_ORI, 0, rd, (uint32_t)value));
+            }
+            if (!emitWord(encodeI(MIPS::OPCODE_LUI, 0, rd, (uint32_t)value >> 16))) return false;
+            if ((value & 0xFFFF) == 0) return true;
+            return emitWord(encodeI(MIPS::OPCODE_ORI, rd, rd, (uint32_t)value));
+        case PSEUDO_B:
+            return emitWord(encodeI(MIPS::OPCODE_BEQ, 0, 0, 0) | branch);
+        case PSEUDO_BEQZ:
+            return emitWord(encodeI(MIPS::OPCODE_BEQ, rs, 0, 0) | branch);
+        case PSEUDO_BNEZ:
+            return emitWord(encodeI(MIPS::OPCODE_BNE, rs, 0, 0) | branch);
+        default: {
+            // blt/bge compare rs < rt, bgt/ble compare rt < rs
+            bool is_unsigned = pseudo == PSEUDO_BLTU || pseudo == PSEUDO_BGEU ||
+                               pseudo == PSEUDO_BGTU || pseudo == PSEUDO_BLEU;
+            bool swap = pseudo == PSEUDO_BGT || pseudo == PSEUDO_BLE ||
+                        pseudo == PSEUDO_BGTU || pseudo == PSEUDO_BLEU;
+            bool when_set = pseudo == PSEUDO_BLT || pseudo == PSEUDO_BGT ||
+                            pseudo == PSEUDO_BLTU || pseudo == PSEUDO_BGTU;
+            uint32_t funct = is_unsigned ? MIPS::FUNCT_SLTU : MIPS::FUNCT_SLT;
+            return emitWord(encodeR(funct, swap ? rt : rs, swap ? rs : rt, AT)) &&
+                   emitWord(encodeI(when_set ? MIPS::OPCODE_BNE : MIPS::OPCODE_BEQ, AT, 0, 0) | branch);
+        }
+    }
+}
+
+bool Assembler::assembleDirective(std::string_view directive) {
+    if (directive == ".text" || directive == ".data") {
+        in_text = directive == ".text";
+        if (!atLineEnd()) {
+            int64_t address;
+            if (!parseNumber(address)) return false;
+            if (address < 0 || address > memory_size) {
+                error("section address outside memory");
+                return false;
+            }
+            currentCursor() = (uint32_t)address;
+        }
+        (in_text ? text_start : data_start) = currentCursor();
+    } else if (directive == ".word" || directive == ".half" || directive == ".byte") {
+        uint32_t size = directive == ".word" ? 4 : directive == ".half" ? 2 : 1;
+        FixupKind kind = size == 4 ? FIX_WORD : size == 2 ? FIX_HALF : FIX_BYTE;
+        if (!alignCursor(size)) return false;
+        do {
+            int64_t value;
+            std::string_view label;
+            if (!parseValue(value, label)) return false;
+            if (!label.empty()) {
+                addFixup(currentCursor(), kind, label, (int32_t)value);
+                value = 0;
+            }
+            if (!emitBytes((uint64_t)value, size)) return false;
+            skipSpaces();
+        } while (cursor < line_end && *cursor == ',' && expectComma());
+    } else if (directive == ".float" || directive == ".double") {
+        bool is_double = directive == ".double";
+        if (!alignCursor(is_double ? 8 : 4)) return false;
+        do {
+            skipSpaces();
+            char* number_end;
+            double value = std::strtod(cursor, &number_end);
+            if (number_end == cursor || number_end > line_end) {
+                error("expected a floating-point value");
+                return false;
+            }
+            cursor = number_end;
+            if (is_double) {
+                uint64_t bits;
+                std::memcpy(&bits, &value, sizeof(bits));
+                if (!emitBytes(bits, 8)) return false;
+            } else {
+                float single = (float)value;
+                uint32_t bits;
+                std::memcpy(&bits, &single, sizeof(bits));
+                if (!emitBytes(bits, 4)) return false;
+            }
+            skipSpaces();
+        } while (cursor < line_end && *cursor == ',' && expectComma());
+    } else if (directive == ".space") {
+        int64_t size;
+        if (!parseNumber(size)) return false;
+        if (size < 0) {
+            error("space outside memory");
+            return false;
+        }
+        if (!checkRoom(currentCursor(), (uint64_t)size)) return false;
+        currentCursor() += (uint32_t)size;
+    } else if (directive == ".align") {
+        int64_t power;
+        if (!parseNumber(power)) return false;
+        if (power < 0 || power > 16) {
+            error("alignment out of range");
+            return false;
+        }
+        if (!alignCursor(1u << power)) return false;
+    } else if (directive == ".ascii" || directive == ".asciiz") {
+        std::string text;
+        if (!parseString(text)) return false;
+        if (directive == ".asciiz") text.push_back('\0');
+        for (char c : text) {
+            if (!emitBytes((uint8_t)c, 1)) return false;
+        }
+    } else if (directive == ".globl" || directive == ".global" || directive == ".set" ||
+               directive == ".ent" || directive == ".end" || directive == ".extern" ||
+               directive == ".type" || directive == ".size" || directive == ".frame" ||
+               directive == ".mask" || directive == ".fmask") {
+        // Linkage and assembler-mode hints have no effect on a flat image
+        cursor = line_end;
+        return true;
+    } else {
+        error("unknown directive '" + std::string(directive) + "'");
+        return false;
+    }
+
+    if (!atLineEnd()) {
+        error("unexpected text after operands");
+        return false;
+    }
+    return true;
+}
+
+// The scanners below step a local pointer: a char load may alias the
+// cursor member, which would otherwise be stored on every character
+void Assembler::skipSpaces() {
+    const char* p = cursor;
+    while (p < line_end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+    cursor = p;
+}
+
+bool Assembler::atLineEnd() {
+    skipSpaces();
+    return cursor == line_end || *cursor == '#';
+}
+
+bool Assembler::expectComma() {
+    skipSpaces();
+    if (cursor < line_end && *cursor == ',') {
+        cursor++;
+        return true;
+    }
+    error("expected ','");
+    return false;
+}
+
+bool Assembler::parseIdentifier(std::string_view& name) {
+    skipSpaces();
+    const char* start = cursor;
+    const char* p = start;
+    if (p < line_end && isIdentifierStart(*p)) {
+        while (p < line_end && isIdentifierChar(*p)) p++;
+    }
+    cursor = p;
+    name = std::string_view(start, p - start);
+    if (name.empty()) {
+        error("expected a name");
+        return false;
+    }
+    return true;
+}
+
+bool Assembler::parseNumber(int64_t& value) {
+    skipSpaces();
+    const char* p = cursor;
+    const char* end = line_end;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+
+    uint64_t magnitude = 0;
+    const char* digits = p;
+    if (end - p >= 3 && p[0] == '\'' && p[2] == '\'') {
+        magnitude = (uint8_t)p[1];
+        p += 3;
+    } else if (end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+        p += 2;
+        digits = p;
+        for (; p < end; p++) {
+            char c = *p;
+            uint32_t digit;
+            if (c >= '0' && c <= '9') digit = c - '0';
+            else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+            else break;
+            magnitude = (magnitude << 4) | digit;
+            if (magnitude > 0xFFFFFFFFull) break;
+        }
+    } else {
+        for (; p < end && *p >= '0' && *p <= '9'; p++) {
+            magnitude = magnitude * 10 + (*p - '0');
+            if (magnitude > 0xFFFFFFFFull) break;
+        }
+    }
+
+    cursor = p;
+    if (p == digits || magnitude > 0xFFFFFFFFull || (p < end && isIdentifierChar(*p))) {
+        error("invalid number");
+        return false;
+    }
+    value = negative ? -(int64_t)magnitude : (int64_t)magnitude;
+    return true;
+}
+
+bool Assembler::parseValue(int64_t& value, std::string_view& label) {
+    skipSpaces();
+    label = std::string_view();
+    if (cursor < line_end && isIdentifierStart(*cursor)) {
+        parseIdentifier(label);
+        value = 0;
+        skipSpaces();
+        if (cursor < line_end && (*cursor == '+' || *cursor == '-')) {
+            return parseNumber(value);
+        }
+        return true;
+    }
+    return parseNumber(value);
+}
+
+bool Assembler::parseRegister(uint32_t& reg) {
+    skipSpaces();
+    if (cursor >= line_end || *cursor != '$') {
+        error("expected a register");
+        return false;
+    }
+    const char* start = cursor + 1;
+    const char* p = start;
+    while (p < line_end && isIdentifierChar(*p)) p++;
+    cursor = p;
+    std::string_view name(start, p - start);
+
+    int found = -1;
+    if (!name.empty() && name[0] >= '0' && name[0] <= '9') {
+        if (name.size() == 1) found = name[0] - '0';
+        else if (name.size() == 2 && name[1] >= '0' && name[1] <= '9') found = (name[0] - '0') * 10 + name[1] - '0';
+    } else if (name.size() == 2) {
+        char digit = name[1];
+        switch (name[0]) {
+            case 'a':
+                if (digit == 't') found = MIPS::REG_AT;
+                else if (digit >= '0' && digit <= '3') found = MIPS::REG_A0 + digit - '0';
+                break;
+            case 'v':
+                if (digit == '0' || digit == '1') found = MIPS::REG_V0 + digit - '0';
+                break;
+            case 't':
+                if (digit >= '0' && digit <= '7') found = MIPS::REG_T0 + digit - '0';
+                else if (digit == '8' || digit == '9') found = MIPS::REG_T8 + digit - '8';
+                break;
+            case 's':
+                if (digit >= '0' && digit <= '7') found = MIPS::REG_S0 + digit - '0';
+                else if (digit == '8') found = MIPS::REG_FP;
+                else if (digit == 'p') found = MIPS::REG_SP;
+                break;
+            case 'k':
+                if (digit == '0' || digit == '1') found = MIPS::REG_K0 + digit - '0';
+                break;
+            case 'g':
+                if (digit == 'p') found = MIPS::REG_GP;
+                break;
+            case 'f':
+                if (digit == 'p') found = MIPS::REG_FP;
+                break;
+            case 'r':
+                if (digit == 'a') found = MIPS::REG_RA;
+                break;
+        }
+    } else if (name == "zero") {
+        found = MIPS::REG_ZERO;
+    }
+
+    if (found < 0 || found > 31) {
+        error("unknown register '$" + std::string(name) + "'");
+        return false;
+    }
+    reg = (uint32_t)found;
+    return true;
+}
+
+bool Assembler::parseFPRegister(uint32_t& reg) {
+    skipSpaces();
+    if (line_end - cursor < 3 || cursor[0] != '$' || cursor[1] != 'f') {
+        error("expected an FP register");
+        return false;
+    }
+    cursor += 2;
+    int64_t number;
+    if (!parseNumber(number)) return false;
+    if (number < 0 || number > 31) {
+        error("FP register out of range");
+        return false;
+    }
+    reg = (uint32_t)number;
+    return true;
+}
+
+bool Assembler::parseControlRegister(uint32_t& reg) {
+    skipSpaces();
+    if (cursor >= line_end || *cursor != '$') {
+        error("expected a control register");
+        return false;
+    }
+    cursor++;
+    int64_t number;
+    if (!parseNumber(number)) return false;
+    if (number < 0 || number > 31) {
+        error("control register out of range");
+        return false;
+    }
+    reg = (uint32_t)number;
+    return true;
+}
+
+bool Assembler::parseImmediate(uint32_t& word, bool is_signed, uint32_t at) {
+    int64_t value;
+    std::string_view label;
+    if (!parseValue(value, label)) return false;
+    if (!label.empty()) {
+        addFixup(at, is_signed ? FIX_SIMM16 : FIX_UIMM16, label, (int32_t)value);
+        return true;
+    }
+    // Either spelling of a 16-bit pattern is accepted
+    if (value < -32768 || value > 0xFFFF) {
+        error("immediate out of range");
+        return false;
+    }
+    word |= (uint32_t)value & 0xFFFF;
+    return true;
+}
+
+bool Assembler::parseBranchTarget(uint32_t& word, uint32_t at) {
+    int64_t value;
+    std::string_view label;
+    if (!parseValue(value, label)) return false;
+    if (!label.empty()) {
+        addFixup(at, FIX_BRANCH, label, (int32_t)value);
+        return true;
+    }
+    // A number is the word offset, as the disassembler prints it
+    if (value < -32768 || value > 32767) {
+        error("branch offset out of range");
+        return false;
+    }
+    word |= (uint32_t)value & 0xFFFF;
+    return true;
+}
+
+bool Assembler::parseJumpTarget(uint32_t& word, uint32_t at) {
+    int64_t value;
+    std::string_view label;
+    if (!parseValue(value, label)) return false;
+    if (!label.empty()) {
+        addFixup(at, FIX_JUMP, label, (int32_t)value);
+        return true;
+    }
+    if (value < 0 || value > 0x0FFFFFFF || (value & 3) != 0) {
+        error("jump target must be a word address in the current 256 MB region");
+        return false;
+    }
+    word |= (uint32_t)value >> 2;
+    return true;
+}
+
+bool Assembler::parseMemoryOperand(uint32_t word, uint32_t at) {
+    int64_t value = 0;
+    std::string_view label;
+    skipSpaces();
+    if (cursor >= line_end || *cursor != '(') {
+        if (!parseValue(value, label)) return false;
+        skipSpaces();
+    }
+
+    // offset($base)
+    if (cursor < line_end && *cursor == '(') {
+        uint32_t base;
+        cursor++;
+        if (!parseRegister(base)) return false;
+        skipSpaces();
+        if (cursor >= line_end || *cursor != ')') {
+            error("expected ')'");
+            return false;
+        }
+        cursor++;
+        if (!atLineEnd()) {
+            error("unexpected text after operands");
+            return false;
+        }
+        word |= base << 21;
+        if (!label.empty()) {
+            addFixup(at, FIX_SIMM16, label, (int32_t)value);
+        } else if (value < -32768 || value > 32767) {
+            error("offset out of range");
+            return false;
+        } else {
+            word |= (uint32_t)value & 0xFFFF;
+        }
+        return emitWord(word);
+    }
+
+    // Absolute address: one word when it fits the offset, else through $at
+    if (!atLineEnd()) {
+        error("unexpected text after operands");
+        return false;
+    }
+    if (label.empty() && value >= -32768 && value <= 32767) {
+        return emitWord(word | ((uint32_t)value & 0xFFFF));
+    }
+    const uint32_t AT = MIPS::REG_AT;
+    if (!label.empty()) {
+        addFixup(at, FIX_HI_ADJUSTED, label, (int32_t)value);
+        addFixup(at + 4, FIX_LO, label, (int32_t)value);
+        value = 0;
+    }
+    uint32_t address = (uint32_t)value;
+    return emitWord(encodeI(MIPS::OPCODE_LUI, 0, AT, (address + 0x8000) >> 16)) &&
+           emitWord(word | AT << 21 | (address & 0xFFFF));
+}
+
+bool Assembler::parseString(std::string& text) {
+    skipSpaces();
+    if (cursor >= line_end || *cursor != '"') {
+        error("expected a string");
+        return false;
+    }
+    for (cursor++; cursor < line_end && *cursor != '"'; cursor++) {
+        char c = *cursor;
+        if (c == '\\' && cursor + 1 < line_end) {
+            switch (*++cursor) {
+                case 'n': c = '\n'; break;
+                case 't': c = '\t'; break;
+                case 'r': c = '\r'; break;
+                case '0': c = '\0'; break;
+                default: c = *cursor; break;
+            }
+        }
+        text.push_back(c);
+    }
+    if (cursor >= line_end) {
+        error("unterminated string");
+        return false;
+    }
+    cursor++;
+    return true;
+}
+
+bool Assembler::emitWord(uint32_t word, bool is_instruction) {
+    if (!emitBytes(word, 4)) return false;
+    if (is_instruction) instruction_count++;
+    return true;
+}
+
+bool Assembler::emitBytes(uint64_t value, uint32_t size) {
+    uint32_t& address = currentCursor();
+    if (!checkRoom(address, size)) return false;
+    uint8_t* bytes = &image[address];
+    address += size;
+    for (uint32_t i = 0; i < size; i++) {
+        bytes[i] = (uint8_t)(value >> (8 * (size - 1 - i)));
+    }
+    return true;
+}
+
+bool Assembler::alignCursor(uint32_t alignment) {
+    uint32_t& address = currentCursor();
+    uint64_t aligned = ((uint64_t)address + alignment - 1) & ~(uint64_t)(alignment - 1);
+    if (!checkRoom(address, aligned - address)) return false;
+    address = (uint32_t)aligned;
+    return true;
+}
+
+// The bytes from address on must fit in memory, and code that starts below
+// the data section must not run into it
+bool Assembler::checkRoom(uint32_t address, uint64_t size) {
+    if ((uint64_t)address + size > memory_size) {
+        error("address " + hexString(address) + " outside memory");
+        return false;
+    }
+    if (in_text && text_start < data_start && address + size > data_start) {
+        error(".text runs past " + hexString(data_start) + " into .data");
+        return false;
+    }
+    return true;
+}
+
+void Assembler::addFixup(uint32_t address, FixupKind kind, std::string_view label, int32_t addend) {
+    fixups.push_back({address, kind, line_number, label, addend});
+}
+
+// Patch the fixups of the line just assembled whose labels are already
+// defined; forward references stay queued until the end
+void Assembler::resolveFixups(size_t first) {
+    size_t kept = first;
+    for (size_t i = first; i < fixups.size(); i++) {
+        auto symbol = symbols.find(fixups[i].label);
+        if (symbol != symbols.end()) {
+            applyFixup(fixups[i], symbol->second);
+        } else {
+            fixups[kept++] = fixups[i];
+        }
+    }
+    fixups.resize(kept);
+}
+
+bool Assembler::applyFixup(const Fixup& fixup, uint32_t value) {
+    uint32_t size = fixup.kind == FIX_BYTE ? 1 : fixup.kind == FIX_HALF ? 2 : 4;
+    if ((uint64_t)fixup.address + size > image.size()) {
+        error(fixup.line, "reference to '" + std::string(fixup.label) + "' outside the image");
+        return false;
+    }
+    uint32_t target = value + (uint32_t)fixup.addend;
+    uint8_t* bytes = &image[fixup.address];
+    uint32_t word = ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) |
+                    ((uint32_t)bytes[2] << 8) | bytes[3];
+    int64_t signed_target = (int32_t)target;
+
+    switch (fixup.kind) {
+        case FIX_BRANCH: {
+            int64_t offset = (int64_t)target - ((int64_t)fixup.address + 4);
+            if ((offset & 3) != 0 || offset < -131072 || offset > 131068) {
+                error(fixup.line, "branch target out of range");
+                return false;
+            }
+            word = (word & 0xFFFF0000) | (((uint32_t)offset >> 2) & 0xFFFF);
+            break;
+        }
+        case FIX_JUMP:
+            if ((target & 3) != 0 || (target & 0xF0000000) != ((fixup.address + 4) & 0xF0000000)) {
+                error(fixup.line, "jump target out of range");
+                return false;
+            }
+            word = (word & 0xFC000000) | (target >> 2);
+            break;
+        case FIX_HI:
+            word = (word & 0xFFFF0000) | (target >> 16);
+            break;
+        case FIX_HI_ADJUSTED:
+            word = (word & 0xFFFF0000) | (((target + 0x8000) >> 16) & 0xFFFF);
+            break;
+        case FIX_LO:
+            word = (word & 0xFFFF0000) | (target & 0xFFFF);
+            break;
+        case FIX_SIMM16:
+        case FIX_UIMM16: {
+            bool fits = fixup.kind == FIX_SIMM16 ? signed_target >= -32768 && signed_target <= 32767
+                                                 : target <= 0xFFFF;
+            if (!fits) {
+                error(fixup.line, "value of '" + std::string(fixup.label) + "' does not fit in 16 bits");
+                return false;
+            }
+            word = (word & 0xFFFF0000) | (target & 0xFFFF);
+            break;
+        }
+        case FIX_WORD:
+            word = target;
+            break;
+        case FIX_HALF:
+            bytes[0] = (uint8_t)(target >> 8);
+            bytes[1] = (uint8_t)target;
+            return true;
+        case FIX_BYTE:
+            bytes[0] = (uint8_t)target;
+            return true;
+    }
+
+    bytes[0] = (uint8_t)(word >> 24);
+    bytes[1] = (uint8_t)(word >> 16);
+    bytes[2] = (uint8_t)(word >> 8);
+    bytes[3] = (uint8_t)word;
+    return true;
+}
+
+void Assembler::error(const std::string& message) {
+    error(line_number, message);
+}
+
+void Assembler::error(int line, const std::string& message) {
+    errors.push_back({line, message});
+}
+
+const std::vector<uint8_t>& Assembler::getImage() const {
+    return image;
+}
+
+uint32_t Assembler::getInstructionCount() const {
+    return instruction_count;
+}
+
+int Assembler::getLineCount() const {
+    return line_number;
+}
+
+const std::vector<Assembler::Error>& Assembler::getErrors() const {
+    return errors;
+}
+
+std::string Assembler::getErrorString() const {
+    std::ostringstream oss;
+    for (const Error& entry : errors) {
+        oss << "line " << entry.line << ": " << entry.message << "\n";
+    }
+    return oss.str();
+}
+
+bool Assembler::getSymbol(const std::string& name, uint32_t& address) const {
+    auto symbol = symbols.find(name);
+    if (symbol == symbols.end()) {
+        return false;
+    }
+    address = symbol->second;
+    return true;
+}
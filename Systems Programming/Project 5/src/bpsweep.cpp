@@ -0,0 +1,236 @@
+#include "mips_simulator.hpp"
+#include "branch_predictor.hpp"
+#include "assembler.hpp"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cstdlib>
+
+struct SweepConfig {
+    BranchPredictor::PredictorType type;
+    std::string type_name;
+    int table_bits;
+    int history_bits;
+};
+
+struct SweepResult {
+    BranchPredictor::PredictionStats stats;
+};
+
+void printUsage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " <program_file> [options]\n";
+    std::cout << "\nCaptures the program's branch trace once, then evaluates every\n";
+    std::cout << "predictor configuration of the grid against it in parallel.\n";
+    std::cout << "\nOptions:\n";
+    std::cout << "  --asm              Treat the program file as assembly source\n";
+    std::cout << "  --types LIST       Predictor types (default static,taken,1bit,2bit,gshare)\n";
+    std::cout << "  --table-bits LIST  log2 of table entries (default 6,8,10,12,14)\n";
+    std::cout << "  --history LIST     Gshare history lengths (default 2,4,8,12)\n";
+    std::cout << "  --loop             Add the loop predictor to every configuration\n";
+    std::cout << "  --threads N        Worker threads (default: host cores)\n";
+    std::cout << "  --max-instr N      Stop capture after N instructions (default 100000000)\n";
+    std::cout << "  --help             Show this help message\n";
+    std::cout << "\nExample:\n";
+    std::cout << "  " << program_name << " program.txt --types 2bit,gshare --table-bits 8,12\n";
+}
+
+std::vector<std::string> splitList(const std::string& list) {
+    std::vector<std::string> items;
+    std::istringstream iss(list);
+    std::string item;
+    while (std::getline(iss, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+bool parseIntList(const std::string& list, std::vector<int>& values) {
+    values.clear();
+    try {
+        for (const std::string& item : splitList(list)) {
+            values.push_back(std::stoi(item));
+        }
+    } catch (const std::exception& e) {
+        return false;
+    }
+    return !values.empty();
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::string program_file = argv[1];
+    std::vector<std::string> type_names = {"static", "taken", "1bit", "2bit", "gshare"};
+    std::vector<int> table_bits = {6, 8, 10, 12, 14};
+    std::vector<int> history_bits = {2, 4, 8, 12};
+    unsigned int num_threads = std::max(1u, std::thread::hardware_concurrency());
+    uint64_t max_instructions = 100000000;
+    bool loop_predictor = false;
+    bool assembly = false;
+
+    // Parse command line arguments
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else if (arg == "--asm") {
+            assembly = true;
+        } else if (arg == "--types" && has_value) {
+            type_names = splitList(argv[++i]);
+        } else if (arg == "--table-bits" && has_value) {
+            if (!parseIntList(argv[++i], table_bits)) {
+                std::cerr << "Error: Invalid table size list\n";
+                return 1;
+            }
+        } else if (arg == "--history" && has_value) {
+            if (!parseIntList(argv[++i], history_bits)) {
+                std::cerr << "Error: Invalid history length list\n";
+                return 1;
+            }
+        } else if (arg == "--loop") {
+            loop_predictor = true;
+        } else if (arg == "--threads" && has_value) {
+            num_threads = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--max-instr" && has_value) {
+            max_instructions = std::strtoull(argv[++i], nullptr, 0);
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    // Build the configuration grid
+    std::vector<SweepConfig> configs;
+    for (const std::string& name : type_names) {
+        BranchPredictor::PredictorType type;
+        if (!BranchPredictor::parseType(name, type)) {
+            std::cerr << "Error: Unknown predictor type: " << name << std::endl;
+            return 1;
+        }
+
+        if (type == BranchPredictor::STATIC_NOT_TAKEN || type == BranchPredictor::STATIC_TAKEN) {
+            configs.push_back({type, name, 0, 0});
+            continue;
+        }
+        for (int bits : table_bits) {
+            if (bits < 1 || bits > 24) {
+                std::cerr << "Error: Table bits must be between 1 and 24\n";
+                return 1;
+            }
+            if (type != BranchPredictor::GSHARE) {
+                configs.push_back({type, name, bits, 0});
+                continue;
+            }
+            for (int history : history_bits) {
+                if (history >= 1 && history <= bits) {
+                    configs.push_back({type, name, bits, history});
+                }
+            }
+        }
+    }
+
+    // Capture the branch trace with one functional run
+    MIPSSimulator simulator;
+    if (assembly) {
+        Assembler assembler;
+        if (!assembler.assembleFile(program_file)) {
+            std::cerr << "Error: Could not assemble " << program_file << ":\n" << assembler.getErrorString();
+            return 1;
+        }
+        simulator.loadProgramImage(assembler.getImage());
+    } else if (!simulator.loadProgram(program_file)) {
+        std::cerr << "Error: Could not load program file: " << program_file << std::endl;
+        return 1;
+    }
+
+    std::vector<BranchPredictor::BranchRecord> trace;
+    simulator.setBranchTrace(&trace);
+
+    uint64_t instructions = 0;
+    while (instructions < max_instructions && simulator.step()) {
+        instructions++;
+    }
+    simulator.setBranchTrace(nullptr);
+
+    std::cout << "Branch Predictor Sweep\n";
+    std::cout << "======================\n";
+    std::cout << "Program: " << program_file << "\n";
+    std::cout << "Instructions: " << instructions << "\n";
+    std::cout << "Conditional Branches: " << trace.size() << "\n";
+    std::cout << "Configurations: " << configs.size() << " on "
+              << std::min<size_t>(num_threads, configs.size()) << " threads\n\n";
+
+    // Evaluate configurations in parallel over the shared read-only trace
+    std::vector<SweepResult> results(configs.size());
+    std::atomic<size_t> next_config(0);
+
+    auto worker = [&]() {
+        for (size_t i = next_config++; i < configs.size(); i = next_config++) {
+            const SweepConfig& config = configs[i];
+            BranchPredictor predictor(config.type, std::max(config.table_bits, 1),
+                                      config.history_bits);
+            predictor.enableLoopPredictor(loop_predictor);
+            predictor.replayTrace(trace);
+            results[i].stats = predictor.getStats();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned int t = 1; t < num_threads && t < configs.size(); t++) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : workers) {
+        thread.join();
+    }
+
+    // Report
+    std::cout << std::left << std::setw(8) << "Type"
+              << std::right << std::setw(10) << "Entries"
+              << std::setw(9) << "History"
+              << std::setw(14) << "Mispredicts"
+              << std::setw(11) << "Accuracy"
+              << std::setw(10) << "MPKI";
+    if (loop_predictor) std::cout << std::setw(14) << "LoopRemoved";
+    std::cout << "\n" << std::string(loop_predictor ? 76 : 62, '-') << "\n";
+
+    for (size_t i = 0; i < configs.size(); i++) {
+        const SweepConfig& config = configs[i];
+        const BranchPredictor::PredictionStats& stats = results[i].stats;
+        double mpki = instructions > 0 ? stats.incorrect_predictions * 1000.0 / instructions : 0.0;
+
+        std::cout << std::left << std::setw(8) << config.type_name << std::right;
+        if (config.table_bits > 0) {
+            std::cout << std::setw(10) << (1 << config.table_bits);
+        } else {
+            std::cout << std::setw(10) << "-";
+        }
+        if (config.history_bits > 0) {
+            std::cout << std::setw(9) << config.history_bits;
+        } else {
+            std::cout << std::setw(9) << "-";
+        }
+        std::cout << std::setw(14) << stats.incorrect_predictions
+                  << std::setw(10) << std::fixed << std::setprecision(2) << stats.accuracy << "%"
+                  << std::setw(10) << std::setprecision(3) << mpki;
+        if (loop_predictor) {
+            std::cout << std::setw(14)
+                      << stats.loop_mispredicts_removed - stats.loop_mispredicts_added;
+        }
+        std::cout << "\n";
+    }
+
+    return 0;
+}
@@ -1,9 +1,16 @@
 #include "branch_predictor.hpp"
+#include "checkpoint_file.hpp"
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
 
-BranchPredictor::BranchPredictor(PredictorType type) 
-    : predictor_type(type) {
+BranchPredictor::BranchPredictor(PredictorType type, int table_bits, int history_bits)
+    : predictor_type(type),
+      branch_history_table(1u << table_bits),
+      index_mask((1u << table_bits) - 1),
+      history_mask((1u << history_bits) - 1),
+      loop_predictor_enabled(false),
+      loop_table(1u << LOOP_TABLE_BITS) {
     reset();
 }
 
@@ -11,160 +18,211 @@ BranchPredictor::~BranchPredictor() {}
 
 bool BranchPredictor::predict(uint32_t pc) {
     stats.total_predictions++;
-    
+
     switch (predictor_type) {
         case STATIC_NOT_TAKEN:
-            return false;
-            
+            return predictWith<BranchPolicy::StaticNotTaken>(pc);
+
         case STATIC_TAKEN:
-            return true;
-            
+            return predictWith<BranchPolicy::StaticTaken>(pc);
+
         case DYNAMIC_1BIT:
-            // 1-bit predictor: 0 = not taken, 1 = taken
-            if (branch_history_table.find(pc) == branch_history_table.end()) {
-                branch_history_table[pc] = 0; // Initialize as not taken
-            }
-            return branch_history_table[pc] == 1;
-            
+            return predictWith<BranchPolicy::OneBit>(pc);
+
         case DYNAMIC_2BIT:
-            // 2-bit predictor with 4 states
-            if (branch_history_table.find(pc) == branch_history_table.end()) {
-                branch_history_table[pc] = WEAKLY_NOT_TAKEN; // Initialize as weakly not taken
-            }
-            return (branch_history_table[pc] == WEAKLY_TAKEN || 
-                    branch_history_table[pc] == STRONGLY_TAKEN);
-            
+            return predictWith<BranchPolicy::TwoBit>(pc);
+
+        case GSHARE:
+            return predictWith<BranchPolicy::Gshare>(pc);
+
         default:
             return false;
     }
 }
 
 void BranchPredictor::update(uint32_t pc, bool actual_outcome) {
-    // Check if prediction was correct
+    // Check if prediction was correct, then train the entry
     bool predicted_outcome = false;
-    
+
     switch (predictor_type) {
         case STATIC_NOT_TAKEN:
-            predicted_outcome = false;
+            predicted_outcome = trainWith<BranchPolicy::StaticNotTaken>(pc, actual_outcome);
             break;
-            
+
         case STATIC_TAKEN:
-            predicted_outcome = true;
+            predicted_outcome = trainWith<BranchPolicy::StaticTaken>(pc, actual_outcome);
             break;
-            
+
         case DYNAMIC_1BIT:
-            if (branch_history_table.find(pc) != branch_history_table.end()) {
-                predicted_outcome = (branch_history_table[pc] == 1);
-            }
-            // Update 1-bit predictor
-            branch_history_table[pc] = actual_outcome ? 1 : 0;
+            predicted_outcome = trainWith<BranchPolicy::OneBit>(pc, actual_outcome);
+            break;
+
+        case DYNAMIC_2BIT:
+            predicted_outcome = trainWith<BranchPolicy::TwoBit>(pc, actual_outcome);
+            break;
+
+        case GSHARE:
+            predicted_outcome = trainWith<BranchPolicy::Gshare>(pc, actual_outcome);
+            break;
+    }
+
+    // predict() already counted this branch in total_predictions
+    recordOutcome(predicted_outcome, actual_outcome);
+}
+
+template <typename Policy>
+void BranchPredictor::replayTraceWith(const std::vector<BranchRecord>& trace) {
+    for (const BranchRecord& record : trace) {
+        resolveWith<Policy>(record.pc(), record.taken(), record.target);
+    }
+}
+
+void BranchPredictor::replayTrace(const std::vector<BranchRecord>& trace) {
+    switch (predictor_type) {
+        case STATIC_NOT_TAKEN:
+            replayTraceWith<BranchPolicy::StaticNotTaken>(trace);
+            break;
+        case STATIC_TAKEN:
+            replayTraceWith<BranchPolicy::StaticTaken>(trace);
+            break;
+        case DYNAMIC_1BIT:
+            replayTraceWith<BranchPolicy::OneBit>(trace);
             break;
-            
         case DYNAMIC_2BIT:
-            if (branch_history_table.find(pc) != branch_history_table.end()) {
-                uint8_t state = branch_history_table[pc];
-                predicted_outcome = (state == WEAKLY_TAKEN || state == STRONGLY_TAKEN);
-                
-                // Update 2-bit predictor state machine
-                if (actual_outcome) {
-                    // Branch was taken
-                    switch (state) {
-                        case STRONGLY_NOT_TAKEN:
-                            branch_history_table[pc] = WEAKLY_NOT_TAKEN;
-                            break;
-                        case WEAKLY_NOT_TAKEN:
-                            branch_history_table[pc] = WEAKLY_TAKEN;
-                            break;
-                        case WEAKLY_TAKEN:
-                            branch_history_table[pc] = STRONGLY_TAKEN;
-                            break;
-                        case STRONGLY_TAKEN:
-                            // Stay in strongly taken
-                            break;
-                    }
-                } else {
-                    // Branch was not taken
-                    switch (state) {
-                        case STRONGLY_NOT_TAKEN:
-                            // Stay in strongly not taken
-                            break;
-                        case WEAKLY_NOT_TAKEN:
-                            branch_history_table[pc] = STRONGLY_NOT_TAKEN;
-                            break;
-                        case WEAKLY_TAKEN:
-                            branch_history_table[pc] = WEAKLY_NOT_TAKEN;
-                            break;
-                        case STRONGLY_TAKEN:
-                            branch_history_table[pc] = WEAKLY_TAKEN;
-                            break;
-                    }
-                }
+            replayTraceWith<BranchPolicy::TwoBit>(trace);
+            break;
+        case GSHARE:
+            replayTraceWith<BranchPolicy::Gshare>(trace);
+            break;
+    }
+}
+
+bool BranchPredictor::resolveLoop(uint32_t pc, bool actual_outcome, bool base_prediction) {
+    LoopEntry& entry = loop_table[(pc >> 2) & ((1u << LOOP_TABLE_BITS) - 1)];
+    bool predicted_outcome = base_prediction;
+    
+    if (!entry.valid || entry.tag != pc) {
+        // Only displace an entry that has not proven its trip count
+        if (entry.valid && entry.confidence > 0) {
+            entry.confidence--;
+            return predicted_outcome;
+        }
+        entry = {pc, 0, 0, 0, true};
+    }
+    
+    // A confident entry overrides the base predictor
+    if (entry.confidence >= LOOP_CONFIDENT) {
+        predicted_outcome = entry.current_iter < entry.trip_count;
+        stats.loop_overrides++;
+        if (predicted_outcome != base_prediction) {
+            if (predicted_outcome == actual_outcome) {
+                stats.loop_mispredicts_removed++;
             } else {
-                // Initialize entry
-                branch_history_table[pc] = actual_outcome ? WEAKLY_TAKEN : WEAKLY_NOT_TAKEN;
+                stats.loop_mispredicts_added++;
             }
-            break;
+        }
     }
     
-    // Update statistics
-    if (predicted_outcome == actual_outcome) {
-        stats.correct_predictions++;
+    // Taken means another iteration; not taken ends the loop
+    if (actual_outcome) {
+        if (entry.current_iter == 0xFFFF) {
+            entry.valid = false;
+        } else {
+            entry.current_iter++;
+        }
     } else {
-        stats.incorrect_predictions++;
+        if (entry.current_iter == entry.trip_count) {
+            if (entry.confidence < LOOP_MAX_CONFIDENCE) entry.confidence++;
+        } else {
+            entry.trip_count = entry.current_iter;
+            entry.confidence = 0;
+        }
+        entry.current_iter = 0;
     }
     
-    // Update accuracy
-    if (stats.total_predictions > 0) {
-        stats.accuracy = (double)stats.correct_predictions / stats.total_predictions * 100.0;
+    return predicted_outcome;
+}
+
+uint8_t BranchPredictor::initialState() const {
+    switch (predictor_type) {
+        case DYNAMIC_1BIT:
+            return BranchPolicy::OneBit::initial_state;
+        case DYNAMIC_2BIT:
+            return BranchPolicy::TwoBit::initial_state;
+        case GSHARE:
+            return BranchPolicy::Gshare::initial_state;
+        default:
+            return 0;
     }
 }
 
 void BranchPredictor::reset() {
-    branch_history_table.clear();
+    std::fill(branch_history_table.begin(), branch_history_table.end(), initialState());
+    global_history = 0;
+    for (auto& entry : loop_table) {
+        entry = {0, 0, 0, 0, false};
+    }
     stats.total_predictions = 0;
     stats.correct_predictions = 0;
     stats.incorrect_predictions = 0;
     stats.accuracy = 0.0;
+    stats.loop_overrides = 0;
+    stats.loop_mispredicts_removed = 0;
+    stats.loop_mispredicts_added = 0;
 }
 
 BranchPredictor::PredictionStats BranchPredictor::getStats() const {
-    return stats;
+    PredictionStats result = stats;
+    if (result.total_predictions > 0) {
+        result.accuracy = (double)result.correct_predictions / result.total_predictions * 100.0;
+    }
+    return result;
 }
 
 std::string BranchPredictor::getStatsString() const {
     std::ostringstream oss;
-    
+    PredictionStats current = getStats();
+
     oss << "Branch Prediction Statistics:\n";
     oss << "============================\n";
-    
+
     const char* type_names[] = {
         "Static Not Taken",
-        "Static Taken", 
+        "Static Taken",
         "Dynamic 1-bit",
-        "Dynamic 2-bit"
+        "Dynamic 2-bit",
+        "Gshare"
     };
-    
+
     oss << "Predictor Type: " << type_names[predictor_type] << "\n";
-    oss << "Total Predictions: " << stats.total_predictions << "\n";
-    oss << "Correct Predictions: " << stats.correct_predictions << "\n";
-    oss << "Incorrect Predictions: " << stats.incorrect_predictions << "\n";
-    oss << "Accuracy: " << std::fixed << std::setprecision(2) << stats.accuracy << "%\n";
+    oss << "Total Predictions: " << current.total_predictions << "\n";
+    oss << "Correct Predictions: " << current.correct_predictions << "\n";
+    oss << "Incorrect Predictions: " << current.incorrect_predictions << "\n";
+    oss << "Accuracy: " << std::fixed << std::setprecision(2) << current.accuracy << "%\n";
     
-    if (predictor_type == DYNAMIC_1BIT || predictor_type == DYNAMIC_2BIT) {
+    if (loop_predictor_enabled) {
+        oss << "\nLoop Predictor (" << loop_table.size() << " entries):\n";
+        oss << "Overrides: " << current.loop_overrides << "\n";
+        oss << "Mispredicts Removed: " << current.loop_mispredicts_removed << "\n";
+        oss << "Mispredicts Added: " << current.loop_mispredicts_added << "\n";
+        oss << "Net Mispredicts Removed: "
+            << current.loop_mispredicts_removed - current.loop_mispredicts_added << "\n";
+    }
+
+    if (predictor_type == DYNAMIC_1BIT || predictor_type == DYNAMIC_2BIT || predictor_type == GSHARE) {
         oss << "\nBranch History Table Entries: " << branch_history_table.size() << "\n";
-        
-        if (!branch_history_table.empty()) {
-            oss << "Sample Entries:\n";
-            int count = 0;
-            for (const auto& entry : branch_history_table) {
-                if (count >= 5) break; // Show only first 5 entries
-                oss << "  PC: 0x" << std::hex << std::setw(8) << std::setfill('0') 
-                    << entry.first << " -> State: " << std::dec << (int)entry.second << "\n";
-                count++;
-            }
+
+        uint8_t initial = initialState();
+        int count = 0;
+        for (size_t i = 0; i < branch_history_table.size() && count < 5; i++) {
+            if (branch_history_table[i] == initial) continue;
+            if (count == 0) oss << "Sample Entries:\n";
+            oss << "  Index: 0x" << std::hex << std::setw(4) << std::setfill('0')
+                << i << " -> State: " << std::dec << (int)branch_history_table[i] << "\n";
+            count++;
         }
     }
-    
+
     return oss.str();
 }
 
@@ -172,3 +230,55 @@ void BranchPredictor::setPredictorType(PredictorType type) {
     predictor_type = type;
     reset();
 }
+
+BranchPredictor::PredictorType BranchPredictor::getPredictorType() const {
+    return predictor_type;
+}
+
+void BranchPredictor::enableLoopPredictor(bool enable) {
+    loop_predictor_enabled = enable;
+    reset();
+}
+
+bool BranchPredictor::isLoopPredictorEnabled() const {
+    return loop_predictor_enabled;
+}
+
+bool BranchPredictor::parseType(const std::string& name, PredictorType& type) {
+    if (name == "static" || name == "not-taken") {
+        type = STATIC_NOT_TAKEN;
+    } else if (name == "taken") {
+        type = STATIC_TAKEN;
+    } else if (name == "1bit" || name == "dynamic") {
+        type = DYNAMIC_1BIT;
+    } else if (name == "2bit") {
+        type = DYNAMIC_2BIT;
+    } else if (name == "gshare") {
+        type = GSHARE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void BranchPredictor::saveState(CheckpointFile& file) const {
+    file.put(predictor_type);
+    file.put(loop_predictor_enabled);
+    file.put((uint32_t)branch_history_table.size());
+    file.putBytes(branch_history_table.data(), branch_history_table.size());
+    file.put(global_history);
+    file.put(stats);
+    file.putBytes(loop_table.data(), loop_table.size() * sizeof(LoopEntry));
+}
+
+bool BranchPredictor::loadState(CheckpointFile& file) {
+    PredictorType type;
+    bool loop_enabled;
+    uint32_t table_size;
+    if (!file.get(type) || !file.get(loop_enabled) || !file.get(table_size) || type != predictor_type ||
+        loop_enabled != loop_predictor_enabled || table_size != branch_history_table.size()) {
+        return false;
+    }
+    return file.getBytes(branch_history_table.data(), table_size) && file.get(global_history) &&
+           file.get(stats) && file.getBytes(loop_table.data(), loop_table.size() * sizeof(LoopEntry));
+}
@@ -0,0 +1,227 @@
+#include "branch_target_predictor.hpp"
+#include "checkpoint_file.hpp"
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+BranchTargetPredictor::BranchTargetPredictor(int btb_sets, int btb_ways, int ras_depth, int indirect_bits)
+    : num_sets(btb_sets > 0 ? btb_sets : 1),
+      num_ways(btb_ways > 0 ? btb_ways : 1),
+      return_stack(ras_depth > 0 ? ras_depth : 1, 0),
+      indirect_table(1u << indirect_bits),
+      indirect_mask((1u << indirect_bits) - 1) {
+    btb.resize(num_sets * num_ways);
+    reset();
+}
+
+BranchTargetPredictor::~BranchTargetPredictor() {}
+
+const BranchTargetPredictor::BTBEntry* BranchTargetPredictor::findEntry(uint32_t pc) const {
+    uint32_t set = (pc >> 2) % num_sets;
+    const BTBEntry* ways = &btb[set * num_ways];
+
+    for (int i = 0; i < num_ways; i++) {
+        if (ways[i].valid && ways[i].tag == pc) {
+            return &ways[i];
+        }
+    }
+    return nullptr;
+}
+
+void BranchTargetPredictor::allocateEntry(uint32_t pc, BranchKind kind, uint32_t target) {
+    uint32_t set = (pc >> 2) % num_sets;
+    BTBEntry* ways = &btb[set * num_ways];
+    BTBEntry* victim = &ways[0];
+
+    for (int i = 0; i < num_ways; i++) {
+        if (ways[i].valid && ways[i].tag == pc) {
+            victim = &ways[i];
+            break;
+        }
+        // Prefer an empty way, otherwise evict the least recently used one
+        if (!ways[i].valid) {
+            if (victim->valid) victim = &ways[i];
+        } else if (victim->valid && ways[i].lru < victim->lru) {
+            victim = &ways[i];
+        }
+    }
+
+    victim->tag = pc;
+    victim->target = target;
+    victim->kind = kind;
+    victim->lru = ++lru_clock;
+    victim->valid = true;
+}
+
+uint32_t BranchTargetPredictor::indirectIndex(uint32_t pc) const {
+    return ((pc >> 2) ^ path_history) & indirect_mask;
+}
+
+BranchTargetPredictor::Prediction BranchTargetPredictor::predict(uint32_t pc) const {
+    Prediction prediction = {false, KIND_NONE, pc + 4};
+
+    const BTBEntry* entry = findEntry(pc);
+    if (entry == nullptr) {
+        return prediction;
+    }
+
+    prediction.hit = true;
+    prediction.kind = entry->kind;
+    prediction.target = entry->target;
+
+    if (entry->kind == KIND_RETURN && ras_count > 0) {
+        prediction.target = return_stack[ras_top];
+    } else if (entry->kind == KIND_INDIRECT) {
+        const IndirectEntry& indirect = indirect_table[indirectIndex(pc)];
+        if (indirect.valid) {
+            prediction.target = indirect.target;
+        }
+    }
+
+    return prediction;
+}
+
+void BranchTargetPredictor::update(uint32_t pc, BranchKind kind, bool taken, uint32_t target) {
+    if (kind == KIND_NONE) return;
+
+    // Score the prediction fetch would have made before training
+    Prediction predicted = predict(pc);
+    stats.lookups++;
+    if (predicted.hit) {
+        stats.btb_hits++;
+    } else {
+        stats.btb_misses++;
+    }
+
+    if (kind == KIND_RETURN && ras_count > 0) {
+        stats.ras_predictions++;
+        if (return_stack[ras_top] == target) stats.ras_correct++;
+    } else if (kind == KIND_INDIRECT && indirect_table[indirectIndex(pc)].valid) {
+        stats.indirect_predictions++;
+        if (indirect_table[indirectIndex(pc)].target == target) stats.indirect_correct++;
+    }
+
+    if (taken && (!predicted.hit || predicted.target != target)) {
+        stats.target_mispredictions++;
+    }
+
+    // Train the return address stack and indirect table
+    int depth = (int)return_stack.size();
+    switch (kind) {
+        case KIND_CALL:
+            // Matches the link value JAL writes to $ra
+            ras_top = (ras_top + 1) % depth;
+            return_stack[ras_top] = pc + 8;
+            if (ras_count < depth) ras_count++;
+            break;
+
+        case KIND_RETURN:
+            if (ras_count > 0) {
+                ras_top = (ras_top + depth - 1) % depth;
+                ras_count--;
+            }
+            break;
+
+        case KIND_INDIRECT:
+            indirect_table[indirectIndex(pc)] = {target, true};
+            path_history = ((path_history << 2) ^ (target >> 2)) & indirect_mask;
+            break;
+
+        default:
+            break;
+    }
+
+    // Only taken transfers earn a BTB entry; not-taken branches fall through anyway
+    if (taken) {
+        allocateEntry(pc, kind, target);
+    }
+}
+
+void BranchTargetPredictor::reset() {
+    for (auto& entry : btb) {
+        entry = {0, 0, 0, KIND_NONE, false};
+    }
+    for (auto& entry : indirect_table) {
+        entry = {0, false};
+    }
+    std::fill(return_stack.begin(), return_stack.end(), 0);
+
+    lru_clock = 0;
+    ras_top = 0;
+    ras_count = 0;
+    path_history = 0;
+    stats = {0, 0, 0, 0, 0, 0, 0, 0};
+}
+
+BranchTargetPredictor::TargetStats BranchTargetPredictor::getStats() const {
+    return stats;
+}
+
+std::string BranchTargetPredictor::getStatsString() const {
+    std::ostringstream oss;
+
+    oss << "Branch Target Prediction:\n";
+    oss << "BTB: " << num_sets << " sets x " << num_ways << " ways, RAS depth "
+        << return_stack.size() << ", indirect entries " << indirect_table.size() << "\n";
+    oss << "Target Lookups: " << stats.lookups << "\n";
+    oss << "BTB Hits: " << stats.btb_hits << "\n";
+    oss << "BTB Misses: " << stats.btb_misses << "\n";
+    oss << "RAS Predictions: " << stats.ras_predictions
+        << " (correct " << stats.ras_correct << ")\n";
+    oss << "Indirect Predictions: " << stats.indirect_predictions
+        << " (correct " << stats.indirect_correct << ")\n";
+    oss << "Target Mispredictions: " << stats.target_mispredictions << "\n";
+
+    return oss.str();
+}
+
+void BranchTargetPredictor::saveState(CheckpointFile& file) const {
+    file.put(num_sets);
+    file.put(num_ways);
+    file.put((uint32_t)return_stack.size());
+    file.put((uint32_t)indirect_table.size());
+    file.putBytes(btb.data(), btb.size() * sizeof(BTBEntry));
+    file.put(lru_clock);
+    file.putBytes(return_stack.data(), return_stack.size() * sizeof(uint32_t));
+    file.put(ras_top);
+    file.put(ras_count);
+    file.putBytes(indirect_table.data(), indirect_table.size() * sizeof(IndirectEntry));
+    file.put(path_history);
+    file.put(stats);
+}
+
+bool BranchTargetPredictor::loadState(CheckpointFile& file) {
+    int sets, ways;
+    uint32_t ras_depth, indirect_size;
+    if (!file.get(sets) || !file.get(ways) || !file.get(ras_depth) || !file.get(indirect_size) ||
+        sets != num_sets || ways != num_ways || ras_depth != return_stack.size() ||
+        indirect_size != indirect_table.size()) {
+        return false;
+    }
+    if (!file.getBytes(btb.data(), btb.size() * sizeof(BTBEntry)) || !file.get(lru_clock) ||
+        !file.getBytes(return_stack.data(), return_stack.size() * sizeof(uint32_t)) ||
+        !file.get(ras_top) || !file.get(ras_count) ||
+        !file.getBytes(indirect_table.data(), indirect_table.size() * sizeof(IndirectEntry)) ||
+        !file.get(path_history) || !file.get(stats)) {
+        return false;
+    }
+
+    // The return stack and BTB entries are indexed and switched on, so
+    // reject values the predictor could never have saved
+    int depth = (int)return_stack.size();
+    if (ras_top < 0 || ras_top >= depth || ras_count < 0 || ras_count > depth) {
+        return false;
+    }
+    for (const BTBEntry& entry : btb) {
+        std::underlying_type<BranchKind>::type kind;
+        std::memcpy(&kind, &entry.kind, sizeof(kind));
+        if (!CheckpointFile::isFlag(entry.valid) || kind < KIND_NONE || kind > KIND_INDIRECT ||
+            entry.lru > lru_clock) {
+            return false;
+        }
+    }
+    return std::all_of(indirect_table.begin(), indirect_table.end(),
+                       [](const IndirectEntry& entry) { return CheckpointFile::isFlag(entry.valid); });
+}
@@ -0,0 +1,127 @@
+#include "cache_model.hpp"
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+
+static bool isPowerOfTwo(uint32_t value) {
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+CacheModel::CacheModel() : size(0), num_ways(1), line_shift(0), set_mask(0), lru_clock(0) {
+    reset();
+}
+
+CacheModel::~CacheModel() {}
+
+bool CacheModel::configure(uint32_t cache_size, uint32_t ways, uint32_t line_size) {
+    size = 0;
+    lines.clear();
+    if (!isPowerOfTwo(cache_size) || !isPowerOfTwo(line_size) || ways == 0 ||
+        cache_size % (ways * line_size) != 0) {
+        reset();
+        return false;
+    }
+    uint32_t sets = cache_size / (ways * line_size);
+    if (!isPowerOfTwo(sets)) {
+        reset();
+        return false;
+    }
+
+    size = cache_size;
+    num_ways = ways;
+    line_shift = 0;
+    while ((1u << line_shift) < line_size) line_shift++;
+    set_mask = sets - 1;
+    lines.resize(sets * ways);
+    reset();
+    return true;
+}
+
+bool CacheModel::isEnabled() const {
+    return size != 0;
+}
+
+void CacheModel::reset() {
+    for (Line& line : lines) {
+        line = {0, 0, false, false};
+    }
+    lru_clock = 0;
+    stats = {0, 0, 0, 0};
+}
+
+bool CacheModel::access(uint32_t address, bool write) {
+    stats.accesses++;
+    if (size == 0) {
+        stats.hits++;
+        return true;
+    }
+
+    uint32_t block = address >> line_shift;
+    Line* ways = &lines[(block & set_mask) * num_ways];
+    Line* victim = &ways[0];
+    for (uint32_t i = 0; i < num_ways; i++) {
+        if (ways[i].valid && ways[i].tag == block) {
+            ways[i].lru = ++lru_clock;
+            ways[i].dirty |= write;
+            stats.hits++;
+            return true;
+        }
+        // Prefer an empty way, otherwise evict the least recently used one
+        if (!ways[i].valid) {
+            if (victim->valid) victim = &ways[i];
+        } else if (victim->valid && ways[i].lru < victim->lru) {
+            victim = &ways[i];
+        }
+    }
+
+    stats.misses++;
+    if (victim->valid && victim->dirty) {
+        stats.writebacks++;
+    }
+    *victim = {block, ++lru_clock, true, write};
+    return false;
+}
+
+CacheModel::CacheStats CacheModel::getStats() const {
+    return stats;
+}
+
+std::string CacheModel::getStatsString(const std::string& name) const {
+    std::ostringstream oss;
+    if (size == 0) {
+        oss << name << ": disabled\n";
+        return oss.str();
+    }
+
+    double miss_rate = stats.accesses > 0 ? 100.0 * stats.misses / stats.accesses : 0.0;
+    oss << name << ": " << size / 1024.0 << " KB, " << num_ways << "-way, "
+        << (1u << line_shift) << "-byte lines\n";
+    oss << "  Accesses: " << stats.accesses << ", Misses: " << stats.misses
+        << " (" << std::fixed << std::setprecision(2) << miss_rate << "%)"
+        << ", Writebacks: " << stats.writebacks << "\n";
+    return oss.str();
+}
+
+bool CacheModel::parseConfig(const std::string& text, uint32_t& cache_size, uint32_t& ways, uint32_t& line_size) {
+    const char* cursor = text.c_str();
+    char* end;
+    unsigned long fields[3];
+    for (int i = 0; i < 3; i++) {
+        fields[i] = std::strtoul(cursor, &end, 10);
+        if (end == cursor) {
+            return false;
+        }
+        if (i == 0 && (*end == 'k' || *end == 'K')) {
+            fields[i] *= 1024;
+            end++;
+        }
+        if (*end != (i < 2 ? ':' : '\0')) {
+            return false;
+        }
+        cursor = end + 1;
+    }
+    cache_size = (uint32_t)fields[0];
+    ways = (uint32_t)fields[1];
+    line_size = (uint32_t)fields[2];
+    return true;
+}
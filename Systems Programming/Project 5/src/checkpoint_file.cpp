@@ -0,0 +1,162 @@
+#include "checkpoint_file.hpp"
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+constexpr char CheckpointFile::MAGIC[8];
+
+CheckpointFile::CheckpointFile()
+    : cursor(0), page_size(0), memory_size(0), base(nullptr), length(0), state_data(nullptr), state_size(0) {}
+
+CheckpointFile::~CheckpointFile() {
+    close();
+}
+
+void CheckpointFile::putBytes(const void* data, size_t size) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    state.insert(state.end(), bytes, bytes + size);
+}
+
+void CheckpointFile::addPage(uint32_t number, const uint8_t* data) {
+    page_numbers.push_back(number);
+    page_data.push_back(data);
+}
+
+bool CheckpointFile::write(const std::string& filename, uint32_t page_size, uint32_t memory_size) const {
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    Header header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.page_size = page_size;
+    header.memory_size = memory_size;
+    header.page_count = page_numbers.size();
+    header.pages_offset = sizeof(Header);
+    header.state_offset = header.pages_offset + page_numbers.size() * sizeof(uint32_t);
+    header.state_size = state.size();
+    uint64_t state_end = header.state_offset + state.size();
+    header.memory_offset = (state_end + FILE_ALIGNMENT - 1) / FILE_ALIGNMENT * FILE_ALIGNMENT;
+
+    file.write((const char*)&header, sizeof(header));
+    file.write((const char*)page_numbers.data(), page_numbers.size() * sizeof(uint32_t));
+    file.write((const char*)state.data(), state.size());
+    std::vector<char> padding(header.memory_offset - state_end, 0);
+    file.write(padding.data(), padding.size());
+    for (const uint8_t* data : page_data) {
+        file.write((const char*)data, page_size);
+    }
+    file.close();
+    return !file.fail();
+}
+
+bool CheckpointFile::read(const std::string& filename) {
+    close();
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(Header)) {
+        ::close(fd);
+        return false;
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    base = (const uint8_t*)mapping;
+    length = info.st_size;
+
+    Header header;
+    std::memcpy(&header, base, sizeof(header));
+    uint64_t pages_end = header.pages_offset + (uint64_t)header.page_count * sizeof(uint32_t);
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+        header.page_size == 0 || header.pages_offset < sizeof(Header) || pages_end > length ||
+        header.state_offset < pages_end || header.state_offset + header.state_size > length ||
+        header.memory_offset < header.state_offset + header.state_size ||
+        header.memory_offset + (uint64_t)header.page_count * header.page_size > length) {
+        close();
+        return false;
+    }
+
+    page_size = header.page_size;
+    memory_size = header.memory_size;
+    page_numbers.resize(header.page_count);
+    std::memcpy(page_numbers.data(), base + header.pages_offset, header.page_count * sizeof(uint32_t));
+    for (uint32_t i = 0; i < header.page_count; i++) {
+        page_data.push_back(base + header.memory_offset + (uint64_t)i * page_size);
+    }
+    state_data = base + header.state_offset;
+    state_size = header.state_size;
+    cursor = 0;
+    return true;
+}
+
+void CheckpointFile::close() {
+    if (base != nullptr) {
+        munmap((void*)base, length);
+    }
+    base = nullptr;
+    length = 0;
+    state_data = nullptr;
+    state_size = 0;
+    cursor = 0;
+    page_numbers.clear();
+    page_data.clear();
+}
+
+bool CheckpointFile::getBytes(void* data, size_t size) {
+    if (state_size - cursor < size) {
+        return false;
+    }
+    std::memcpy(data, state_data + cursor, size);
+    cursor += size;
+    return true;
+}
+
+bool CheckpointFile::get(bool& value) {
+    uint8_t byte;
+    if (!getBytes(&byte, sizeof(byte)) || byte > 1) {
+        return false;
+    }
+    value = byte != 0;
+    return true;
+}
+
+bool CheckpointFile::isFlag(const bool& flag) {
+    uint8_t byte;
+    std::memcpy(&byte, &flag, sizeof(byte));
+    return byte <= 1;
+}
+
+bool CheckpointFile::isStateConsumed() const {
+    return cursor == state_size;
+}
+
+uint32_t CheckpointFile::getPageSize() const {
+    return page_size;
+}
+
+uint32_t CheckpointFile::getMemorySize() const {
+    return memory_size;
+}
+
+size_t CheckpointFile::getPageCount() const {
+    return page_numbers.size();
+}
+
+uint32_t CheckpointFile::getPageNumber(size_t index) const {
+    return page_numbers[index];
+}
+
+const uint8_t* CheckpointFile::getPageData(size_t index) const {
+    return page_data[index];
+}
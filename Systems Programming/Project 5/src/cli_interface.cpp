@@ -1,9 +1,23 @@
 #include "mips_simulator.hpp"
 #include "instruction_decoder.hpp"
+#include "assembler.hpp"
+#include "host_profiler.hpp"
 #include <iostream>
 #include <sstream>
+#include <fstream>
 #include <iomanip>
 #include <string>
+#include <cctype>
+#include <csignal>
+
+// Ctrl-C during run stops the simulation and returns to the prompt
+static MIPSSimulator* interrupt_target = nullptr;
+
+static void interruptRun(int) {
+    if (interrupt_target != nullptr) {
+        interrupt_target->requestStop();
+    }
+}
 
 class CLIInterface {
 private:
@@ -11,7 +25,9 @@ private:
     bool running;
     
 public:
-    CLIInterface() : running(true) {}
+    CLIInterface() : running(true) {
+        simulator.enableReverseExecution(true);
+    }
     
     void run() {
         printWelcome();
@@ -53,10 +69,44 @@ private:
             loadProgram(filename);
         } else if (cmd == "loadhex" || cmd == "lh") {
             loadHexProgram();
+        } else if (cmd == "loadasm" || cmd == "la") {
+            std::string filename;
+            iss >> filename;
+            loadAssembly(filename);
         } else if (cmd == "step" || cmd == "s") {
             step();
         } else if (cmd == "run" || cmd == "r") {
             run_simulation();
+        } else if (cmd == "reverse-step" || cmd == "rs") {
+            std::string count_str;
+            iss >> count_str;
+            reverseStep(count_str);
+        } else if (cmd == "reverse-continue" || cmd == "rc") {
+            reverseContinue();
+        } else if (cmd == "break" || cmd == "b") {
+            std::string addr_str, if_str, reg_str, op_str, val_str;
+            iss >> addr_str >> if_str >> reg_str >> op_str >> val_str;
+            addBreakpoint(addr_str, if_str, reg_str, op_str, val_str);
+        } else if (cmd == "delete") {
+            std::string addr_str;
+            iss >> addr_str;
+            deleteBreakpoint(addr_str);
+        } else if (cmd == "watch") {
+            std::string addr_str, kind_str;
+            iss >> addr_str >> kind_str;
+            addWatchpoint(addr_str, kind_str);
+        } else if (cmd == "unwatch") {
+            std::string addr_str;
+            iss >> addr_str;
+            deleteWatchpoint(addr_str);
+        } else if (cmd == "save") {
+            std::string filename;
+            iss >> filename;
+            saveCheckpoint(filename);
+        } else if (cmd == "restore") {
+            std::string filename;
+            iss >> filename;
+            restoreCheckpoint(filename);
         } else if (cmd == "reset") {
             reset();
         } else if (cmd == "state" || cmd == "st") {
@@ -83,14 +133,47 @@ private:
             std::string mode, type;
             iss >> mode >> type;
             configureBranchPrediction(mode, type);
+        } else if (cmd == "looppred") {
+            std::string mode;
+            iss >> mode;
+            toggleLoopPredictor(mode);
+        } else if (cmd == "penalty") {
+            std::string cycles_str;
+            iss >> cycles_str;
+            setPenalty(cycles_str);
+        } else if (cmd == "branchprof" || cmd == "bprof") {
+            std::string count_str;
+            iss >> count_str;
+            printBranchProfile(count_str);
+        } else if (cmd == "trace") {
+            std::string target;
+            iss >> target;
+            setTrace(target);
+        } else if (cmd == "timeline") {
+            std::string target;
+            iss >> target;
+            setTimeline(target);
+        } else if (cmd == "profile" || cmd == "prof") {
+            std::string arg, filename;
+            iss >> arg >> filename;
+            profileCommand(arg, filename);
         } else if (cmd == "stats") {
-            printStats();
+            std::string arg, filename;
+            iss >> arg >> filename;
+            printStats(arg, filename);
+        } else if (cmd == "cache") {
+            std::string which, config;
+            iss >> which >> config;
+            configureCache(which, config);
         } else if (cmd == "disasm" || cmd == "d") {
-            std::string addr_str;
-            iss >> addr_str;
-            disassemble(addr_str);
+            std::string addr_str, end_str;
+            iss >> addr_str >> end_str;
+            disassemble(addr_str, end_str);
         } else if (cmd == "quit" || cmd == "q" || cmd == "exit") {
             running = false;
+            if (HostProfiler::ENABLED) {
+                std::cout << HostProfiler::instance().getReportString();
+            }
             std::cout << "Goodbye!\n";
         } else {
             std::cout << "Unknown command: " << cmd << ". Type 'help' for available commands.\n";
@@ -103,21 +186,41 @@ private:
         std::cout << "Program Control:\n";
         std::cout << "  load <file>     - Load program from file\n";
         std::cout << "  loadhex         - Load program from hex input\n";
+        std::cout << "  loadasm [file]  - Assemble a source file, or assembly input\n";
         std::cout << "  step (s)        - Execute one instruction\n";
-        std::cout << "  run (r)         - Run until completion\n";
+        std::cout << "  run (r)         - Run until completion (Ctrl-C stops)\n";
+        std::cout << "  reverse-step (rs) [n] - Step back n instructions (default 1)\n";
+        std::cout << "  reverse-continue (rc) - Go back to the previous breakpoint or watchpoint stop\n";
+        std::cout << "  break <addr> [if <reg> == <val>] - Set a breakpoint; no address lists them\n";
+        std::cout << "  delete [addr]   - Delete a breakpoint, or all of them\n";
+        std::cout << "  watch <addr> [read|write] - Stop after an access to a word; no address lists them\n";
+        std::cout << "  unwatch [addr]  - Delete a watchpoint, or all of them\n";
+        std::cout << "  save <file>     - Save the simulator state to a checkpoint file\n";
+        std::cout << "  restore <file>  - Resume from a checkpoint file\n";
         std::cout << "  reset           - Reset simulator state\n";
         std::cout << "\nState Inspection:\n";
         std::cout << "  state (st)      - Show complete system state\n";
         std::cout << "  registers (reg) - Show register values\n";
         std::cout << "  memory <addr>   - Show memory contents at address\n";
-        std::cout << "  disasm <addr>   - Disassemble instruction at address\n";
+        std::cout << "  disasm <addr> [end] - Disassemble instruction at address, or a range\n";
         std::cout << "\nState Modification:\n";
         std::cout << "  setreg <reg> <val> - Set register value\n";
         std::cout << "  setmem <addr> <val> - Set memory value\n";
         std::cout << "\nAdvanced Features:\n";
         std::cout << "  pipeline <on/off>   - Enable/disable pipeline\n";
         std::cout << "  branch <on/off> [type] - Configure branch prediction\n";
-        std::cout << "  stats              - Show performance statistics\n";
+        std::cout << "  looppred <on/off>  - Enable/disable the loop predictor\n";
+        std::cout << "  penalty <cycles>   - Extra cycles charged per misprediction\n";
+        std::cout << "  branchprof [n]     - Show the n most mispredicted branches\n";
+        std::cout << "  trace <file|off>   - Record retired instructions to a binary trace\n";
+        std::cout << "  timeline <file|off> - Record pipeline stage occupancy as a Chrome trace\n";
+        std::cout << "  profile <on|off>   - Count executions (and cycles) per instruction\n";
+        std::cout << "  profile [n]        - Show the n hottest instructions and basic blocks\n";
+        std::cout << "  profile stacks <file> - Write collapsed call stacks for flame graphs\n";
+        std::cout << "  stats              - Show performance counters and statistics\n";
+        std::cout << "  stats reset        - Zero the performance counters\n";
+        std::cout << "  stats json [file]  - Print the counters as JSON, or write them to a file\n";
+        std::cout << "  cache <i|d> <SIZE:WAYS:LINE|off> - Count cache misses, e.g. cache d 8k:2:32\n";
         std::cout << "\nGeneral:\n";
         std::cout << "  help (h)        - Show this help\n";
         std::cout << "  quit (q)        - Exit simulator\n\n";
@@ -154,10 +257,41 @@ private:
         }
     }
     
+    void loadAssembly(const std::string& filename) {
+        Assembler assembler;
+        bool assembled;
+        if (filename.empty()) {
+            std::cout << "Enter MIPS assembly (empty line to finish):\n";
+            std::string source;
+            std::string line;
+            while (std::getline(std::cin, line)) {
+                if (line.empty()) break;
+                source += line + "\n";
+            }
+            assembled = assembler.assemble(source);
+        } else {
+            assembled = assembler.assembleFile(filename);
+        }
+        
+        if (!assembled) {
+            std::cout << "Error: Assembly failed:\n" << assembler.getErrorString();
+            return;
+        }
+        simulator.loadProgramImage(assembler.getImage());
+        std::cout << "Program assembled successfully (" << assembler.getInstructionCount()
+                  << " instructions).\n";
+    }
+    
     void step() {
         if (simulator.step()) {
             std::cout << "Instruction executed. PC = 0x" << std::hex << std::setw(8) 
                      << std::setfill('0') << simulator.getPC() << std::dec << "\n";
+        } else if (simulator.getStopReason() == MIPSSimulator::STOP_WATCHPOINT) {
+            printWatchHit();
+            std::cout << "PC = 0x" << std::hex << std::setw(8) << std::setfill('0')
+                      << simulator.getPC() << std::dec << "\n";
+        } else if (simulator.getStopReason() == MIPSSimulator::STOP_ADDRESS_ERROR) {
+            std::cout << simulator.getAddressErrorString() << "\n";
         } else {
             if (simulator.isHalted()) {
                 std::cout << "Simulation halted.\n";
@@ -168,15 +302,52 @@ private:
     }
     
     void run_simulation() {
-        std::cout << "Running simulation...\n";
-        
-        int instructions = 0;
-        while (!simulator.isHalted() && simulator.step()) {
-            instructions++;
-            if (instructions > 10000) {
-                std::cout << "Warning: Simulation stopped after 10000 instructions to prevent infinite loop.\n";
-                break;
+        std::cout << "Running simulation... (Ctrl-C to stop)\n";
+        interrupt_target = &simulator;
+        std::signal(SIGINT, interruptRun);
+        runUntilStopped();
+        std::signal(SIGINT, SIG_DFL);
+        interrupt_target = nullptr;
+    }
+    
+    void runUntilStopped() {
+        if (simulator.isReverseExecutionEnabled()) {
+            // Full speed to the end or the next breakpoint or watchpoint
+            uint64_t start = simulator.getRetiredCount();
+            MIPSSimulator::StopReason reason = simulator.run();
+            if (reason == MIPSSimulator::STOP_INTERRUPTED) {
+                printInterrupted(simulator.getRetiredCount() - start);
+                return;
+            } else if (reason == MIPSSimulator::STOP_BREAKPOINT) {
+                std::cout << "Breakpoint reached after " << simulator.getRetiredCount() - start
+                          << " instructions.\n";
+            } else if (reason == MIPSSimulator::STOP_WATCHPOINT) {
+                std::cout << "Watchpoint reached after " << simulator.getRetiredCount() - start
+                          << " instructions.\n";
+                printWatchHit();
+            } else if (reason == MIPSSimulator::STOP_ADDRESS_ERROR) {
+                std::cout << simulator.getAddressErrorString() << " after "
+                          << simulator.getRetiredCount() - start << " instructions.\n";
+            } else {
+                std::cout << "Simulation completed. Executed " << simulator.getRetiredCount() - start
+                          << " instructions.\n";
             }
+            std::cout << "PC = 0x" << std::hex << std::setw(8) << std::setfill('0')
+                      << simulator.getPC() << std::dec << "\n";
+            return;
+        }
+        
+        // Without history (pipeline on) there is no retired count, so
+        // count with the performance counters
+        uint64_t start = simulator.getPerfCounters().instructions;
+        MIPSSimulator::StopReason reason = simulator.run();
+        uint64_t instructions = simulator.getPerfCounters().instructions - start;
+        if (reason == MIPSSimulator::STOP_INTERRUPTED) {
+            printInterrupted(instructions);
+            return;
+        } else if (reason == MIPSSimulator::STOP_ADDRESS_ERROR) {
+            std::cout << simulator.getAddressErrorString() << " after " << instructions << " instructions.\n";
+            return;
         }
         
         std::cout << "Simulation completed. Executed " << instructions << " instructions.\n";
@@ -184,6 +355,263 @@ private:
                  << simulator.getPC() << std::dec << "\n";
     }
     
+    void printInterrupted(uint64_t instructions) {
+        std::cout << "\nInterrupted after " << instructions << " instructions.\n";
+        std::cout << "Stopped at PC = 0x" << std::hex << std::setw(8) << std::setfill('0')
+                  << simulator.getPC() << std::dec << std::setfill(' ') << "\n";
+    }
+    
+    void reverseStep(const std::string& count_str) {
+        if (!simulator.isReverseExecutionEnabled()) {
+            std::cout << "Error: Reverse execution is not available in pipeline mode.\n";
+            return;
+        }
+        
+        try {
+            uint64_t count = count_str.empty() ? 1 : std::stoull(count_str, nullptr, 0);
+            if (!simulator.reverseStep(count)) {
+                std::cout << "Error: Cannot step back past the start of the recorded history.\n";
+                return;
+            }
+            printPosition();
+        } catch (const std::exception& e) {
+            std::cout << "Error: Invalid instruction count.\n";
+        }
+    }
+    
+    void reverseContinue() {
+        if (!simulator.isReverseExecutionEnabled()) {
+            std::cout << "Error: Reverse execution is not available in pipeline mode.\n";
+            return;
+        }
+        simulator.reverseContinue();
+        if (simulator.isAtBreakpoint()) {
+            std::cout << "Breakpoint. ";
+        } else if (simulator.getStopReason() == MIPSSimulator::STOP_WATCHPOINT) {
+            printWatchHit();
+        }
+        printPosition();
+    }
+    
+    void profileCommand(const std::string& arg, const std::string& filename) {
+        if (arg == "on" || arg == "off") {
+            simulator.enableProfiling(arg == "on");
+            std::cout << "Profiling " << (arg == "on" ? "enabled (counts start now)" : "disabled") << ".\n";
+        } else if (arg == "stacks") {
+            if (filename.empty()) {
+                std::cout << "Usage: profile stacks <file>\n";
+            } else if (simulator.writeCollapsedStacks(filename)) {
+                std::cout << "Collapsed stacks written to " << filename << "\n";
+            } else {
+                std::cout << "Error: Profiling is off or the file could not be written.\n";
+            }
+        } else {
+            int top_n = 10;
+            if (!arg.empty()) {
+                try {
+                    top_n = std::stoi(arg);
+                } catch (const std::exception& e) {
+                    std::cout << "Usage: profile [on|off|n|stacks <file>]\n";
+                    return;
+                }
+            }
+            std::cout << simulator.getProfileString(top_n);
+        }
+    }
+    
+    void saveCheckpoint(const std::string& filename) {
+        if (filename.empty()) {
+            std::cout << "Usage: save <file>\n";
+        } else if (simulator.saveCheckpoint(filename)) {
+            std::cout << "Checkpoint saved to " << filename << "\n";
+        } else {
+            std::cout << "Error: Could not write checkpoint file: " << filename << "\n";
+        }
+    }
+    
+    void restoreCheckpoint(const std::string& filename) {
+        if (filename.empty()) {
+            std::cout << "Usage: restore <file>\n";
+        } else if (simulator.loadCheckpoint(filename)) {
+            std::cout << "Checkpoint restored. PC = 0x" << std::hex << std::setw(8) << std::setfill('0')
+                      << simulator.getPC() << std::dec << "\n";
+        } else {
+            std::cout << "Error: Could not restore " << filename
+                      << " (missing, another version, or saved with other pipeline or predictor settings).\n";
+        }
+    }
+    
+    void printWatchHit() {
+        const MIPSSimulator::WatchHit& hit = simulator.getWatchHit();
+        std::cout << std::hex << std::setfill('0') << "Watchpoint 0x" << std::setw(8) << hit.address << ": "
+                  << (hit.write ? "write" : "read") << " of 0x" << std::setw(8) << hit.access_address
+                  << " by instruction at 0x" << std::setw(8) << hit.pc << "\n";
+        if (hit.write) {
+            std::cout << "  Old value = 0x" << std::setw(8) << hit.old_value << "\n";
+            std::cout << "  New value = 0x" << std::setw(8) << hit.new_value << "\n";
+        } else {
+            std::cout << "  Value = 0x" << std::setw(8) << hit.new_value << "\n";
+        }
+        std::cout << std::dec;
+    }
+    
+    void addWatchpoint(const std::string& addr_str, const std::string& kind_str) {
+        if (addr_str.empty()) {
+            listWatchpoints();
+            return;
+        }
+        if (!kind_str.empty() && kind_str != "read" && kind_str != "write") {
+            std::cout << "Usage: watch <addr> [read|write]\n";
+            return;
+        }
+        
+        try {
+            uint32_t addr = std::stoul(addr_str, nullptr, 0);
+            bool read = kind_str == "read";
+            if (!simulator.addWatchpoint(addr, 4, read, !read)) {
+                std::cout << "Error: Watchpoint word must be in memory.\n";
+                return;
+            }
+            std::cout << "Watching " << (read ? "reads" : "writes") << " of 0x" << std::hex
+                      << std::setw(8) << std::setfill('0') << addr << std::dec << "\n";
+            if (!simulator.isReverseExecutionEnabled()) {
+                std::cout << "Note: Watchpoints only stop the functional model.\n";
+            }
+        } catch (const std::exception& e) {
+            std::cout << "Error: Invalid address format.\n";
+        }
+    }
+    
+    void deleteWatchpoint(const std::string& addr_str) {
+        if (addr_str.empty()) {
+            simulator.clearWatchpoints();
+            std::cout << "All watchpoints deleted.\n";
+            return;
+        }
+        
+        try {
+            uint32_t addr = std::stoul(addr_str, nullptr, 0);
+            if (simulator.removeWatchpoint(addr)) {
+                std::cout << "Watchpoint deleted.\n";
+            } else {
+                std::cout << "Error: No watchpoint at that address.\n";
+            }
+        } catch (const std::exception& e) {
+            std::cout << "Error: Invalid address format.\n";
+        }
+    }
+    
+    void listWatchpoints() {
+        const std::vector<MIPSSimulator::Watchpoint>& watchpoints = simulator.getWatchpoints();
+        if (watchpoints.empty()) {
+            std::cout << "No watchpoints.\n";
+            return;
+        }
+        for (const MIPSSimulator::Watchpoint& watch : watchpoints) {
+            std::cout << "0x" << std::hex << std::setw(8) << std::setfill('0') << watch.address << std::dec
+                      << "  " << (watch.read ? "read" : "write") << "\n";
+        }
+    }
+    
+    // Register by name or number, with or without the $
+    int parseRegister(const std::string& text) {
+        std::string name = (!text.empty() && text[0] == '$') ? text.substr(1) : text;
+        if (!name.empty() && std::isdigit((unsigned char)name[0])) {
+            int reg = std::stoi(name);
+            return (reg >= 0 && reg < 32) ? reg : -1;
+        }
+        for (int reg = 0; reg < 32; reg++) {
+            if (name == InstructionDecoder::registerName(reg) + 1) {
+                return reg;
+            }
+        }
+        return -1;
+    }
+    
+    void addBreakpoint(const std::string& addr_str, const std::string& if_str, const std::string& reg_str,
+                       const std::string& op_str, const std::string& val_str) {
+        if (addr_str.empty()) {
+            listBreakpoints();
+            return;
+        }
+        
+        try {
+            uint32_t addr = std::stoul(addr_str, nullptr, 0);
+            int reg = -1;
+            uint32_t value = 0;
+            if (!if_str.empty()) {
+                if (if_str != "if" || op_str != "==" || val_str.empty()) {
+                    std::cout << "Usage: break <addr> [if <reg> == <val>]\n";
+                    return;
+                }
+                reg = parseRegister(reg_str);
+                if (reg < 0) {
+                    std::cout << "Error: Unknown register: " << reg_str << "\n";
+                    return;
+                }
+                value = std::stoul(val_str, nullptr, 0);
+            }
+            
+            if (!simulator.addBreakpoint(addr, reg, value)) {
+                std::cout << "Error: Breakpoint address must be a word in memory.\n";
+                return;
+            }
+            std::cout << "Breakpoint set at 0x" << std::hex << std::setw(8) << std::setfill('0') << addr;
+            if (reg >= 0) {
+                std::cout << " if " << InstructionDecoder::registerName(reg) << " == 0x"
+                          << std::setw(8) << value;
+            }
+            std::cout << std::dec << "\n";
+            if (!simulator.isReverseExecutionEnabled()) {
+                std::cout << "Note: Breakpoints only stop the functional model.\n";
+            }
+        } catch (const std::exception& e) {
+            std::cout << "Error: Invalid address or value format.\n";
+        }
+    }
+    
+    void deleteBreakpoint(const std::string& addr_str) {
+        if (addr_str.empty()) {
+            simulator.clearBreakpoints();
+            std::cout << "All breakpoints deleted.\n";
+            return;
+        }
+        
+        try {
+            uint32_t addr = std::stoul(addr_str, nullptr, 0);
+            if (simulator.removeBreakpoint(addr)) {
+                std::cout << "Breakpoint deleted.\n";
+            } else {
+                std::cout << "Error: No breakpoint at that address.\n";
+            }
+        } catch (const std::exception& e) {
+            std::cout << "Error: Invalid address format.\n";
+        }
+    }
+    
+    void listBreakpoints() {
+        const std::vector<MIPSSimulator::Breakpoint>& breakpoints = simulator.getBreakpoints();
+        if (breakpoints.empty()) {
+            std::cout << "No breakpoints.\n";
+            return;
+        }
+        for (const MIPSSimulator::Breakpoint& breakpoint : breakpoints) {
+            char text[InstructionDecoder::MAX_DISASSEMBLY_LENGTH];
+            InstructionDecoder::disassemble(simulator.getMemory(breakpoint.address), text);
+            std::cout << "0x" << std::hex << std::setw(8) << std::setfill('0') << breakpoint.address;
+            if (breakpoint.reg >= 0) {
+                std::cout << " if " << InstructionDecoder::registerName(breakpoint.reg) << " == 0x"
+                          << std::setw(8) << breakpoint.value;
+            }
+            std::cout << std::dec << "  " << text << "\n";
+        }
+    }
+    
+    void printPosition() {
+        std::cout << "At instruction " << simulator.getRetiredCount() << ". PC = 0x" << std::hex
+                  << std::setw(8) << std::setfill('0') << simulator.getPC() << std::dec << "\n";
+    }
+    
     void reset() {
         simulator.reset();
         std::cout << "Simulator reset to initial state.\n";
@@ -197,17 +625,10 @@ private:
         std::cout << "\nRegister Values:\n";
         std::cout << "================\n";
         
-        const std::string reg_names[] = {
-            "$zero", "$at", "$v0", "$v1", "$a0", "$a1", "$a2", "$a3",
-            "$t0", "$t1", "$t2", "$t3", "$t4", "$t5", "$t6", "$t7",
-            "$s0", "$s1", "$s2", "$s3", "$s4", "$s5", "$s6", "$s7",
-            "$t8", "$t9", "$k0", "$k1", "$gp", "$sp", "$fp", "$ra"
-        };
-        
         for (int i = 0; i < 32; i += 4) {
             for (int j = 0; j < 4; j++) {
                 int reg = i + j;
-                std::cout << std::setw(5) << reg_names[reg] << ": 0x" 
+                std::cout << std::setw(5) << InstructionDecoder::registerName(reg) << ": 0x" 
                          << std::hex << std::setw(8) << std::setfill('0') 
                          << simulator.getRegister(reg) << "  ";
             }
@@ -274,9 +695,10 @@ private:
     void togglePipeline(const std::string& mode) {
         if (mode == "on" || mode == "enable" || mode == "1") {
             simulator.enablePipeline(true);
-            std::cout << "Pipeline simulation enabled.\n";
+            std::cout << "Pipeline simulation enabled (reverse execution off).\n";
         } else if (mode == "off" || mode == "disable" || mode == "0") {
             simulator.enablePipeline(false);
+            simulator.enableReverseExecution(true);
             std::cout << "Pipeline simulation disabled.\n";
         } else {
             std::cout << "Usage: pipeline <on|off>\n";
@@ -286,22 +708,126 @@ private:
     void configureBranchPrediction(const std::string& mode, const std::string& type) {
         if (mode == "on" || mode == "enable" || mode == "1") {
             std::string pred_type = type.empty() ? "static" : type;
-            simulator.enableBranchPrediction(true, pred_type);
-            std::cout << "Branch prediction enabled (" << pred_type << ").\n";
+            if (simulator.enableBranchPrediction(true, pred_type)) {
+                std::cout << "Branch prediction enabled (" << pred_type << ").\n";
+            } else {
+                std::cout << "Error: Unknown predictor type: " << pred_type << "\n";
+            }
         } else if (mode == "off" || mode == "disable" || mode == "0") {
             simulator.enableBranchPrediction(false);
             std::cout << "Branch prediction disabled.\n";
         } else {
-            std::cout << "Usage: branch <on|off> [static|dynamic]\n";
+            std::cout << "Usage: branch <on|off> [static|taken|1bit|2bit|gshare]\n";
+        }
+    }
+    
+    void toggleLoopPredictor(const std::string& mode) {
+        if (mode == "on" || mode == "enable" || mode == "1") {
+            simulator.enableLoopPredictor(true);
+            std::cout << "Loop predictor enabled.\n";
+        } else if (mode == "off" || mode == "disable" || mode == "0") {
+            simulator.enableLoopPredictor(false);
+            std::cout << "Loop predictor disabled.\n";
+        } else {
+            std::cout << "Usage: looppred <on|off>\n";
+        }
+    }
+    
+    void setPenalty(const std::string& cycles_str) {
+        if (cycles_str.empty()) {
+            std::cout << "Mispredict penalty: " << simulator.getMispredictPenalty() << " cycles\n";
+            return;
+        }
+        
+        try {
+            simulator.setMispredictPenalty(std::stoi(cycles_str));
+            std::cout << "Mispredict penalty set to " << simulator.getMispredictPenalty() << " cycles.\n";
+        } catch (const std::exception& e) {
+            std::cout << "Error: Invalid cycle count.\n";
+        }
+    }
+    
+    void printBranchProfile(const std::string& count_str) {
+        try {
+            int count = count_str.empty() ? 10 : std::stoi(count_str);
+            std::cout << "\n" << simulator.getBranchProfileString(count) << "\n";
+        } catch (const std::exception& e) {
+            std::cout << "Error: Invalid branch count.\n";
+        }
+    }
+    
+    void setTrace(const std::string& target) {
+        if (target.empty()) {
+            std::cout << "Tracing: " << (simulator.isTracing() ? "On" : "Off") << ", "
+                      << simulator.getTraceRecordCount() << " instructions recorded\n";
+        } else if (target == "off") {
+            bool was_tracing = simulator.isTracing();
+            if (!simulator.stopTrace()) {
+                std::cout << "Error: Could not write the trace file.\n";
+            } else if (was_tracing) {
+                std::cout << "Trace closed: " << simulator.getTraceRecordCount() << " instructions, "
+                          << simulator.getTraceByteCount() << " bytes.\n";
+            }
+        } else if (simulator.startTrace(target)) {
+            std::cout << "Tracing retired instructions to: " << target << "\n";
+        } else {
+            std::cout << "Error: Could not open trace file: " << target << "\n";
+        }
+    }
+    
+    void setTimeline(const std::string& target) {
+        if (target.empty()) {
+            std::cout << "Timeline: " << (simulator.isRecordingTimeline() ? "On" : "Off") << ", "
+                      << simulator.getTimelineEventCount() << " events written\n";
+        } else if (target == "off") {
+            bool was_recording = simulator.isRecordingTimeline();
+            if (!simulator.stopTimeline()) {
+                std::cout << "Error: Could not write the timeline file.\n";
+            } else if (was_recording) {
+                std::cout << "Timeline closed: " << simulator.getTimelineEventCount() << " events.\n";
+            }
+        } else if (simulator.startTimeline(target)) {
+            std::cout << "Recording the pipeline timeline to: " << target << "\n";
+        } else {
+            std::cout << "Error: Could not open timeline file (the pipeline must be on): " << target << "\n";
+        }
+    }
+    
+    void printStats(const std::string& arg, const std::string& filename) {
+        if (arg == "reset") {
+            simulator.resetPerfCounters();
+            std::cout << "Performance counters reset.\n";
+        } else if (arg == "json" && filename.empty()) {
+            std::cout << simulator.getPerfCountersJSON();
+        } else if (arg == "json") {
+            std::ofstream file(filename);
+            file << simulator.getPerfCountersJSON();
+            file.close();
+            if (file.fail()) {
+                std::cout << "Error: Could not write counter file: " << filename << "\n";
+            } else {
+                std::cout << "Performance counters written to: " << filename << "\n";
+            }
+        } else if (arg.empty()) {
+            std::cout << "\n" << simulator.getPerfCountersString();
+            std::cout << "\n" << simulator.getBranchPredictionStats();
+            std::cout << simulator.getPipelineStateString() << "\n";
+        } else {
+            std::cout << "Usage: stats [reset|json [file]]\n";
         }
     }
     
-    void printStats() {
-        std::cout << "\n" << simulator.getBranchPredictionStats();
-        std::cout << simulator.getPipelineStateString() << "\n";
+    void configureCache(const std::string& which, const std::string& config) {
+        if ((which != "i" && which != "d") || config.empty()) {
+            std::cout << "Usage: cache <i|d> <SIZE:WAYS:LINE|off>\n";
+        } else if (!simulator.configureCache(which == "i", config)) {
+            std::cout << "Error: Invalid cache configuration: " << config << "\n";
+        } else {
+            std::cout << (which == "i" ? "Instruction" : "Data") << " cache: " << config << "\n";
+        }
     }
     
-    void disassemble(const std::string& addr_str) {
+    void disassemble(const std::string& addr_str, const std::string& end_str) {
         if (addr_str.empty()) {
             std::cout << "Error: No address specified.\n";
             return;
@@ -309,11 +835,23 @@ private:
         
         try {
             uint32_t addr = std::stoul(addr_str, nullptr, 0);
+            if (!end_str.empty()) {
+                uint32_t end = std::stoul(end_str, nullptr, 0);
+                if (end < addr) {
+                    std::cout << "Error: End address is before start address.\n";
+                    return;
+                }
+                std::cout << simulator.disassembleRange(addr, end);
+                return;
+            }
+            
             uint32_t instruction = simulator.getMemory(addr);
+            char text[InstructionDecoder::MAX_DISASSEMBLY_LENGTH];
+            InstructionDecoder::disassemble(instruction, text);
             
             std::cout << "0x" << std::hex << std::setw(8) << std::setfill('0') << addr 
                      << ": 0x" << std::setw(8) << std::setfill('0') << instruction 
-                     << "  " << InstructionDecoder::disassemble(instruction) << std::dec << "\n";
+                     << "  " << text << std::dec << "\n";
         } catch (const std::exception& e) {
             std::cout << "Error: Invalid address format.\n";
         }
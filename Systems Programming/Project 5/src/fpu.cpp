@@ -0,0 +1,232 @@
+#include "fpu.hpp"
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+
+const int FPU::DEFAULT_LATENCY[MIPS::FPLAT_COUNT][2] = {
+    {1, 1},   // none
+    {1, 1},   // move, abs, neg, mtc1
+    {2, 2},   // add, sub
+    {4, 5},   // mul
+    {12, 19}, // div
+    {16, 31}, // sqrt
+    {3, 3},   // cvt
+    {2, 2},   // compare
+    {2, 2}    // lwc1, ldc1
+};
+
+FPU::FPU() : registers(32, 0), fcsr(0) {}
+
+bool FPU::parseLatencyName(const std::string& name, int& latency_class,
+                           int& first_precision, int& last_precision) {
+    static const char* const CLASS_NAMES[MIPS::FPLAT_COUNT] = {
+        "", "move", "add", "mul", "div", "sqrt", "cvt", "cmp", "load"
+    };
+    
+    std::string base = name;
+    first_precision = 0;
+    last_precision = 1;
+    if (name.size() > 2 && name[name.size() - 2] == '.') {
+        char precision = name.back();
+        if (precision != 's' && precision != 'd') return false;
+        first_precision = last_precision = (precision == 'd') ? 1 : 0;
+        base = name.substr(0, name.size() - 2);
+    }
+    
+    for (int i = MIPS::FPLAT_MOVE; i < MIPS::FPLAT_COUNT; i++) {
+        if (base == CLASS_NAMES[i]) {
+            latency_class = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void FPU::reset() {
+    std::fill(registers.begin(), registers.end(), 0);
+    fcsr = 0;
+}
+
+uint32_t FPU::getRegister(int reg) const {
+    if (reg >= 0 && reg < 32) return registers[reg];
+    return 0;
+}
+
+void FPU::setRegister(int reg, uint32_t bits) {
+    if (reg >= 0 && reg < 32) registers[reg] = bits;
+}
+
+float FPU::getSingle(int reg) const {
+    uint32_t bits = getRegister(reg);
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void FPU::setSingle(int reg, float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    setRegister(reg, bits);
+}
+
+uint64_t FPU::getDoubleBits(int reg) const {
+    int even = reg & ~1;
+    return ((uint64_t)getRegister(even + 1) << 32) | getRegister(even);
+}
+
+void FPU::setDoubleBits(int reg, uint64_t bits) {
+    int even = reg & ~1;
+    setRegister(even, (uint32_t)bits);
+    setRegister(even + 1, (uint32_t)(bits >> 32));
+}
+
+double FPU::getDouble(int reg) const {
+    uint64_t bits = getDoubleBits(reg);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void FPU::setDouble(int reg, double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    setDoubleBits(reg, bits);
+}
+
+uint32_t FPU::readControl(int reg) const {
+    if (reg == 31) return fcsr;
+    return 0; // FIR: no implementation or revision number
+}
+
+void FPU::writeControl(int reg, uint32_t value) {
+    if (reg == 31) fcsr = value;
+}
+
+bool FPU::getCondition() const {
+    return (fcsr & FCSR_CONDITION) != 0;
+}
+
+int32_t FPU::roundToWord(double value) const {
+    switch (fcsr & FCSR_ROUNDING_MASK) {
+        case 0: value = std::nearbyint(value); break; // Nearest, ties to even
+        case 1: value = std::trunc(value); break;
+        case 2: value = std::ceil(value); break;
+        default: value = std::floor(value); break;
+    }
+    // NaN and out-of-range values give the invalid-operation result
+    if (!(value >= -2147483648.0 && value <= 2147483647.0)) {
+        return 0x7FFFFFFF;
+    }
+    return (int32_t)value;
+}
+
+void FPU::compare(double a, double b, uint8_t condition) {
+    bool unordered = std::isnan(a) || std::isnan(b);
+    bool result = (unordered && (condition & 1)) ||
+                  (!unordered && a == b && (condition & 2)) ||
+                  (!unordered && a < b && (condition & 4));
+    fcsr = result ? (fcsr | FCSR_CONDITION) : (fcsr & ~FCSR_CONDITION);
+}
+
+void FPU::execute(uint32_t instruction, MIPS::Operation operation) {
+    uint8_t format = (instruction >> 21) & 0x1F;
+    uint8_t ft = (instruction >> 16) & 0x1F;
+    uint8_t fs = (instruction >> 11) & 0x1F;
+    uint8_t fd = (instruction >> 6) & 0x1F;
+    bool is_double = format == MIPS::COP1_FMT_D;
+    
+    // Source operand widened to double; singles convert exactly
+    double source = 0.0;
+    switch (format) {
+        case MIPS::COP1_FMT_S: source = getSingle(fs); break;
+        case MIPS::COP1_FMT_D: source = getDouble(fs); break;
+        case MIPS::COP1_FMT_W: source = (int32_t)getRegister(fs); break;
+    }
+    
+    switch (operation) {
+        case MIPS::OP_FADD:
+        case MIPS::OP_FSUB:
+        case MIPS::OP_FMUL:
+        case MIPS::OP_FDIV:
+            if (is_double) {
+                double a = getDouble(fs);
+                double b = getDouble(ft);
+                double result = operation == MIPS::OP_FADD ? a + b :
+                                operation == MIPS::OP_FSUB ? a - b :
+                                operation == MIPS::OP_FMUL ? a * b : a / b;
+                setDouble(fd, result);
+            } else {
+                float a = getSingle(fs);
+                float b = getSingle(ft);
+                float result = operation == MIPS::OP_FADD ? a + b :
+                               operation == MIPS::OP_FSUB ? a - b :
+                               operation == MIPS::OP_FMUL ? a * b : a / b;
+                setSingle(fd, result);
+            }
+            break;
+        case MIPS::OP_FSQRT:
+            if (is_double) {
+                setDouble(fd, std::sqrt(getDouble(fs)));
+            } else {
+                setSingle(fd, std::sqrt(getSingle(fs)));
+            }
+            break;
+        
+        // Sign-bit operations and moves copy the bits unchanged otherwise
+        case MIPS::OP_FABS:
+            if (is_double) {
+                setDoubleBits(fd, getDoubleBits(fs) & ~(1ull << 63));
+            } else {
+                setRegister(fd, getRegister(fs) & ~(1u << 31));
+            }
+            break;
+        case MIPS::OP_FNEG:
+            if (is_double) {
+                setDoubleBits(fd, getDoubleBits(fs) ^ (1ull << 63));
+            } else {
+                setRegister(fd, getRegister(fs) ^ (1u << 31));
+            }
+            break;
+        case MIPS::OP_FMOV:
+            if (is_double) {
+                setDoubleBits(fd, getDoubleBits(fs));
+            } else {
+                setRegister(fd, getRegister(fs));
+            }
+            break;
+        
+        case MIPS::OP_CVT_S:
+            setSingle(fd, (float)source);
+            break;
+        case MIPS::OP_CVT_D:
+            setDouble(fd, source);
+            break;
+        case MIPS::OP_CVT_W:
+            setRegister(fd, (uint32_t)roundToWord(source));
+            break;
+        
+        case MIPS::OP_FCMP:
+            compare(source, is_double ? getDouble(ft) : (double)getSingle(ft), instruction & 0xF);
+            break;
+        
+        default:
+            break;
+    }
+}
+
+std::string FPU::getStateString() const {
+    std::ostringstream oss;
+    oss << "FP Registers:\n";
+    for (int i = 0; i < 32; i += 4) {
+        oss << "$f" << std::setw(2) << std::setfill('0') << std::dec << i
+            << "-$f" << std::setw(2) << (i + 3) << ": ";
+        for (int j = 0; j < 4; j++) {
+            oss << "0x" << std::hex << std::setw(8) << std::setfill('0') << registers[i + j] << " ";
+        }
+        oss << "\n";
+    }
+    oss << "FCSR: 0x" << std::hex << std::setw(8) << std::setfill('0') << fcsr
+        << " (condition " << (getCondition() ? 1 : 0) << ")\n";
+    return oss.str();
+}
@@ -0,0 +1,98 @@
+#include "hazard_scoreboard.hpp"
+#include "fpu.hpp"
+#include <algorithm>
+
+HazardScoreboard::HazardScoreboard()
+    : multiply_latency(12), divide_latency(35), muldiv_pipelined(false), state() {
+    std::copy(&FPU::DEFAULT_LATENCY[0][0], &FPU::DEFAULT_LATENCY[0][0] + MIPS::FPLAT_COUNT * 2, &fp_latency[0][0]);
+}
+
+void HazardScoreboard::reset() {
+    state = {};
+}
+
+const HazardScoreboard::State& HazardScoreboard::getState() const {
+    return state;
+}
+
+void HazardScoreboard::setState(const State& state) {
+    this->state = state;
+}
+
+void HazardScoreboard::setMulDivLatency(int multiply_cycles, int divide_cycles) {
+    multiply_latency = multiply_cycles > 0 ? multiply_cycles : 1;
+    divide_latency = divide_cycles > 0 ? divide_cycles : 1;
+}
+
+void HazardScoreboard::setMulDivPipelined(bool pipelined) {
+    muldiv_pipelined = pipelined;
+}
+
+bool HazardScoreboard::setFPLatency(const std::string& name, int cycles) {
+    int latency_class, first, last;
+    if (!FPU::parseLatencyName(name, latency_class, first, last)) {
+        return false;
+    }
+    for (int precision = first; precision <= last; precision++) {
+        fp_latency[latency_class][precision] = cycles > 0 ? cycles : 1;
+    }
+    return true;
+}
+
+int HazardScoreboard::getMultiplyLatency() const {
+    return multiply_latency;
+}
+
+int HazardScoreboard::getDivideLatency() const {
+    return divide_latency;
+}
+
+bool HazardScoreboard::isMulDivPipelined() const {
+    return muldiv_pipelined;
+}
+
+void HazardScoreboard::issue(uint32_t instruction, const MIPS::InstructionInfo& info, uint64_t cycle) {
+    int latency = 0;
+    switch (info.operation) {
+        case MIPS::OP_MULT:
+        case MIPS::OP_MULTU:
+            latency = multiply_latency;
+            break;
+        case MIPS::OP_DIV:
+        case MIPS::OP_DIVU:
+            latency = divide_latency;
+            break;
+        default:
+            break;
+    }
+    if (latency > 0) {
+        state.hilo_ready = cycle + latency;
+        state.muldiv_free = cycle + (muldiv_pipelined ? 1 : latency);
+        return;
+    }
+
+    const MIPS::FPSignals& fp = info.fp;
+    if (fp.latency == MIPS::FPLAT_NONE) {
+        return;
+    }
+    uint64_t ready = cycle + fp_latency[fp.latency][fp.source_double || fp.result_double];
+    uint8_t reg = 0;
+    switch (fp.destination) {
+        case MIPS::FDEST_FD: reg = (instruction >> 6) & 0x1F; break;
+        case MIPS::FDEST_FS: reg = (instruction >> 11) & 0x1F; break;
+        case MIPS::FDEST_FT: reg = (instruction >> 16) & 0x1F; break;
+        case MIPS::FDEST_CONDITION: state.condition_ready = ready; break;
+        case MIPS::FDEST_NONE: break;
+    }
+    if (fp.destination == MIPS::FDEST_FD || fp.destination == MIPS::FDEST_FS ||
+        fp.destination == MIPS::FDEST_FT) {
+        if (fp.result_double) {
+            reg &= ~1;
+            state.fpr_ready[reg + 1] = ready;
+        }
+        state.fpr_ready[reg] = ready;
+    }
+    if (fp.latency == MIPS::FPLAT_DIV || fp.latency == MIPS::FPLAT_SQRT) {
+        state.fp_divider_free = ready;
+    }
+}
@@ -0,0 +1,131 @@
+#include "host_profiler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+thread_local ScopedPhaseTimer* ScopedPhaseTimer::active = nullptr;
+
+static const char* const PHASE_NAMES[HostProfiler::PHASE_COUNT] = {
+    "fetch", "decode", "execute", "memory", "predictor", "pipeline", "format"};
+
+static int64_t steadyNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+HostProfiler& HostProfiler::instance() {
+    static HostProfiler profiler;
+    return profiler;
+}
+
+HostProfiler::HostProfiler() : phase_ticks(), phase_calls() {
+    std::fill(counter_fds, counter_fds + HARDWARE_COUNTERS, -1);
+    timer_cost = ~0ull;
+    for (int i = 0; i < 1000; i++) {
+        uint64_t first = now();
+        timer_cost = std::min(timer_cost, now() - first);
+    }
+    start_ticks = now();
+    start_nanoseconds = steadyNanoseconds();
+}
+
+HostProfiler::~HostProfiler() {
+#ifdef __linux__
+    for (int fd : counter_fds) {
+        if (fd >= 0) close(fd);
+    }
+#endif
+}
+
+// One group led by the cycle counter, so all four count over the same time
+bool HostProfiler::enableHardwareCounters() {
+#ifdef __linux__
+    if (counter_fds[0] >= 0) {
+        return true;
+    }
+    const uint64_t configs[HARDWARE_COUNTERS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                 PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+    for (int i = 0; i < HARDWARE_COUNTERS; i++) {
+        perf_event_attr attr = {};
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = configs[i];
+        attr.disabled = i == 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        counter_fds[i] = syscall(__NR_perf_event_open, &attr, 0, -1, i == 0 ? -1 : counter_fds[0], 0);
+        if (counter_fds[i] < 0) {
+            for (int j = 0; j < i; j++) {
+                close(counter_fds[j]);
+                counter_fds[j] = -1;
+            }
+            return false;
+        }
+    }
+    ioctl(counter_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::string HostProfiler::getReportString() const {
+    uint64_t total = now() - start_ticks;
+    double elapsed_ms = (steadyNanoseconds() - start_nanoseconds) / 1e6;
+    double ms_per_tick = total > 0 ? elapsed_ms / total : 0.0;
+
+    uint64_t timed = 0, scopes = 0;
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        timed += phase_ticks[i];
+        scopes += phase_calls[i];
+    }
+    int order[PHASE_COUNT];
+    for (int i = 0; i < PHASE_COUNT; i++) order[i] = i;
+    std::sort(order, order + PHASE_COUNT, [this](int a, int b) { return phase_ticks[a] > phase_ticks[b]; });
+
+    std::ostringstream oss;
+    oss << std::fixed;
+    oss << "Host Self-Profile: " << std::setprecision(1) << elapsed_ms << " ms\n";
+    oss << std::left << std::setw(12) << "Phase" << std::right << std::setw(12) << "Time (ms)"
+        << std::setw(9) << "Share" << std::setw(14) << "Calls" << std::setw(13) << "Ticks/Call" << "\n";
+    auto row = [&](const char* name, uint64_t ticks, uint64_t calls) {
+        oss << std::left << std::setw(12) << name << std::right << std::setw(12) << std::setprecision(2)
+            << ticks * ms_per_tick << std::setw(8) << std::setprecision(1)
+            << (total > 0 ? 100.0 * ticks / total : 0.0) << "%" << std::setw(14) << calls;
+        if (calls > 0) {
+            oss << std::setw(13) << ticks / calls;
+        }
+        oss << "\n";
+    };
+    for (int i : order) {
+        if (phase_calls[i] > 0) row(PHASE_NAMES[i], phase_ticks[i], phase_calls[i]);
+    }
+    row("(other)", total > timed ? total - timed : 0, 0);
+    oss << "Timer overhead: about " << std::setprecision(2) << scopes * timer_cost * 2 * ms_per_tick
+        << " ms (" << scopes << " scopes, " << timer_cost << " ticks per clock read)\n";
+
+#ifdef __linux__
+    if (counter_fds[0] >= 0) {
+        struct {
+            uint64_t count;
+            uint64_t values[HARDWARE_COUNTERS];
+        } group = {};
+        if (read(counter_fds[0], &group, sizeof(group)) > 0 && group.count == HARDWARE_COUNTERS) {
+            oss << "Host Counters: " << group.values[0] << " cycles, " << group.values[1] << " instructions";
+            if (group.values[0] > 0) {
+                oss << " (IPC " << std::setprecision(2) << (double)group.values[1] / group.values[0] << ")";
+            }
+            oss << ", " << group.values[2] << " cache misses, " << group.values[3] << " branch misses\n";
+        }
+    }
+#endif
+    return oss.str();
+}
@@ -1,86 +1,345 @@
 #include "instruction_decoder.hpp"
-#include <sstream>
-#include <iomanip>
+#include <thread>
+#include <vector>
+#include <cstring>
+#include <algorithm>
 
-std::string InstructionDecoder::getInstructionName(uint32_t instruction) {
-    uint8_t opcode = (instruction >> 26) & 0x3F;
-    uint8_t funct = instruction & 0x3F;
+namespace {
+    constexpr const char* REGISTER_NAMES[32] = {
+        "$zero", "$at", "$v0", "$v1", "$a0", "$a1", "$a2", "$a3",
+        "$t0", "$t1", "$t2", "$t3", "$t4", "$t5", "$t6", "$t7",
+        "$s0", "$s1", "$s2", "$s3", "$s4", "$s5", "$s6", "$s7",
+        "$t8", "$t9", "$k0", "$k1", "$gp", "$sp", "$fp", "$ra"
+    };
     
-    if (opcode == 0) {
-        switch (funct) {
-            case MIPS::FUNCT_ADD: return "add";
-            case MIPS::FUNCT_SUB: return "sub";
-            case MIPS::FUNCT_AND: return "and";
-            case MIPS::FUNCT_OR: return "or";
-            case MIPS::FUNCT_SLT: return "slt";
-            case MIPS::FUNCT_JR: return "jr";
-            default: return "unknown";
+    constexpr const char* FP_REGISTER_NAMES[32] = {
+        "$f0", "$f1", "$f2", "$f3", "$f4", "$f5", "$f6", "$f7",
+        "$f8", "$f9", "$f10", "$f11", "$f12", "$f13", "$f14", "$f15",
+        "$f16", "$f17", "$f18", "$f19", "$f20", "$f21", "$f22", "$f23",
+        "$f24", "$f25", "$f26", "$f27", "$f28", "$f29", "$f30", "$f31"
+    };
+
+    // Bounded append-only writer over a caller-provided buffer
+    class TextWriter {
+    public:
+        TextWriter(char* buffer, size_t size)
+            : begin(buffer), cursor(buffer), end(size > 0 ? buffer + size - 1 : buffer) {}
+
+        void put(char c) {
+            if (cursor < end) *cursor++ = c;
         }
-    } else {
-        switch (opcode) {
-            case MIPS::OPCODE_ADDI: return "addi";
-            case MIPS::OPCODE_LW: return "lw";
-            case MIPS::OPCODE_SW: return "sw";
-            case MIPS::OPCODE_BEQ: return "beq";
-            case MIPS::OPCODE_BNE: return "bne";
-            case MIPS::OPCODE_J: return "j";
-            case MIPS::OPCODE_JAL: return "jal";
-            default: return "unknown";
+
+        void put(const char* text) {
+            while (*text != '\0' && cursor < end) *cursor++ = *text++;
         }
+
+        void putDecimal(int32_t value) {
+            uint32_t magnitude = (uint32_t)value;
+            if (value < 0) {
+                put('-');
+                magnitude = 0u - magnitude;
+            }
+            char digits[10];
+            int count = 0;
+            do {
+                digits[count++] = (char)('0' + magnitude % 10);
+                magnitude /= 10;
+            } while (magnitude != 0);
+            while (count > 0) put(digits[--count]);
+        }
+
+        void putHex(uint32_t value) {
+            static const char HEX_DIGITS[] = "0123456789abcdef";
+            put("0x");
+            int shift = 28;
+            while (shift > 0 && ((value >> shift) & 0xF) == 0) shift -= 4;
+            for (; shift >= 0; shift -= 4) put(HEX_DIGITS[(value >> shift) & 0xF]);
+        }
+
+        void putHex8(uint32_t value) {
+            static const char HEX_DIGITS[] = "0123456789abcdef";
+            put("0x");
+            for (int shift = 28; shift >= 0; shift -= 4) put(HEX_DIGITS[(value >> shift) & 0xF]);
+        }
+
+        size_t finish(size_t size) {
+            if (size > 0) *cursor = '\0';
+            return cursor - begin;
+        }
+
+    private:
+        char* begin;
+        char* cursor;
+        char* end;
+    };
+
+    // "0x00000000: 0x00000000  " + instruction text + '\n'
+    const size_t LINE_PREFIX_LENGTH = 24;
+    const size_t MAX_LINE_LENGTH = LINE_PREFIX_LENGTH + InstructionDecoder::MAX_DISASSEMBLY_LENGTH;
+
+    // Words per thread below which splitting is not worth a thread start
+    const size_t MIN_WORDS_PER_THREAD = 16384;
+
+    size_t disassembleWords(const uint8_t* image, size_t first, size_t last,
+                            uint32_t base_address, char* buffer) {
+        char* cursor = buffer;
+        for (size_t i = first; i < last; i++) {
+            const uint8_t* bytes = image + i * 4;
+            uint32_t word = ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) |
+                            ((uint32_t)bytes[2] << 8) | bytes[3];
+
+            TextWriter prefix(cursor, LINE_PREFIX_LENGTH + 1);
+            prefix.putHex8(base_address + (uint32_t)(i * 4));
+            prefix.put(": ");
+            prefix.putHex8(word);
+            prefix.put("  ");
+            cursor += prefix.finish(LINE_PREFIX_LENGTH + 1);
+
+            cursor += InstructionDecoder::disassemble(word, cursor, InstructionDecoder::MAX_DISASSEMBLY_LENGTH);
+            *cursor++ = '\n';
+        }
+        return cursor - buffer;
+    }
+}
+
+const char* InstructionDecoder::mnemonic(uint32_t instruction) {
+    return info(instruction).mnemonic;
+}
+
+const char* InstructionDecoder::registerName(int reg) {
+    if (reg >= 0 && reg < 32) {
+        return REGISTER_NAMES[reg];
+    }
+    return "$unknown";
+}
+
+const char* InstructionDecoder::fpRegisterName(int reg) {
+    if (reg >= 0 && reg < 32) {
+        return FP_REGISTER_NAMES[reg];
     }
+    return "$unknown";
+}
+
+std::string InstructionDecoder::getInstructionName(uint32_t instruction) {
+    return mnemonic(instruction);
 }
 
 std::string InstructionDecoder::disassemble(uint32_t instruction) {
-    uint8_t opcode = (instruction >> 26) & 0x3F;
+    char buffer[MAX_DISASSEMBLY_LENGTH];
+    size_t length = disassemble(instruction, buffer);
+    return std::string(buffer, length);
+}
+
+size_t InstructionDecoder::disassemble(uint32_t instruction, char* buffer, size_t size) {
     uint8_t rs = (instruction >> 21) & 0x1F;
     uint8_t rt = (instruction >> 16) & 0x1F;
     uint8_t rd = (instruction >> 11) & 0x1F;
-    uint16_t immediate = instruction & 0xFFFF;
+    uint8_t fd = (instruction >> 6) & 0x1F; // FP fields: ft = rt, fs = rd
+    int16_t immediate = (int16_t)(instruction & 0xFFFF);
     uint32_t jump_addr = instruction & 0x3FFFFFF;
-    uint8_t funct = instruction & 0x3F;
-    
-    std::ostringstream oss;
-    std::string name = getInstructionName(instruction);
-    
-    if (opcode == 0) { // R-type
-        if (funct == MIPS::FUNCT_JR) {
-            oss << name << " " << getRegisterName(rs);
-        } else {
-            oss << name << " " << getRegisterName(rd) << ", " 
-                << getRegisterName(rs) << ", " << getRegisterName(rt);
-        }
-    } else if (opcode == MIPS::OPCODE_J || opcode == MIPS::OPCODE_JAL) { // J-type
-        oss << name << " 0x" << std::hex << (jump_addr << 2);
-    } else { // I-type
-        if (opcode == MIPS::OPCODE_LW || opcode == MIPS::OPCODE_SW) {
-            oss << name << " " << getRegisterName(rt) << ", " 
-                << std::dec << (int16_t)immediate << "(" << getRegisterName(rs) << ")";
-        } else if (opcode == MIPS::OPCODE_BEQ || opcode == MIPS::OPCODE_BNE) {
-            oss << name << " " << getRegisterName(rs) << ", " << getRegisterName(rt) 
-                << ", " << std::dec << (int16_t)immediate;
-        } else {
-            oss << name << " " << getRegisterName(rt) << ", " << getRegisterName(rs) 
-                << ", " << std::dec << (int16_t)immediate;
-        }
+    const MIPS::InstructionInfo& decoded = info(instruction);
+
+    TextWriter out(buffer, size);
+    if (instruction == 0) {
+        out.put("nop");
+        return out.finish(size);
     }
-    
-    return oss.str();
+    out.put(decoded.mnemonic);
+    if (decoded.layout != MIPS::LAYOUT_NONE) {
+        out.put(' ');
+    }
+
+    switch (decoded.layout) {
+        case MIPS::LAYOUT_NONE:
+            break;
+        case MIPS::LAYOUT_RD_RS_RT:
+            out.put(REGISTER_NAMES[rd]);
+            out.put(", ");
+            out.put(REGISTER_NAMES[rs]);
+            out.put(", ");
+            out.put(REGISTER_NAMES[rt]);
+            break;
+        case MIPS::LAYOUT_RD_RT_SA:
+            out.put(REGISTER_NAMES[rd]);
+            out.put(", ");
+            out.put(REGISTER_NAMES[rt]);
+            out.put(", ");
+            out.putDecimal((instruction >> 6) & 0x1F);
+            break;
+        case MIPS::LAYOUT_RD_RT_RS:
+            out.put(REGISTER_NAMES[rd]);
+            out.put(", ");
+            out.put(REGISTER_NAMES[rt]);
+            out.put(", ");
+            out.put(REGISTER_NAMES[rs]);
+            break;
+        case MIPS::LAYOUT_RD_RS:
+            out.put(REGISTER_NAMES[rd]);
+            out.put(", ");
+            out.put(REGISTER_NAMES[rs]);
+            break;
+        case MIPS::LAYOUT_RS_RT:
+            out.put(REGISTER_NAMES[rs]);
+            out.put(", ");
+            out.put(REGISTER_NAMES[rt]);
+            break;
+        case MIPS::LAYOUT_RD:
+            out.put(REGISTER_NAMES[rd]);
+            break;
+        case MIPS::LAYOUT_RS:
+            out.put(REGISTER_NAMES[rs]);
+            break;
+        case MIPS::LAYOUT_RT_RS_HEX:
+            out.put(REGISTER_NAMES[rt]);
+            out.put(", ");
+            out.put(REGISTER_NAMES[rs]);
+            out.put(", ");
+            out.putHex(instruction & 0xFFFF);
+            break;
+        case MIPS::LAYOUT_RT_HEX:
+            out.put(REGISTER_NAMES[rt]);
+            out.put(", ");
+            out.putHex(instruction & 0xFFFF);
+            break;
+        case MIPS::LAYOUT_RS_OFFSET:
+            out.put(REGISTER_NAMES[rs]);
+            out.put(", ");
+            out.putDecimal(immediate);
+            break;
+        case MIPS::LAYOUT_RT_RS_IMM:
+            out.put(REGISTER_NAMES[rt]);
+            out.put(", ");
+            out.put(REGISTER_NAMES[rs]);
+            out.put(", ");
+            out.putDecimal(immediate);
+            break;
+        case MIPS::LAYOUT_RT_OFFSET_BASE:
+            out.put(REGISTER_NAMES[rt]);
+            out.put(", ");
+            out.putDecimal(immediate);
+            out.put('(');
+            out.put(REGISTER_NAMES[rs]);
+            out.put(')');
+            break;
+        case MIPS::LAYOUT_RS_RT_OFFSET:
+            out.put(REGISTER_NAMES[rs]);
+            out.put(", ");
+            out.put(REGISTER_NAMES[rt]);
+            out.put(", ");
+            out.putDecimal(immediate);
+            break;
+        case MIPS::LAYOUT_TARGET:
+            out.putHex(jump_addr << 2);
+            break;
+        case MIPS::LAYOUT_FD_FS_FT:
+            out.put(FP_REGISTER_NAMES[fd]);
+            out.put(", ");
+            out.put(FP_REGISTER_NAMES[rd]);
+            out.put(", ");
+            out.put(FP_REGISTER_NAMES[rt]);
+            break;
+        case MIPS::LAYOUT_FD_FS:
+            out.put(FP_REGISTER_NAMES[fd]);
+            out.put(", ");
+            out.put(FP_REGISTER_NAMES[rd]);
+            break;
+        case MIPS::LAYOUT_FS_FT:
+            out.put(FP_REGISTER_NAMES[rd]);
+            out.put(", ");
+            out.put(FP_REGISTER_NAMES[rt]);
+            break;
+        case MIPS::LAYOUT_RT_FS:
+            out.put(REGISTER_NAMES[rt]);
+            out.put(", ");
+            out.put(FP_REGISTER_NAMES[rd]);
+            break;
+        case MIPS::LAYOUT_RT_FCR:
+            out.put(REGISTER_NAMES[rt]);
+            out.put(", $");
+            out.putDecimal(rd);
+            break;
+        case MIPS::LAYOUT_FT_OFFSET_BASE:
+            out.put(FP_REGISTER_NAMES[rt]);
+            out.put(", ");
+            out.putDecimal(immediate);
+            out.put('(');
+            out.put(REGISTER_NAMES[rs]);
+            out.put(')');
+            break;
+        case MIPS::LAYOUT_OFFSET:
+            out.putDecimal(immediate);
+            break;
+    }
+
+    return out.finish(size);
 }
 
-std::string InstructionDecoder::getRegisterName(int reg) {
-    const std::string reg_names[] = {
-        "$zero", "$at", "$v0", "$v1", "$a0", "$a1", "$a2", "$a3",
-        "$t0", "$t1", "$t2", "$t3", "$t4", "$t5", "$t6", "$t7",
-        "$s0", "$s1", "$s2", "$s3", "$s4", "$s5", "$s6", "$s7",
-        "$t8", "$t9", "$k0", "$k1", "$gp", "$sp", "$fp", "$ra"
+size_t InstructionDecoder::imageTextCapacity(size_t size) {
+    return (size / 4) * MAX_LINE_LENGTH + 1;
+}
+
+size_t InstructionDecoder::disassembleImage(const uint8_t* image, size_t size, uint32_t base_address,
+                                            char* buffer, size_t buffer_size, unsigned threads) {
+    size_t words = size / 4;
+    if (buffer_size < imageTextCapacity(size)) {
+        return 0;
+    }
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    size_t chunks = std::min<size_t>(threads, std::max<size_t>(1, words / MIN_WORDS_PER_THREAD));
+    size_t words_per_chunk = (words + chunks - 1) / std::max<size_t>(chunks, 1);
+
+    // Each chunk writes into its worst-case slot of the shared buffer
+    std::vector<size_t> lengths(chunks, 0);
+    auto work = [&](size_t chunk) {
+        size_t first = std::min(words, chunk * words_per_chunk);
+        size_t last = std::min(words, first + words_per_chunk);
+        lengths[chunk] = disassembleWords(image, first, last, base_address,
+                                          buffer + first * MAX_LINE_LENGTH);
     };
-    
-    if (reg >= 0 && reg < 32) {
-        return reg_names[reg];
+
+    std::vector<std::thread> workers;
+    for (size_t chunk = 1; chunk < chunks; chunk++) {
+        workers.emplace_back(work, chunk);
     }
-    return "$unknown";
+    work(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    // Close the gaps between slots, keeping address order
+    size_t length = lengths.empty() ? 0 : lengths[0];
+    for (size_t chunk = 1; chunk < chunks; chunk++) {
+        size_t first = std::min(words, chunk * words_per_chunk);
+        std::memmove(buffer + length, buffer + first * MAX_LINE_LENGTH, lengths[chunk]);
+        length += lengths[chunk];
+    }
+    buffer[length] = '\0';
+    return length;
 }
 
-bool InstructionDecoder::isRType(uint8_t opcode) { return opcode == 0; }
-bool InstructionDecoder::isIType(uint8_t opcode) { return opcode != 0 && opcode != 2 && opcode != 3; }
-bool InstructionDecoder::isJType(uint8_t opcode) { return opcode == 2 || opcode == 3; }
+std::string InstructionDecoder::disassembleImage(const uint8_t* image, size_t size, uint32_t base_address,
+                                                 unsigned threads) {
+    std::string text(imageTextCapacity(size), '\0');
+    size_t length = disassembleImage(image, size, base_address, &text[0], text.size(), threads);
+    text.resize(length);
+    return text;
+}
+
+std::string InstructionDecoder::getRegisterName(int reg) {
+    return registerName(reg);
+}
+
+bool InstructionDecoder::isRType(uint8_t opcode) {
+    return MIPS::DECODE_TABLES.opcode[opcode & 0x3F].format == MIPS::FORMAT_R;
+}
+
+bool InstructionDecoder::isIType(uint8_t opcode) {
+    return MIPS::DECODE_TABLES.opcode[opcode & 0x3F].format == MIPS::FORMAT_I;
+}
+
+bool InstructionDecoder::isJType(uint8_t opcode) {
+    return MIPS::DECODE_TABLES.opcode[opcode & 0x3F].format == MIPS::FORMAT_J;
+}
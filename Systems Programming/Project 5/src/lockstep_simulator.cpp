@@ -0,0 +1,610 @@
+#include "lockstep_simulator.hpp"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+#if defined(MIPS_LOCKSTEP_AVX2)
+#include <immintrin.h>
+#endif
+
+namespace {
+    // One register across the VECTOR_LANES lanes of a group. Conditions are
+    // all-ones/all-zeros per lane; bitsOf() collects each lane's sign bit.
+#if defined(MIPS_LOCKSTEP_AVX2)
+    typedef __m256i Vec;
+
+    inline Vec load(const uint32_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+    inline void store(uint32_t* p, Vec v) { _mm256_storeu_si256((__m256i*)p, v); }
+    inline Vec splat(uint32_t x) { return _mm256_set1_epi32((int)x); }
+    inline Vec add(Vec a, Vec b) { return _mm256_add_epi32(a, b); }
+    inline Vec sub(Vec a, Vec b) { return _mm256_sub_epi32(a, b); }
+    inline Vec bitAnd(Vec a, Vec b) { return _mm256_and_si256(a, b); }
+    inline Vec bitOr(Vec a, Vec b) { return _mm256_or_si256(a, b); }
+    inline Vec bitXor(Vec a, Vec b) { return _mm256_xor_si256(a, b); }
+    inline Vec shiftLeft(Vec a, Vec count) { return _mm256_sllv_epi32(a, count); }
+    inline Vec shiftRight(Vec a, Vec count) { return _mm256_srlv_epi32(a, count); }
+    inline Vec shiftRightArith(Vec a, Vec count) { return _mm256_srav_epi32(a, count); }
+    inline Vec equal(Vec a, Vec b) { return _mm256_cmpeq_epi32(a, b); }
+    inline Vec lessSigned(Vec a, Vec b) { return _mm256_cmpgt_epi32(b, a); }
+    inline Vec select(Vec condition, Vec if_true, Vec if_false) {
+        return _mm256_blendv_epi8(if_false, if_true, condition);
+    }
+    inline uint32_t bitsOf(Vec v) { return (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(v)); }
+    inline Vec laneMask(uint32_t bits) {
+        const Vec lane_bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+        return equal(bitAnd(splat(bits), lane_bits), lane_bits);
+    }
+#else
+    struct Vec {
+        uint32_t lane[LockstepSimulator::VECTOR_LANES];
+    };
+
+    template <typename Op>
+    inline Vec map(Vec a, Vec b, Op op) {
+        Vec r;
+        for (int i = 0; i < LockstepSimulator::VECTOR_LANES; i++) r.lane[i] = op(a.lane[i], b.lane[i]);
+        return r;
+    }
+
+    inline Vec load(const uint32_t* p) {
+        Vec r;
+        std::copy(p, p + LockstepSimulator::VECTOR_LANES, r.lane);
+        return r;
+    }
+    inline void store(uint32_t* p, Vec v) { std::copy(v.lane, v.lane + LockstepSimulator::VECTOR_LANES, p); }
+    inline Vec splat(uint32_t x) {
+        Vec r;
+        std::fill(r.lane, r.lane + LockstepSimulator::VECTOR_LANES, x);
+        return r;
+    }
+    inline Vec add(Vec a, Vec b) { return map(a, b, [](uint32_t x, uint32_t y) { return x + y; }); }
+    inline Vec sub(Vec a, Vec b) { return map(a, b, [](uint32_t x, uint32_t y) { return x - y; }); }
+    inline Vec bitAnd(Vec a, Vec b) { return map(a, b, [](uint32_t x, uint32_t y) { return x & y; }); }
+    inline Vec bitOr(Vec a, Vec b) { return map(a, b, [](uint32_t x, uint32_t y) { return x | y; }); }
+    inline Vec bitXor(Vec a, Vec b) { return map(a, b, [](uint32_t x, uint32_t y) { return x ^ y; }); }
+    inline Vec shiftLeft(Vec a, Vec count) {
+        return map(a, count, [](uint32_t x, uint32_t n) { return x << n; });
+    }
+    inline Vec shiftRight(Vec a, Vec count) {
+        return map(a, count, [](uint32_t x, uint32_t n) { return x >> n; });
+    }
+    inline Vec shiftRightArith(Vec a, Vec count) {
+        return map(a, count, [](uint32_t x, uint32_t n) { return (uint32_t)((int32_t)x >> n); });
+    }
+    inline Vec equal(Vec a, Vec b) {
+        return map(a, b, [](uint32_t x, uint32_t y) { return x == y ? 0xFFFFFFFFu : 0u; });
+    }
+    inline Vec lessSigned(Vec a, Vec b) {
+        return map(a, b, [](uint32_t x, uint32_t y) { return (int32_t)x < (int32_t)y ? 0xFFFFFFFFu : 0u; });
+    }
+    inline Vec select(Vec condition, Vec if_true, Vec if_false) {
+        Vec r;
+        for (int i = 0; i < LockstepSimulator::VECTOR_LANES; i++) {
+            r.lane[i] = (condition.lane[i] & if_true.lane[i]) | (~condition.lane[i] & if_false.lane[i]);
+        }
+        return r;
+    }
+    inline uint32_t bitsOf(Vec v) {
+        uint32_t bits = 0;
+        for (int i = 0; i < LockstepSimulator::VECTOR_LANES; i++) bits |= (v.lane[i] >> 31) << i;
+        return bits;
+    }
+    inline Vec laneMask(uint32_t bits) {
+        Vec r;
+        for (int i = 0; i < LockstepSimulator::VECTOR_LANES; i++) r.lane[i] = ((bits >> i) & 1) ? 0xFFFFFFFFu : 0u;
+        return r;
+    }
+#endif
+
+    const uint32_t SIGN_BIT = 0x80000000u;
+
+    inline Vec bitNor(Vec a, Vec b) { return bitXor(bitOr(a, b), splat(0xFFFFFFFFu)); }
+    inline Vec lessUnsigned(Vec a, Vec b) {
+        return lessSigned(bitXor(a, splat(SIGN_BIT)), bitXor(b, splat(SIGN_BIT)));
+    }
+    inline Vec toFlag(Vec condition) { return bitAnd(condition, splat(1)); }
+
+    // Masked write of a result into one register row; $zero stays zero
+    inline void writeBack(uint32_t* row, int reg, Vec value, Vec mask) {
+        if (reg != 0) store(row, select(mask, value, load(row)));
+    }
+
+    // Call fn(lane_offset) for each set bit of mask
+    template <typename Fn>
+    inline void forEachLane(uint32_t mask, Fn fn) {
+        for (; mask != 0; mask &= mask - 1) fn(__builtin_ctz(mask));
+    }
+}
+
+LockstepSimulator::LockstepSimulator(int lanes, uint32_t memory_size)
+    : lane_count(std::max(lanes, 1)),
+      padded_lanes((std::max(lanes, 1) + VECTOR_LANES - 1) / VECTOR_LANES * VECTOR_LANES),
+      memory_size(std::max<uint32_t>(memory_size & ~3u, 4)),
+      registers((size_t)32 * padded_lanes, 0),
+      hi(padded_lanes, 0),
+      lo(padded_lanes, 0),
+      pcs(padded_lanes, 0),
+      halted(padded_lanes, 0),
+      memory((size_t)padded_lanes * this->memory_size, 0),
+      image(this->memory_size, 0),
+      decoded(this->memory_size / 4) {
+    storeImage("");
+}
+
+LockstepSimulator::~LockstepSimulator() {}
+
+bool LockstepSimulator::loadProgram(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return loadProgramFromString(buffer.str());
+}
+
+bool LockstepSimulator::loadProgramFromString(const std::string& program) {
+    return storeImage(program);
+}
+
+bool LockstepSimulator::storeImage(const std::string& program) {
+    std::istringstream iss(program);
+    std::string line;
+    uint32_t address = 0;
+    std::fill(image.begin(), image.end(), 0);
+
+    while (std::getline(iss, line)) {
+        if (line.empty() || line[0] == '#') continue;
+
+        try {
+            uint32_t instruction = std::stoul(line, nullptr, 16);
+
+            if (address + 3 < image.size()) {
+                image[address] = (instruction >> 24) & 0xFF;
+                image[address + 1] = (instruction >> 16) & 0xFF;
+                image[address + 2] = (instruction >> 8) & 0xFF;
+                image[address + 3] = instruction & 0xFF;
+                address += 4;
+            }
+        } catch (const std::exception& e) {
+            return false;
+        }
+    }
+
+    predecodeImage();
+    return true;
+}
+
+bool LockstepSimulator::loadProgramImage(const std::vector<uint8_t>& program) {
+    if (program.size() > image.size()) {
+        return false;
+    }
+    std::copy(program.begin(), program.end(), image.begin());
+    std::fill(image.begin() + program.size(), image.end(), 0);
+    predecodeImage();
+    return true;
+}
+
+// Predecode every word of the shared image once, then restart the lanes
+void LockstepSimulator::predecodeImage() {
+    for (size_t i = 0; i < decoded.size(); i++) {
+        const uint8_t* bytes = &image[i * 4];
+        uint32_t word = ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) |
+                        ((uint32_t)bytes[2] << 8) | bytes[3];
+        uint16_t immediate = word & 0xFFFF;
+        decoded[i] = {&InstructionDecoder::info(word),
+                      (uint8_t)((word >> 21) & 0x1F), (uint8_t)((word >> 16) & 0x1F),
+                      (uint8_t)((word >> 11) & 0x1F), (uint8_t)((word >> 6) & 0x1F),
+                      (uint32_t)(int32_t)(int16_t)immediate, immediate, word & 0x3FFFFFF};
+    }
+
+    reset();
+}
+
+void LockstepSimulator::reset() {
+    std::fill(registers.begin(), registers.end(), 0);
+    std::fill(hi.begin(), hi.end(), 0);
+    std::fill(lo.begin(), lo.end(), 0);
+    std::fill(pcs.begin(), pcs.end(), 0);
+    for (int lane = 0; lane < padded_lanes; lane++) {
+        // Padding lanes of the last group never run
+        halted[lane] = lane < lane_count ? 0 : 1;
+        std::copy(image.begin(), image.end(), laneMemory(lane));
+    }
+    stats = {0, 0, 0, 0};
+}
+
+uint64_t LockstepSimulator::run(uint64_t max_steps) {
+    uint64_t retired = 0;
+    for (int group = 0; group < padded_lanes / VECTOR_LANES; group++) {
+        retired += runGroup(group, max_steps);
+    }
+    return retired;
+}
+
+uint64_t LockstepSimulator::runGroup(int group, uint64_t max_steps) {
+    const int base = group * VECTOR_LANES;
+    uint32_t active = 0;
+    for (int i = 0; i < VECTOR_LANES; i++) {
+        if (!halted[base + i]) active |= 1u << i;
+    }
+
+    uint64_t steps = 0;
+    uint64_t retired = 0;
+    bool reselect = true;
+    uint32_t group_pc = 0;
+
+    while (active != 0 && steps < max_steps) {
+        // Issue at the lowest PC so diverged lanes meet again at joins
+        if (reselect) {
+            group_pc = UINT32_MAX;
+            forEachLane(active, [&](int i) { group_pc = std::min(group_pc, pcs[base + i]); });
+        }
+        Vec pc_vec = load(&pcs[base]);
+        uint32_t mask = bitsOf(equal(pc_vec, splat(group_pc))) & active;
+
+        // Lanes that ran off memory or jumped to an unaligned PC halt
+        if (group_pc >= memory_size - 3 || (group_pc & 3) != 0) {
+            forEachLane(mask, [&](int i) { halted[base + i] = 1; });
+            active &= ~mask;
+            stats.lanes_halted += __builtin_popcount(mask);
+            reselect = true;
+            continue;
+        }
+
+        const DecodedInstruction* d = &decoded[group_pc >> 2];
+
+        steps++;
+        stats.group_steps++;
+        if (mask != active) stats.divergent_steps++;
+
+        Vec m = laneMask(mask);
+        Vec rs = load(reg(d->rs, base));
+        Vec rt = load(reg(d->rt, base));
+        Vec imm = splat(d->imm_extended);
+        Vec next_pc = splat(group_pc + 4);
+        uint32_t stopping = 0; // Lanes that halt on this instruction
+        bool control = false;
+
+        switch (d->info->operation) {
+            // Arithmetic; trapping forms halt the overflowing lanes
+            case MIPS::OP_ADD:
+            case MIPS::OP_ADDI: {
+                Vec b = d->info->operation == MIPS::OP_ADD ? rt : imm;
+                Vec r = add(rs, b);
+                stopping = bitsOf(bitAnd(bitXor(rs, r), bitXor(b, r))) & mask;
+                int dest = d->info->operation == MIPS::OP_ADD ? d->rd : d->rt;
+                writeBack(reg(dest, base), dest, r, laneMask(mask & ~stopping));
+                break;
+            }
+            case MIPS::OP_SUB: {
+                Vec r = sub(rs, rt);
+                stopping = bitsOf(bitAnd(bitXor(rs, rt), bitXor(rs, r))) & mask;
+                writeBack(reg(d->rd, base), d->rd, r, laneMask(mask & ~stopping));
+                break;
+            }
+            case MIPS::OP_ADDU: writeBack(reg(d->rd, base), d->rd, add(rs, rt), m); break;
+            case MIPS::OP_SUBU: writeBack(reg(d->rd, base), d->rd, sub(rs, rt), m); break;
+            case MIPS::OP_ADDIU: writeBack(reg(d->rt, base), d->rt, add(rs, imm), m); break;
+
+            // Logic and comparison
+            case MIPS::OP_AND: writeBack(reg(d->rd, base), d->rd, bitAnd(rs, rt), m); break;
+            case MIPS::OP_OR: writeBack(reg(d->rd, base), d->rd, bitOr(rs, rt), m); break;
+            case MIPS::OP_XOR: writeBack(reg(d->rd, base), d->rd, bitXor(rs, rt), m); break;
+            case MIPS::OP_NOR: writeBack(reg(d->rd, base), d->rd, bitNor(rs, rt), m); break;
+            case MIPS::OP_SLT: writeBack(reg(d->rd, base), d->rd, toFlag(lessSigned(rs, rt)), m); break;
+            case MIPS::OP_SLTU: writeBack(reg(d->rd, base), d->rd, toFlag(lessUnsigned(rs, rt)), m); break;
+            case MIPS::OP_SLTI: writeBack(reg(d->rt, base), d->rt, toFlag(lessSigned(rs, imm)), m); break;
+            case MIPS::OP_SLTIU: writeBack(reg(d->rt, base), d->rt, toFlag(lessUnsigned(rs, imm)), m); break;
+            case MIPS::OP_ANDI: writeBack(reg(d->rt, base), d->rt, bitAnd(rs, splat(d->immediate)), m); break;
+            case MIPS::OP_ORI: writeBack(reg(d->rt, base), d->rt, bitOr(rs, splat(d->immediate)), m); break;
+            case MIPS::OP_XORI: writeBack(reg(d->rt, base), d->rt, bitXor(rs, splat(d->immediate)), m); break;
+            case MIPS::OP_LUI: writeBack(reg(d->rt, base), d->rt, splat((uint32_t)d->immediate << 16), m); break;
+
+            // Shifts
+            case MIPS::OP_SLL: writeBack(reg(d->rd, base), d->rd, shiftLeft(rt, splat(d->shamt)), m); break;
+            case MIPS::OP_SRL: writeBack(reg(d->rd, base), d->rd, shiftRight(rt, splat(d->shamt)), m); break;
+            case MIPS::OP_SRA: writeBack(reg(d->rd, base), d->rd, shiftRightArith(rt, splat(d->shamt)), m); break;
+            case MIPS::OP_SLLV:
+                writeBack(reg(d->rd, base), d->rd, shiftLeft(rt, bitAnd(rs, splat(0x1F))), m);
+                break;
+            case MIPS::OP_SRLV:
+                writeBack(reg(d->rd, base), d->rd, shiftRight(rt, bitAnd(rs, splat(0x1F))), m);
+                break;
+            case MIPS::OP_SRAV:
+                writeBack(reg(d->rd, base), d->rd, shiftRightArith(rt, bitAnd(rs, splat(0x1F))), m);
+                break;
+
+            // HI/LO moves are vector blends; multiply and divide run per lane
+            case MIPS::OP_MFHI: writeBack(reg(d->rd, base), d->rd, load(&hi[base]), m); break;
+            case MIPS::OP_MFLO: writeBack(reg(d->rd, base), d->rd, load(&lo[base]), m); break;
+            case MIPS::OP_MTHI: store(&hi[base], select(m, rs, load(&hi[base]))); break;
+            case MIPS::OP_MTLO: store(&lo[base], select(m, rs, load(&lo[base]))); break;
+            case MIPS::OP_MULT:
+            case MIPS::OP_MULTU:
+            case MIPS::OP_DIV:
+            case MIPS::OP_DIVU: {
+                MIPS::Operation op = d->info->operation;
+                forEachLane(mask, [&](int i) {
+                    int lane = base + i;
+                    uint32_t a = reg(d->rs, base)[i];
+                    uint32_t b = reg(d->rt, base)[i];
+                    if (op == MIPS::OP_MULT || op == MIPS::OP_MULTU) {
+                        uint64_t product = op == MIPS::OP_MULT ? (uint64_t)((int64_t)(int32_t)a * (int32_t)b)
+                                                               : (uint64_t)a * b;
+                        hi[lane] = (uint32_t)(product >> 32);
+                        lo[lane] = (uint32_t)product;
+                    } else if (b != 0) {
+                        if (op == MIPS::OP_DIVU) {
+                            lo[lane] = a / b;
+                            hi[lane] = a % b;
+                        } else if (a == 0x80000000u && b == 0xFFFFFFFFu) {
+                            lo[lane] = a;
+                            hi[lane] = 0;
+                        } else {
+                            lo[lane] = (uint32_t)((int32_t)a / (int32_t)b);
+                            hi[lane] = (uint32_t)((int32_t)a % (int32_t)b);
+                        }
+                    }
+                });
+                break;
+            }
+
+            // Memory is private to each lane; a lane whose access is outside
+            // memory or unaligned stops with an address error
+            case MIPS::OP_LB:
+            case MIPS::OP_LBU:
+            case MIPS::OP_LH:
+            case MIPS::OP_LHU:
+            case MIPS::OP_LW:
+            case MIPS::OP_LWL:
+            case MIPS::OP_LWR: {
+                MIPS::Operation op = d->info->operation;
+                uint32_t* dest = reg(d->rt, base);
+                forEachLane(mask, [&](int i) {
+                    uint32_t address = reg(d->rs, base)[i] + d->imm_extended;
+                    uint32_t value = 0;
+                    uint32_t size = op == MIPS::OP_LB || op == MIPS::OP_LBU ? 1
+                                  : op == MIPS::OP_LH || op == MIPS::OP_LHU ? 2 : 4;
+                    bool partial = op == MIPS::OP_LWL || op == MIPS::OP_LWR;
+                    if (!loadLane(base + i, partial ? address & ~3u : address, size, value)) {
+                        stopping |= 1u << i;
+                        return;
+                    }
+                    uint32_t shift;
+                    switch (op) {
+                        case MIPS::OP_LB:
+                            dest[i] = (uint32_t)(int32_t)(int8_t)value;
+                            break;
+                        case MIPS::OP_LH:
+                            dest[i] = (uint32_t)(int32_t)(int16_t)value;
+                            break;
+                        case MIPS::OP_LBU:
+                        case MIPS::OP_LHU:
+                        case MIPS::OP_LW:
+                            dest[i] = value;
+                            break;
+                        case MIPS::OP_LWL:
+                            shift = (address & 3) * 8;
+                            dest[i] = (value << shift) | (dest[i] & (shift == 0 ? 0 : (1u << shift) - 1));
+                            break;
+                        default: // LWR
+                            shift = (3 - (address & 3)) * 8;
+                            dest[i] = (value >> shift) | (dest[i] & (shift == 0 ? 0 : ~(0xFFFFFFFFu >> shift)));
+                            break;
+                    }
+                });
+                if (d->rt == 0) std::fill(dest, dest + VECTOR_LANES, 0);
+                break;
+            }
+            case MIPS::OP_SB:
+            case MIPS::OP_SH:
+            case MIPS::OP_SW:
+            case MIPS::OP_SWL:
+            case MIPS::OP_SWR: {
+                MIPS::Operation op = d->info->operation;
+                forEachLane(mask, [&](int i) {
+                    uint32_t address = reg(d->rs, base)[i] + d->imm_extended;
+                    uint32_t value = reg(d->rt, base)[i];
+                    bool stored = true;
+                    if (op == MIPS::OP_SB) {
+                        stored = storeLane(base + i, address, 1, value);
+                    } else if (op == MIPS::OP_SH) {
+                        stored = storeLane(base + i, address, 2, value);
+                    } else if (op == MIPS::OP_SW) {
+                        stored = storeLane(base + i, address, 4, value);
+                    } else if (op == MIPS::OP_SWL) {
+                        for (uint32_t b = 0; stored && b <= 3 - (address & 3); b++) {
+                            stored = storeLane(base + i, address + b, 1, value >> (24 - 8 * b));
+                        }
+                    } else {
+                        for (uint32_t b = 0; stored && b <= (address & 3); b++) {
+                            stored = storeLane(base + i, address - b, 1, value >> (8 * b));
+                        }
+                    }
+                    if (!stored) stopping |= 1u << i;
+                });
+                break;
+            }
+
+            // Conditional branches choose each lane's next PC
+            case MIPS::OP_BEQ:
+            case MIPS::OP_BNE:
+            case MIPS::OP_BLEZ:
+            case MIPS::OP_BGTZ:
+            case MIPS::OP_BLTZ:
+            case MIPS::OP_BGEZ:
+            case MIPS::OP_BLTZAL:
+            case MIPS::OP_BGEZAL: {
+                Vec zero = splat(0);
+                Vec taken;
+                switch (d->info->operation) {
+                    case MIPS::OP_BEQ: taken = equal(rs, rt); break;
+                    case MIPS::OP_BNE: taken = bitXor(equal(rs, rt), splat(0xFFFFFFFFu)); break;
+                    case MIPS::OP_BLEZ: taken = bitXor(lessSigned(zero, rs), splat(0xFFFFFFFFu)); break;
+                    case MIPS::OP_BGTZ: taken = lessSigned(zero, rs); break;
+                    case MIPS::OP_BLTZ:
+                    case MIPS::OP_BLTZAL: taken = lessSigned(rs, zero); break;
+                    default: taken = bitXor(lessSigned(rs, zero), splat(0xFFFFFFFFu)); break;
+                }
+                if (d->info->control.destination == MIPS::DEST_RA) {
+                    writeBack(reg(MIPS::REG_RA, base), MIPS::REG_RA, splat(group_pc + 8), m);
+                }
+                next_pc = select(taken, splat(group_pc + 4 + (d->imm_extended << 2)), next_pc);
+                control = true;
+                break;
+            }
+
+            // Jumps
+            case MIPS::OP_J:
+            case MIPS::OP_JAL:
+                if (d->info->operation == MIPS::OP_JAL) {
+                    writeBack(reg(MIPS::REG_RA, base), MIPS::REG_RA, splat(group_pc + 8), m);
+                }
+                next_pc = splat((group_pc & 0xF0000000) | (d->jump_addr << 2));
+                control = true;
+                break;
+            case MIPS::OP_JR:
+                next_pc = rs;
+                control = true;
+                break;
+            case MIPS::OP_JALR:
+                writeBack(reg(d->rd, base), d->rd, splat(group_pc + 8), m);
+                next_pc = rs;
+                control = true;
+                break;
+
+            // SYSCALL exit services and BREAK end a lane
+            case MIPS::OP_SYSCALL: {
+                Vec v0 = load(reg(MIPS::REG_V0, base));
+                stopping = bitsOf(bitOr(equal(v0, splat(MIPS::SYSCALL_EXIT)),
+                                        equal(v0, splat(MIPS::SYSCALL_EXIT2)))) & mask;
+                break;
+            }
+            case MIPS::OP_BREAK:
+                stopping = mask;
+                break;
+
+            case MIPS::OP_INVALID:
+                break;
+
+            // Coprocessor 1 is not modelled per lane; the lane stops
+            default:
+                stopping = mask;
+                break;
+        }
+
+        retired += __builtin_popcount(mask & ~stopping);
+
+        // Halting lanes keep the PC of the instruction that stopped them
+        if (stopping != 0) {
+            forEachLane(stopping, [&](int i) { halted[base + i] = 1; });
+            stats.lanes_halted += __builtin_popcount(stopping);
+            active &= ~stopping;
+            mask &= ~stopping;
+            m = laneMask(mask);
+        }
+        store(&pcs[base], select(m, next_pc, pc_vec));
+
+        // Converged straight-line code keeps the same lanes one word on
+        reselect = control || mask != active;
+        group_pc += 4;
+    }
+
+    stats.lane_instructions += retired;
+    return retired;
+}
+
+bool LockstepSimulator::loadLane(int lane, uint32_t address, uint32_t size, uint32_t& value) const {
+    if (address >= memory_size || memory_size - address < size || (address & (size - 1)) != 0) {
+        return false;
+    }
+    const uint8_t* bytes = laneMemory(lane) + address;
+    value = 0;
+    for (uint32_t i = 0; i < size; i++) {
+        value = (value << 8) | bytes[i];
+    }
+    return true;
+}
+
+bool LockstepSimulator::storeLane(int lane, uint32_t address, uint32_t size, uint32_t value) {
+    if (address >= memory_size || memory_size - address < size || (address & (size - 1)) != 0) {
+        return false;
+    }
+    uint8_t* bytes = laneMemory(lane) + address;
+    for (uint32_t i = 0; i < size; i++) {
+        bytes[i] = (value >> (8 * (size - 1 - i))) & 0xFF;
+    }
+    return true;
+}
+
+int LockstepSimulator::getLaneCount() const {
+    return lane_count;
+}
+
+uint32_t LockstepSimulator::getRegister(int lane, int reg) const {
+    if (lane < 0 || lane >= lane_count || reg < 0 || reg >= 32) return 0;
+    return registers[(size_t)reg * padded_lanes + lane];
+}
+
+void LockstepSimulator::setRegister(int lane, int reg, uint32_t value) {
+    if (lane < 0 || lane >= lane_count || reg < 1 || reg >= 32) return;
+    registers[(size_t)reg * padded_lanes + lane] = value;
+}
+
+uint32_t LockstepSimulator::getMemory(int lane, uint32_t address) const {
+    uint32_t value = 0;
+    if (lane >= 0 && lane < lane_count) {
+        loadLane(lane, address, 4, value);
+    }
+    return value;
+}
+
+void LockstepSimulator::setMemory(int lane, uint32_t address, uint32_t value) {
+    if (lane >= 0 && lane < lane_count) {
+        storeLane(lane, address, 4, value);
+    }
+}
+
+uint32_t LockstepSimulator::getPC(int lane) const {
+    if (lane < 0 || lane >= lane_count) return 0;
+    return pcs[lane];
+}
+
+bool LockstepSimulator::isHalted(int lane) const {
+    if (lane < 0 || lane >= lane_count) return true;
+    return halted[lane] != 0;
+}
+
+LockstepSimulator::LockstepStats LockstepSimulator::getStats() const {
+    return stats;
+}
+
+std::string LockstepSimulator::getStatsString() const {
+    std::ostringstream oss;
+
+    oss << "Lock-step Statistics:\n";
+    oss << "=====================\n";
+    oss << "Lanes: " << lane_count << " in " << padded_lanes / VECTOR_LANES << " groups of "
+        << VECTOR_LANES << " (" << (usesAVX2() ? "AVX2" : "scalar") << ")\n";
+    oss << "Lanes Halted: " << stats.lanes_halted << "\n";
+    oss << "Group Issues: " << stats.group_steps << "\n";
+    oss << "Lane Instructions: " << stats.lane_instructions << "\n";
+    oss << "Divergent Issues: " << stats.divergent_steps << "\n";
+    if (stats.group_steps > 0) {
+        double utilization = (double)stats.lane_instructions / (stats.group_steps * VECTOR_LANES) * 100.0;
+        oss << "Lane Utilization: " << std::fixed << std::setprecision(2) << utilization << "%\n";
+    }
+
+    return oss.str();
+}
+
+bool LockstepSimulator::usesAVX2() {
+#if defined(MIPS_LOCKSTEP_AVX2)
+    return true;
+#else
+    return false;
+#endif
+}
@@ -1,7 +1,14 @@
 #include "mips_simulator.hpp"
+#include "lockstep_simulator.hpp"
+#include "assembler.hpp"
+#include "host_profiler.hpp"
 #include <iostream>
+#include <iomanip>
 #include <string>
 #include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cstdlib>
 
 void printUsage(const char* program_name) {
     std::cout << "Usage: " << program_name << " <program_file> [options]\n";
@@ -9,12 +16,100 @@ void printUsage(const char* program_name) {
     std::cout << "  --step           Enable step-by-step execution\n";
     std::cout << "  --pipeline       Enable 5-stage pipeline simulation\n";
     std::cout << "  --branch-pred    Enable branch prediction\n";
-    std::cout << "  --pred-type TYPE Set branch predictor type (static|1bit|2bit)\n";
+    std::cout << "  --pred-type TYPE Set branch predictor type (static|taken|1bit|2bit|gshare)\n";
+    std::cout << "  --loop-pred      Add the loop predictor to the branch predictor\n";
+    std::cout << "  --penalty N      Extra cycles charged per misprediction (pipeline)\n";
+    std::cout << "  --mult-latency N Multiply result latency in cycles (pipeline, default 12)\n";
+    std::cout << "  --div-latency N  Divide result latency in cycles (pipeline, default 35)\n";
+    std::cout << "  --muldiv-pipelined  Let a multiply/divide start every cycle (pipeline)\n";
+    std::cout << "  --fp-latency LIST   FPU latencies, e.g. mul=4,div.d=19 (pipeline)\n";
+    std::cout << "  --trace FILE     Record every retired instruction to a binary trace\n";
+    std::cout << "  --timeline FILE  Write per-cycle stage occupancy as a Chrome trace (pipeline)\n";
+    std::cout << "  --profile        Report the hottest instructions and basic blocks\n";
+    std::cout << "  --profile-stacks FILE   Write collapsed call stacks for flame graphs\n";
+    std::cout << "  --icache CONFIG  Count instruction cache misses, SIZE:WAYS:LINE, e.g. 8k:2:32\n";
+    std::cout << "  --dcache CONFIG  Count data cache misses, SIZE:WAYS:LINE\n";
+    std::cout << "  --perf           Print the performance counters after the run\n";
+    std::cout << "  --perf-json FILE Write the performance counters to FILE as JSON\n";
+    std::cout << "  --save-checkpoint FILE  Save the simulator state to FILE when the run ends\n";
+    std::cout << "  --checkpoint-at N       Save it after N steps instead, then keep running\n";
+    std::cout << "  --restore FILE   Start from a saved checkpoint instead of loading the program\n";
+    std::cout << "  --host-counters  Add host hardware counters to the self-profile (MIPS_SELF_PROFILE builds)\n";
+    std::cout << "  --asm            Treat the program file as assembly source\n";
+    std::cout << "  --lanes N        Run N lock-step copies, lane index in $a0 (functional only)\n";
     std::cout << "  --help           Show this help message\n";
     std::cout << "\nExample:\n";
     std::cout << "  " << program_name << " program.txt --pipeline --branch-pred --pred-type 2bit\n";
 }
 
+// Apply "class=cycles" entries separated by commas
+bool setFPLatencies(MIPSSimulator& simulator, const std::string& list) {
+    std::istringstream entries(list);
+    std::string entry;
+    while (std::getline(entries, entry, ',')) {
+        size_t equals = entry.find('=');
+        if (equals == std::string::npos) {
+            return false;
+        }
+        int cycles = std::atoi(entry.c_str() + equals + 1);
+        if (cycles < 1 || !simulator.setFPLatency(entry.substr(0, equals), cycles)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Assemble a source file, reporting errors on stderr
+bool assembleProgram(Assembler& assembler, const std::string& program_file) {
+    if (!assembler.assembleFile(program_file)) {
+        std::cerr << "Error: Could not assemble " << program_file << ":\n" << assembler.getErrorString();
+        return false;
+    }
+    return true;
+}
+
+// Run the program once per lane with the lane index in $a0
+int runLockstep(const std::string& program_file, int lanes, bool assembly) {
+    LockstepSimulator engine(lanes);
+    if (assembly) {
+        Assembler assembler;
+        if (!assembleProgram(assembler, program_file)) {
+            return 1;
+        }
+        engine.loadProgramImage(assembler.getImage());
+    } else if (!engine.loadProgram(program_file)) {
+        std::cerr << "Error: Could not load program file: " << program_file << std::endl;
+        return 1;
+    }
+    for (int lane = 0; lane < lanes; lane++) {
+        engine.setRegister(lane, MIPS::REG_A0, lane);
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    uint64_t instructions = engine.run();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    
+    std::cout << "MIPS Simulator (lock-step)\n";
+    std::cout << "==========================\n";
+    std::cout << "Program: " << program_file << "\n\n";
+    std::cout << engine.getStatsString();
+    if (seconds > 0) {
+        std::cout << "Throughput: " << std::fixed << std::setprecision(1)
+                  << instructions / seconds / 1e6 << " M lane-instructions/s\n";
+    }
+    
+    std::cout << "\nLane     PC          $v0\n";
+    for (int lane = 0; lane < lanes && lane < 8; lane++) {
+        std::cout << std::dec << std::setw(4) << std::setfill(' ') << lane
+                  << "     0x" << std::hex << std::setw(8) << std::setfill('0') << engine.getPC(lane)
+                  << "  0x" << std::setw(8) << engine.getRegister(lane, MIPS::REG_V0) << "\n";
+    }
+    if (lanes > 8) {
+        std::cout << std::dec << "... " << lanes - 8 << " more lanes\n";
+    }
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
     if (argc < 2) {
         printUsage(argv[0]);
@@ -26,6 +121,26 @@ int main(int argc, char* argv[]) {
     bool pipeline_enabled = false;
     bool branch_prediction = false;
     std::string predictor_type = "static";
+    int mispredict_penalty = 0;
+    bool loop_predictor = false;
+    int multiply_latency = 12;
+    int divide_latency = 35;
+    bool muldiv_pipelined = false;
+    std::string fp_latencies;
+    int lanes = 0;
+    bool assembly = false;
+    std::string trace_file;
+    std::string timeline_file;
+    std::string save_file;
+    uint64_t checkpoint_at = 0;
+    std::string restore_file;
+    bool profile = false;
+    std::string stacks_file;
+    std::string icache_config;
+    std::string dcache_config;
+    bool perf = false;
+    std::string perf_file;
+    bool host_counters = false;
     
     // Parse command line arguments
     for (int i = 2; i < argc; i++) {
@@ -42,6 +157,50 @@ int main(int argc, char* argv[]) {
             branch_prediction = true;
         } else if (arg == "--pred-type" && i + 1 < argc) {
             predictor_type = argv[++i];
+        } else if (arg == "--loop-pred") {
+            loop_predictor = true;
+        } else if (arg == "--penalty" && i + 1 < argc) {
+            mispredict_penalty = std::atoi(argv[++i]);
+        } else if (arg == "--mult-latency" && i + 1 < argc) {
+            multiply_latency = std::atoi(argv[++i]);
+        } else if (arg == "--div-latency" && i + 1 < argc) {
+            divide_latency = std::atoi(argv[++i]);
+        } else if (arg == "--muldiv-pipelined") {
+            muldiv_pipelined = true;
+        } else if (arg == "--fp-latency" && i + 1 < argc) {
+            fp_latencies = argv[++i];
+        } else if (arg == "--trace" && i + 1 < argc) {
+            trace_file = argv[++i];
+        } else if (arg == "--timeline" && i + 1 < argc) {
+            timeline_file = argv[++i];
+        } else if (arg == "--profile") {
+            profile = true;
+        } else if (arg == "--profile-stacks" && i + 1 < argc) {
+            stacks_file = argv[++i];
+        } else if (arg == "--icache" && i + 1 < argc) {
+            icache_config = argv[++i];
+        } else if (arg == "--dcache" && i + 1 < argc) {
+            dcache_config = argv[++i];
+        } else if (arg == "--perf") {
+            perf = true;
+        } else if (arg == "--perf-json" && i + 1 < argc) {
+            perf_file = argv[++i];
+        } else if (arg == "--save-checkpoint" && i + 1 < argc) {
+            save_file = argv[++i];
+        } else if (arg == "--checkpoint-at" && i + 1 < argc) {
+            checkpoint_at = std::strtoull(argv[++i], nullptr, 0);
+        } else if (arg == "--restore" && i + 1 < argc) {
+            restore_file = argv[++i];
+        } else if (arg == "--host-counters") {
+            host_counters = true;
+        } else if (arg == "--asm") {
+            assembly = true;
+        } else if (arg == "--lanes" && i + 1 < argc) {
+            lanes = std::atoi(argv[++i]);
+            if (lanes < 1) {
+                std::cerr << "Error: --lanes needs a positive lane count\n";
+                return 1;
+            }
         } else {
             std::cerr << "Unknown option: " << arg << std::endl;
             printUsage(argv[0]);
@@ -49,26 +208,104 @@ int main(int argc, char* argv[]) {
         }
     }
     
+    // Start the host clock before any simulator work
+    if (HostProfiler::ENABLED) {
+        HostProfiler::instance();
+    }
+    if (host_counters) {
+        if (!HostProfiler::ENABLED) {
+            std::cerr << "Error: --host-counters needs a build with -DMIPS_SELF_PROFILE=ON\n";
+            return 1;
+        }
+        if (!HostProfiler::instance().enableHardwareCounters()) {
+            std::cerr << "Warning: Host hardware counters are unavailable (perf_event_open failed)\n";
+        }
+    }
+    
+    if (lanes > 0) {
+        if (step_mode || pipeline_enabled || branch_prediction || !trace_file.empty() || !timeline_file.empty() ||
+            !save_file.empty() || !restore_file.empty() || profile || !stacks_file.empty() ||
+            !icache_config.empty() || !dcache_config.empty() || perf || !perf_file.empty()) {
+            std::cerr << "Error: --lanes runs the functional model only\n";
+            return 1;
+        }
+        return runLockstep(program_file, lanes, assembly);
+    }
+    
     // Create and configure simulator
     MIPSSimulator simulator;
     simulator.setStepMode(step_mode);
     simulator.enablePipeline(pipeline_enabled);
-    simulator.enableBranchPrediction(branch_prediction, predictor_type);
+    simulator.setMispredictPenalty(mispredict_penalty);
+    simulator.setMulDivLatency(multiply_latency, divide_latency);
+    simulator.setMulDivPipelined(muldiv_pipelined);
+    if (!setFPLatencies(simulator, fp_latencies)) {
+        std::cerr << "Error: Invalid FP latency list: " << fp_latencies << std::endl;
+        return 1;
+    }
+    if ((!icache_config.empty() && !simulator.configureCache(true, icache_config)) ||
+        (!dcache_config.empty() && !simulator.configureCache(false, dcache_config))) {
+        std::cerr << "Error: Invalid cache configuration (expected SIZE[k]:WAYS:LINE)\n";
+        return 1;
+    }
+    simulator.enableLoopPredictor(loop_predictor);
+    if (!simulator.enableBranchPrediction(branch_prediction, predictor_type)) {
+        std::cerr << "Error: Unknown branch predictor type: " << predictor_type << std::endl;
+        return 1;
+    }
     
-    // Load program
-    if (!simulator.loadProgram(program_file)) {
+    // Load program, or the state it had reached
+    if (!restore_file.empty()) {
+        if (!simulator.loadCheckpoint(restore_file)) {
+            std::cerr << "Error: Could not restore checkpoint " << restore_file
+                      << " (missing, another version, or saved with other pipeline or predictor settings)\n";
+            return 1;
+        }
+    } else if (assembly) {
+        Assembler assembler;
+        if (!assembleProgram(assembler, program_file)) {
+            return 1;
+        }
+        simulator.loadProgramImage(assembler.getImage());
+    } else if (!simulator.loadProgram(program_file)) {
         std::cerr << "Error: Could not load program file: " << program_file << std::endl;
         return 1;
     }
     
+    simulator.enableProfiling(profile || !stacks_file.empty());
+    
+    if (!trace_file.empty() && !simulator.startTrace(trace_file)) {
+        std::cerr << "Error: Could not open trace file: " << trace_file << std::endl;
+        return 1;
+    }
+    if (!timeline_file.empty() && !simulator.startTimeline(timeline_file)) {
+        std::cerr << "Error: " << (pipeline_enabled ? "Could not open timeline file: " + timeline_file
+                                                     : std::string("--timeline needs --pipeline")) << std::endl;
+        return 1;
+    }
+    
     std::cout << "MIPS Simulator\n";
     std::cout << "==============\n";
     std::cout << "Program: " << program_file << "\n";
     std::cout << "Step Mode: " << (step_mode ? "Enabled" : "Disabled") << "\n";
     std::cout << "Pipeline: " << (pipeline_enabled ? "Enabled" : "Disabled") << "\n";
     std::cout << "Branch Prediction: " << (branch_prediction ? "Enabled (" + predictor_type + ")" : "Disabled") << "\n";
+    if (!restore_file.empty()) {
+        std::cout << "Restored: " << restore_file << "\n";
+    }
     std::cout << "\n";
     
+    // Warm up, save, and carry on from the same state
+    if (!save_file.empty() && checkpoint_at > 0) {
+        for (uint64_t i = 0; i < checkpoint_at && simulator.step(); i++) {
+        }
+        if (!simulator.saveCheckpoint(save_file)) {
+            std::cerr << "Error: Could not write checkpoint file: " << save_file << std::endl;
+            return 1;
+        }
+        std::cout << "Checkpoint saved to " << save_file << " after " << checkpoint_at << " steps\n\n";
+    }
+    
     if (step_mode) {
         std::string input;
         int cycle = 0;
@@ -89,15 +326,21 @@ int main(int argc, char* argv[]) {
             }
             
             if (!simulator.step()) {
-                std::cout << "\nSimulation completed or error occurred.\n";
+                if (simulator.getStopReason() == MIPSSimulator::STOP_ADDRESS_ERROR) {
+                    std::cout << "\n" << simulator.getAddressErrorString() << "\n";
+                } else {
+                    std::cout << "\nSimulation completed or error occurred.\n";
+                }
                 break;
             }
         }
     } else {
         // Run simulation
-        simulator.run();
-        
-        std::cout << "Simulation completed.\n\n";
+        if (simulator.run() == MIPSSimulator::STOP_ADDRESS_ERROR) {
+            std::cout << "Simulation stopped. " << simulator.getAddressErrorString() << "\n\n";
+        } else {
+            std::cout << "Simulation completed.\n\n";
+        }
         std::cout << "Final State:\n";
         std::cout << simulator.getStateString();
         
@@ -106,8 +349,64 @@ int main(int argc, char* argv[]) {
         }
     }
     
+    if (!save_file.empty() && checkpoint_at == 0) {
+        if (!simulator.saveCheckpoint(save_file)) {
+            std::cerr << "Error: Could not write checkpoint file: " << save_file << std::endl;
+            return 1;
+        }
+        std::cout << "\nCheckpoint saved to " << save_file << "\n";
+    }
+    
     if (branch_prediction) {
         std::cout << "\n" << simulator.getBranchPredictionStats();
+        std::cout << "\n" << simulator.getBranchProfileString();
+    }
+    
+    if (perf) {
+        std::cout << "\n" << simulator.getPerfCountersString();
+    }
+    if (!perf_file.empty()) {
+        std::ofstream json(perf_file);
+        json << simulator.getPerfCountersJSON();
+        json.close();
+        if (json.fail()) {
+            std::cerr << "Error: Could not write counter file: " << perf_file << std::endl;
+            return 1;
+        }
+        std::cout << "\nPerformance counters written to " << perf_file << "\n";
+    }
+    
+    if (profile) {
+        std::cout << "\n" << simulator.getProfileString();
+    }
+    if (!stacks_file.empty()) {
+        if (!simulator.writeCollapsedStacks(stacks_file)) {
+            std::cerr << "Error: Could not write stack file: " << stacks_file << std::endl;
+            return 1;
+        }
+        std::cout << "\nCollapsed stacks written to " << stacks_file << "\n";
+    }
+    
+    if (simulator.isRecordingTimeline()) {
+        if (!simulator.stopTimeline()) {
+            std::cerr << "Error: Could not write timeline file: " << timeline_file << std::endl;
+            return 1;
+        }
+        std::cout << "\nTimeline: " << simulator.getTimelineEventCount() << " events written to "
+                  << timeline_file << "\n";
+    }
+    
+    if (simulator.isTracing()) {
+        if (!simulator.stopTrace()) {
+            std::cerr << "Error: Could not write trace file: " << trace_file << std::endl;
+            return 1;
+        }
+        std::cout << "\nTrace: " << simulator.getTraceRecordCount() << " instructions, "
+                  << simulator.getTraceByteCount() << " bytes written to " << trace_file << "\n";
+    }
+    
+    if (HostProfiler::ENABLED) {
+        std::cout << "\n" << HostProfiler::instance().getReportString();
     }
     
     return 0;
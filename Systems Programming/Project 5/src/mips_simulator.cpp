@@ -3,18 +3,37 @@
 #include "alu.hpp"
 #include "pipeline.hpp"
 #include "branch_predictor.hpp"
+#include "checkpoint_file.hpp"
+#include "host_profiler.hpp"
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
+#include <chrono>
+
+const MIPS::InstructionInfo MIPSSimulator::TRAP_INFO =
+    MIPS::makeInfo("trap", MIPS::FORMAT_R, MIPS::LAYOUT_NONE, MIPS::OP_INVALID, MIPS::DEST_NONE, 0);
+
+// Timeline names of StallCause values, then of refill bubbles
+static const char* const STALL_NAMES[] = {"none", "load-use", "HI/LO", "FP", "redirect"};
 
 MIPSSimulator::MIPSSimulator() 
-    : registers(32, 0), memory(65536, 0), pc(0), halted(false), 
-      step_mode(false), pipeline_enabled(false), branch_prediction_enabled(false),
-      prediction_type("static") {
+    : registers(32, 0), memory(65536, 0), hi(0), lo(0), fpu_used(false), pc(0), halted(false), 
+      step_mode(false), pipeline_enabled(false), fetch_pc(0),
+      mispredict_penalty(0), redirect_stall(0),
+      branch_prediction_enabled(false), branch_trace(nullptr),
+      trace_records(0), trace_bytes(0), timeline_events(0), perf(), caches_enabled(false),
+      history_enabled(false), page_saved(memory.size() / PAGE_SIZE, 0),
+      profile_saved(memory.size() / 4 / PROFILE_BLOCK, 0),
+      retired(0), next_checkpoint(0), checkpoint_interval(8192),
+      stop_reason(STOP_NONE), stop_requested(0), stops_suspended(false), resume_pc(0),
+      page_watch(memory.size() / PAGE_SIZE, 0), watch_hit(), address_error(), watch_seen(false),
+      decode_cache(memory.size() / 4) {
+    invalidateDecodeCache();
     initializePipeline();
-    branch_stats = {0, 0, 0};
+    resetBranchStats();
+    selectStepFunction();
 }
 
 MIPSSimulator::~MIPSSimulator() {}
@@ -75,50 +94,275 @@ bool MIPSSimulator::loadProgramFromString(const std::string& program) {
     return true;
 }
 
+bool MIPSSimulator::loadProgramImage(const std::vector<uint8_t>& image) {
+    if (image.size() > memory.size()) {
+        return false;
+    }
+    std::copy(image.begin(), image.end(), memory.begin());
+    std::fill(memory.begin() + image.size(), memory.end(), 0);
+    reset();
+    return true;
+}
+
 void MIPSSimulator::reset() {
     std::fill(registers.begin(), registers.end(), 0);
+    hi = 0;
+    lo = 0;
+    fpu.reset();
+    fpu_used = false;
     pc = 0;
     halted = false;
+    invalidateDecodeCache();
     if (pipeline_enabled) {
         initializePipeline();
     }
-    branch_stats = {0, 0, 0};
+    resetBranchStats();
+    branch_predictor.reset();
+    target_predictor.reset();
+    if (profiler != nullptr) {
+        profiler->reset(pc, pipeline_enabled);
+    }
+    instruction_cache.reset();
+    data_cache.reset();
+    resetPerfCounters();
+    retired = 0;
+    if (history_enabled) {
+        restartHistory();
+    }
+}
+
+bool MIPSSimulator::saveCheckpoint(const std::string& filename) const {
+    CheckpointFile file;
+    file.put(pipeline_enabled);
+    file.put(branch_prediction_enabled);
+    
+    file.putBytes(registers.data(), registers.size() * sizeof(uint32_t));
+    file.put(hi);
+    file.put(lo);
+    file.put(pc);
+    file.put(halted);
+    for (int reg = 0; reg < 32; reg++) {
+        file.put(fpu.getRegister(reg));
+    }
+    file.put(fpu.readControl(31));
+    file.put(fpu_used);
+    
+    pipeline.saveState(file);
+    file.put(fetch_pc);
+    file.put(redirect_stall);
+    file.put(pipeline_stats);
+    file.put(scoreboard.getState());
+    file.put(scoreboard_before_issue);
+    
+    branch_predictor.saveState(file);
+    target_predictor.saveState(file);
+    file.put(branch_stats);
+    // Only branches that have executed have profile entries
+    uint32_t profiled = std::count_if(branch_profile.begin(), branch_profile.end(),
+                                      [](const BranchProfileEntry& entry) { return entry.executions != 0; });
+    file.put(profiled);
+    for (uint32_t index = 0; index < branch_profile.size(); index++) {
+        if (branch_profile[index].executions != 0) {
+            file.put(index);
+            file.put(branch_profile[index]);
+        }
+    }
+    file.put(perf);
+    
+    for (uint32_t page = 0; page < memory.size() / PAGE_SIZE; page++) {
+        const uint8_t* data = &memory[page * PAGE_SIZE];
+        if (std::any_of(data, data + PAGE_SIZE, [](uint8_t byte) { return byte != 0; })) {
+            file.addPage(page, data);
+        }
+    }
+    return file.write(filename, PAGE_SIZE, memory.size());
+}
+
+bool MIPSSimulator::loadCheckpoint(const std::string& filename) {
+    CheckpointFile file;
+    bool saved_pipeline, saved_prediction;
+    if (!file.read(filename) || file.getPageSize() != PAGE_SIZE || file.getMemorySize() != memory.size() ||
+        !file.get(saved_pipeline) || !file.get(saved_prediction) ||
+        saved_pipeline != pipeline_enabled || saved_prediction != branch_prediction_enabled) {
+        return false;
+    }
+    
+    // Read into copies so that a bad file leaves the simulator unchanged
+    std::vector<uint32_t> new_registers(32);
+    uint32_t new_hi, new_lo, new_pc, fp_bits, new_fcsr;
+    bool new_halted, new_fpu_used;
+    FPU new_fpu;
+    if (!file.getBytes(new_registers.data(), new_registers.size() * sizeof(uint32_t)) ||
+        !file.get(new_hi) || !file.get(new_lo) || !file.get(new_pc) || !file.get(new_halted)) {
+        return false;
+    }
+    for (int reg = 0; reg < 32; reg++) {
+        if (!file.get(fp_bits)) return false;
+        new_fpu.setRegister(reg, fp_bits);
+    }
+    if (!file.get(new_fcsr) || !file.get(new_fpu_used)) {
+        return false;
+    }
+    new_fpu.writeControl(31, new_fcsr);
+    
+    Pipeline new_pipeline = pipeline;
+    uint32_t new_fetch_pc;
+    int new_redirect_stall;
+    PipelineStats new_pipeline_stats;
+    HazardScoreboard::State new_scoreboard, new_scoreboard_before_issue;
+    if (!new_pipeline.loadState(file) || !file.get(new_fetch_pc) || !file.get(new_redirect_stall) ||
+        !file.get(new_pipeline_stats) || !file.get(new_scoreboard) || !file.get(new_scoreboard_before_issue)) {
+        return false;
+    }
+    // Occupied latches hold instructions fetched from memory; the profiles
+    // are indexed by their PCs
+    const Pipeline::PipelineRegister& latches = new_pipeline.getRegisters();
+    if ((latches.if_id_valid && !isValidFetchAddress(latches.if_id_pc)) ||
+        (latches.id_ex_valid && !isValidFetchAddress(latches.id_ex_pc)) ||
+        (latches.ex_mem_valid && !isValidFetchAddress(latches.ex_mem_pc)) ||
+        (latches.mem_wb_valid && !isValidFetchAddress(latches.mem_wb_pc)) ||
+        (latches.wb_valid && !isValidFetchAddress(latches.wb_pc))) {
+        return false;
+    }
+    
+    BranchPredictor new_branch_predictor = branch_predictor;
+    BranchTargetPredictor new_target_predictor = target_predictor;
+    BranchStats new_branch_stats;
+    uint32_t profiled;
+    if (!new_branch_predictor.loadState(file) || !new_target_predictor.loadState(file) ||
+        !file.get(new_branch_stats) || !file.get(profiled)) {
+        return false;
+    }
+    std::vector<BranchProfileEntry> new_branch_profile(branch_profile.size(), BranchProfileEntry{0, 0, 0, 0});
+    for (uint32_t i = 0; i < profiled; i++) {
+        uint32_t index;
+        if (!file.get(index) || index >= new_branch_profile.size() || !file.get(new_branch_profile[index])) {
+            return false;
+        }
+    }
+    PerfCounters new_perf;
+    if (!file.get(new_perf) || !file.isStateConsumed()) {
+        return false;
+    }
+    for (size_t i = 0; i < file.getPageCount(); i++) {
+        if (file.getPageNumber(i) >= memory.size() / PAGE_SIZE) {
+            return false;
+        }
+    }
+    
+    // Pages not in the file are zero
+    std::fill(memory.begin(), memory.end(), 0);
+    for (size_t i = 0; i < file.getPageCount(); i++) {
+        std::copy(file.getPageData(i), file.getPageData(i) + PAGE_SIZE, &memory[file.getPageNumber(i) * PAGE_SIZE]);
+    }
+    registers = new_registers;
+    hi = new_hi;
+    lo = new_lo;
+    pc = new_pc;
+    halted = new_halted;
+    fpu = new_fpu;
+    fpu_used = new_fpu_used;
+    pipeline = new_pipeline;
+    fetch_pc = new_fetch_pc;
+    redirect_stall = new_redirect_stall;
+    pipeline_stats = new_pipeline_stats;
+    scoreboard.setState(new_scoreboard);
+    scoreboard_before_issue = new_scoreboard_before_issue;
+    branch_predictor = new_branch_predictor;
+    target_predictor = new_target_predictor;
+    branch_stats = new_branch_stats;
+    branch_profile.swap(new_branch_profile);
+    perf = new_perf;
+    
+    invalidateDecodeCache();
+    stop_reason = STOP_NONE;
+    if (profiler != nullptr) {
+        profiler->reset(pc, pipeline_enabled);
+    }
+    retired = 0;
+    if (history_enabled) {
+        restartHistory();
+    }
+    return true;
 }
 
 bool MIPSSimulator::step() {
     if (halted) return false;
-    
+    if (takeStopRequest()) return false;
+    beginExecution();
+    bool running = history_enabled ? stepRecorded() : (this->*step_function)();
+    endExecution();
+    return running;
+}
+
+template <typename Policy, bool Fuse>
+bool MIPSSimulator::stepWith() {
     if (pipeline_enabled) {
-        advancePipeline();
+        advancePipeline<Policy>();
     } else {
         // Fetch
-        if (!isValidAddress(pc)) {
+        if (!isValidFetchAddress(pc)) {
             halted = true;
             return false;
         }
         
-        uint32_t instruction = (memory[pc] << 24) | (memory[pc + 1] << 16) | 
-                              (memory[pc + 2] << 8) | memory[pc + 3];
-        
         // Decode and Execute
-        Instruction instr = decodeInstruction(instruction);
-        if (!executeInstruction(instr)) {
-            halted = true;
+        const Instruction& instr = fetchDecoded(pc);
+        if constexpr (Fuse) {
+            if (instr.fusion != FUSE_NONE) {
+                if (!executeFused<Policy>(instr)) {
+                    halted = true;
+                    return false;
+                }
+                registers[0] = 0;
+                return !halted;
+            }
+        }
+        
+        uint32_t instr_pc = pc;
+        uint32_t predicted_pc = predictNextPC<Policy>(pc);
+        if (!executeInstruction<Policy>(instr)) {
+            halted = stop_reason != STOP_BREAKPOINT;
             return false;
         }
+        
+        if (pc != predicted_pc) {
+            recordRedirect(instr_pc);
+        }
     }
     
     registers[0] = 0; // $zero always zero
     return !halted;
 }
 
-void MIPSSimulator::run() {
-    while (!halted && step()) {
-        if (step_mode) break;
+MIPSSimulator::StopReason MIPSSimulator::run() {
+    if (step_mode) {
+        step();
+        return stop_reason;
     }
+    beginExecution();
+    if (history_enabled) {
+        // One instruction at a time, so checkpoints land on exact counts
+        // and requestStop() is seen between instructions
+        while (!halted && !takeStopRequest() && stepRecorded()) {
+        }
+    } else {
+        // requestStop() is checked between batches, keeping the check out
+        // of the per-instruction loop
+        const int STOP_POLL_INTERVAL = 4096;
+        bool running = !halted;
+        while (running && !takeStopRequest()) {
+            for (int i = 0; i < STOP_POLL_INTERVAL && running; i++) {
+                running = (this->*run_function)();
+            }
+        }
+    }
+    endExecution();
+    return stop_reason;
 }
 
 MIPSSimulator::Instruction MIPSSimulator::decodeInstruction(uint32_t instruction) {
+    HOST_PHASE(PHASE_DECODE);
     Instruction instr;
     instr.raw = instruction;
     instr.opcode = (instruction >> 26) & 0x3F;
@@ -129,122 +373,674 @@ MIPSSimulator::Instruction MIPSSimulator::decodeInstruction(uint32_t instruction
     instr.funct = instruction & 0x3F;
     instr.immediate = instruction & 0xFFFF;
     instr.jump_addr = instruction & 0x3FFFFFF;
+    instr.fusion = FUSE_NONE;
+    instr.fused_value = 0;
+    instr.info = &InstructionDecoder::info(instruction);
     
-    if (instr.opcode == 0) {
-        instr.type = "R";
-    } else if (instr.opcode == 2 || instr.opcode == 3) {
-        instr.type = "J";
-    } else {
-        instr.type = "I";
+    const MIPS::ControlSignals& control = instr.info->control;
+    instr.dest = 0;
+    switch (control.destination) {
+        case MIPS::DEST_RD: instr.dest = instr.rd; break;
+        case MIPS::DEST_RT: instr.dest = instr.rt; break;
+        case MIPS::DEST_RA: instr.dest = MIPS::REG_RA; break;
+        case MIPS::DEST_NONE: break;
     }
-    
+    instr.trace_flags = 0;
+    if (instr.dest != 0) instr.trace_flags |= TraceWriter::TRACE_DEST;
+    if (control.mem_read || control.mem_write) instr.trace_flags |= TraceWriter::TRACE_MEMORY;
+    if (control.branch || control.jump) instr.trace_flags |= TraceWriter::TRACE_BRANCH;
+    instr.perf_class = classify(*instr.info);
     return instr;
 }
 
+const MIPSSimulator::Instruction& MIPSSimulator::fetchDecoded(uint32_t address) {
+    HOST_PHASE(PHASE_FETCH);
+    Instruction& entry = decode_cache[address >> 2];
+    if (entry.info == nullptr) {
+        uint32_t instruction = (memory[address] << 24) | (memory[address + 1] << 16) |
+                               (memory[address + 2] << 8) | memory[address + 3];
+        entry = decodeInstruction(instruction);
+        if (!breakpoints.empty() && findBreakpoint(address) != nullptr) {
+            entry.info = &TRAP_INFO;
+        } else {
+            fuseInstruction(entry, address);
+        }
+    }
+    return entry;
+}
+
+// Mark first when it and the following word form a fusable idiom. Each
+// pair writes one nonzero register that the second instruction reads.
+void MIPSSimulator::fuseInstruction(Instruction& first, uint32_t address) {
+    if (!isValidAddress(address + 4)) {
+        return;
+    }
+    if (!breakpoints.empty() && findBreakpoint(address + 4) != nullptr) {
+        return; // The second word must trap on its own
+    }
+    uint32_t next = (memory[address + 4] << 24) | (memory[address + 5] << 16) |
+                    (memory[address + 6] << 8) | memory[address + 7];
+    MIPS::Operation second = InstructionDecoder::info(next).operation;
+    uint8_t second_rs = (next >> 21) & 0x1F;
+    uint8_t second_rt = (next >> 16) & 0x1F;
+    
+    uint8_t dest;
+    uint8_t fusion;
+    switch (first.info->operation) {
+        case MIPS::OP_LUI:
+            if (second != MIPS::OP_ORI || second_rs != first.rt || second_rt != first.rt) {
+                return;
+            }
+            first.fused_value = ((uint32_t)first.immediate << 16) | (next & 0xFFFF);
+            dest = first.rt;
+            fusion = FUSE_LUI_ORI;
+            break;
+        case MIPS::OP_SLT:
+        case MIPS::OP_SLTU:
+            dest = first.rd;
+            fusion = FUSE_COMPARE_BRANCH;
+            break;
+        case MIPS::OP_SLTI:
+        case MIPS::OP_SLTIU:
+            dest = first.rt;
+            fusion = FUSE_COMPARE_BRANCH;
+            break;
+        case MIPS::OP_ADDI:
+        case MIPS::OP_ADDIU:
+            dest = first.rt;
+            fusion = FUSE_ADD_BRANCH;
+            break;
+        default:
+            return;
+    }
+    if (fusion != FUSE_LUI_ORI &&
+        ((second != MIPS::OP_BEQ && second != MIPS::OP_BNE) || (second_rs != dest && second_rt != dest))) {
+        return;
+    }
+    if (dest != 0) {
+        first.fusion = fusion;
+    }
+}
+
+void MIPSSimulator::invalidateDecoded(uint32_t address, uint32_t size) {
+    // An unaligned store may straddle two words, and the word before may
+    // be fused with the first
+    decode_cache[address >> 2].info = nullptr;
+    decode_cache[(address + size - 1) >> 2].info = nullptr;
+    if (address >= 4) {
+        decode_cache[(address >> 2) - 1].info = nullptr;
+    }
+}
+
+void MIPSSimulator::invalidateDecodeCache() {
+    for (auto& entry : decode_cache) {
+        entry.info = nullptr;
+    }
+}
+
+// Append one record for an instruction that retired at address at
+void MIPSSimulator::traceRetired(const Instruction& instr, uint32_t at, uint32_t address, uint32_t next_pc) {
+    uint8_t flags = instr.trace_flags;
+    if ((flags & TraceWriter::TRACE_BRANCH) && next_pc != at + 4) {
+        flags |= TraceWriter::TRACE_TAKEN;
+    }
+    trace_writer->record(at, instr.raw, flags, instr.dest, registers[instr.dest], address);
+}
+
+// Caches see the fetch of every executed instruction and the effective
+// address of its load or store
+void MIPSSimulator::accessCaches(const Instruction& instr, uint32_t at, uint32_t address) {
+    perf.icache_accesses++;
+    if (!instruction_cache.access(at, false)) perf.icache_misses++;
+    if (instr.perf_class == CLASS_LOAD || instr.perf_class == CLASS_STORE) {
+        perf.dcache_accesses++;
+        if (!data_cache.access(address, instr.perf_class == CLASS_STORE)) perf.dcache_misses++;
+    }
+}
+
+MIPSSimulator::InstructionClass MIPSSimulator::classify(const MIPS::InstructionInfo& info) {
+    if (info.control.mem_read) return CLASS_LOAD;
+    if (info.control.mem_write) return CLASS_STORE;
+    if (info.control.branch) return CLASS_BRANCH;
+    if (info.control.jump) return CLASS_JUMP;
+    if (info.fp.latency != MIPS::FPLAT_NONE) return CLASS_FP;
+    switch (info.operation) {
+        case MIPS::OP_MULT:
+        case MIPS::OP_MULTU:
+        case MIPS::OP_DIV:
+        case MIPS::OP_DIVU:
+        case MIPS::OP_MFHI:
+        case MIPS::OP_MFLO:
+        case MIPS::OP_MTHI:
+        case MIPS::OP_MTLO:
+            return CLASS_MULDIV;
+        case MIPS::OP_MFC1:
+        case MIPS::OP_MTC1:
+        case MIPS::OP_CFC1:
+        case MIPS::OP_CTC1:
+            return CLASS_FP;
+        case MIPS::OP_SYSCALL:
+        case MIPS::OP_BREAK:
+        case MIPS::OP_INVALID:
+            return CLASS_SYSTEM;
+        default:
+            return CLASS_ALU;
+    }
+}
+
+void MIPSSimulator::profileRetired(uint32_t at, BranchTargetPredictor::BranchKind kind, uint32_t next_pc) {
+    profiler->recordInstruction(at);
+    if (kind == BranchTargetPredictor::KIND_CALL) {
+        profiler->recordCall(next_pc);
+    } else if (kind == BranchTargetPredictor::KIND_RETURN) {
+        profiler->recordReturn();
+    }
+}
+
+template <typename Policy>
 bool MIPSSimulator::executeInstruction(const Instruction& instr) {
+    HOST_PHASE(PHASE_EXECUTE);
     uint32_t next_pc = pc + 4;
     bool branch_taken = false;
+    BranchTargetPredictor::BranchKind branch_kind = BranchTargetPredictor::KIND_NONE;
     
-    if (instr.type == "R") {
-        ALU::Result result;
-        
-        switch (instr.funct) {
-            case MIPS::FUNCT_ADD:
-                result = ALU::execute(registers[instr.rs], registers[instr.rt], ALU::ADD);
-                registers[instr.rd] = result.value;
-                break;
-            case MIPS::FUNCT_SUB:
-                result = ALU::execute(registers[instr.rs], registers[instr.rt], ALU::SUB);
-                registers[instr.rd] = result.value;
-                break;
-            case MIPS::FUNCT_AND:
-                result = ALU::execute(registers[instr.rs], registers[instr.rt], ALU::AND);
-                registers[instr.rd] = result.value;
-                break;
-            case MIPS::FUNCT_OR:
-                result = ALU::execute(registers[instr.rs], registers[instr.rt], ALU::OR);
-                registers[instr.rd] = result.value;
-                break;
-            case MIPS::FUNCT_SLT:
-                result = ALU::execute(registers[instr.rs], registers[instr.rt], ALU::SLT);
-                registers[instr.rd] = result.value;
-                break;
-            case MIPS::FUNCT_JR:
-                next_pc = registers[instr.rs];
-                break;
+    uint32_t rs_value = registers[instr.rs];
+    uint32_t rt_value = registers[instr.rt];
+    uint32_t imm_extended = signExtend16(instr.immediate);
+    uint32_t address = rs_value + imm_extended;
+    uint32_t loaded = 0;
+    
+    switch (instr.info->operation) {
+        // Arithmetic; the trapping forms halt on signed overflow without writing back
+        case MIPS::OP_ADD: {
+            ALU::Result result = ALU::execute(rs_value, rt_value, ALU::ADD);
+            if (result.overflow()) return false;
+            registers[instr.rd] = result.value;
+            break;
+        }
+        case MIPS::OP_ADDU:
+            registers[instr.rd] = rs_value + rt_value;
+            break;
+        case MIPS::OP_SUB: {
+            ALU::Result result = ALU::execute(rs_value, rt_value, ALU::SUB);
+            if (result.overflow()) return false;
+            registers[instr.rd] = result.value;
+            break;
         }
-    } else if (instr.type == "I") {
-        uint32_t imm_extended = signExtend16(instr.immediate);
+        case MIPS::OP_SUBU:
+            registers[instr.rd] = rs_value - rt_value;
+            break;
+        case MIPS::OP_ADDI: {
+            ALU::Result result = ALU::execute(rs_value, imm_extended, ALU::ADD);
+            if (result.overflow()) return false;
+            registers[instr.rt] = result.value;
+            break;
+        }
+        case MIPS::OP_ADDIU:
+            registers[instr.rt] = rs_value + imm_extended;
+            break;
         
-        switch (instr.opcode) {
-            case MIPS::OPCODE_ADDI:
-                registers[instr.rt] = registers[instr.rs] + imm_extended;
-                break;
-            case MIPS::OPCODE_LW:
-                if (isValidAddress(registers[instr.rs] + imm_extended)) {
-                    uint32_t addr = registers[instr.rs] + imm_extended;
-                    registers[instr.rt] = (memory[addr] << 24) | (memory[addr + 1] << 16) |
-                                         (memory[addr + 2] << 8) | memory[addr + 3];
-                }
-                break;
-            case MIPS::OPCODE_SW:
-                if (isValidAddress(registers[instr.rs] + imm_extended)) {
-                    uint32_t addr = registers[instr.rs] + imm_extended;
-                    memory[addr] = (registers[instr.rt] >> 24) & 0xFF;
-                    memory[addr + 1] = (registers[instr.rt] >> 16) & 0xFF;
-                    memory[addr + 2] = (registers[instr.rt] >> 8) & 0xFF;
-                    memory[addr + 3] = registers[instr.rt] & 0xFF;
-                }
-                break;
-            case MIPS::OPCODE_BEQ:
-                if (registers[instr.rs] == registers[instr.rt]) {
-                    next_pc = pc + 4 + (imm_extended << 2);
-                    branch_taken = true;
-                }
-                if (branch_prediction_enabled) {
-                    branch_stats.total_branches++;
-                    bool predicted = predictBranch(pc);
-                    if (predicted == branch_taken) {
-                        branch_stats.correct_predictions++;
-                    } else {
-                        branch_stats.incorrect_predictions++;
-                    }
-                    updateBranchPredictor(pc, branch_taken);
-                }
-                break;
-            case MIPS::OPCODE_BNE:
-                if (registers[instr.rs] != registers[instr.rt]) {
-                    next_pc = pc + 4 + (imm_extended << 2);
-                    branch_taken = true;
+        // Logic and comparison
+        case MIPS::OP_AND:
+            registers[instr.rd] = ALU::compute(rs_value, rt_value, ALU::AND);
+            break;
+        case MIPS::OP_OR:
+            registers[instr.rd] = ALU::compute(rs_value, rt_value, ALU::OR);
+            break;
+        case MIPS::OP_XOR:
+            registers[instr.rd] = ALU::compute(rs_value, rt_value, ALU::XOR);
+            break;
+        case MIPS::OP_NOR:
+            registers[instr.rd] = ALU::compute(rs_value, rt_value, ALU::NOR);
+            break;
+        case MIPS::OP_SLT:
+            registers[instr.rd] = ALU::compute(rs_value, rt_value, ALU::SLT);
+            break;
+        case MIPS::OP_SLTU:
+            registers[instr.rd] = ALU::compute(rs_value, rt_value, ALU::SLTU);
+            break;
+        case MIPS::OP_ANDI:
+            registers[instr.rt] = rs_value & instr.immediate;
+            break;
+        case MIPS::OP_ORI:
+            registers[instr.rt] = rs_value | instr.immediate;
+            break;
+        case MIPS::OP_XORI:
+            registers[instr.rt] = rs_value ^ instr.immediate;
+            break;
+        case MIPS::OP_SLTI:
+            registers[instr.rt] = ALU::compute(rs_value, imm_extended, ALU::SLT);
+            break;
+        case MIPS::OP_SLTIU:
+            registers[instr.rt] = ALU::compute(rs_value, imm_extended, ALU::SLTU);
+            break;
+        case MIPS::OP_LUI:
+            registers[instr.rt] = (uint32_t)instr.immediate << 16;
+            break;
+        
+        // Shifts
+        case MIPS::OP_SLL:
+            registers[instr.rd] = ALU::compute(rs_value, rt_value, instr.shamt, ALU::SLL);
+            break;
+        case MIPS::OP_SRL:
+            registers[instr.rd] = ALU::compute(rs_value, rt_value, instr.shamt, ALU::SRL);
+            break;
+        case MIPS::OP_SRA:
+            registers[instr.rd] = ALU::compute(rs_value, rt_value, instr.shamt, ALU::SRA);
+            break;
+        case MIPS::OP_SLLV:
+            registers[instr.rd] = ALU::compute(rs_value, rt_value, rs_value & 0x1F, ALU::SLL);
+            break;
+        case MIPS::OP_SRLV:
+            registers[instr.rd] = ALU::compute(rs_value, rt_value, rs_value & 0x1F, ALU::SRL);
+            break;
+        case MIPS::OP_SRAV:
+            registers[instr.rd] = ALU::compute(rs_value, rt_value, rs_value & 0x1F, ALU::SRA);
+            break;
+        
+        // Multiply and divide into HI/LO; division by zero leaves them unchanged
+        case MIPS::OP_MULT: {
+            int64_t product = (int64_t)(int32_t)rs_value * (int32_t)rt_value;
+            hi = (uint32_t)((uint64_t)product >> 32);
+            lo = (uint32_t)product;
+            break;
+        }
+        case MIPS::OP_MULTU: {
+            uint64_t product = (uint64_t)rs_value * rt_value;
+            hi = (uint32_t)(product >> 32);
+            lo = (uint32_t)product;
+            break;
+        }
+        case MIPS::OP_DIV:
+            if (rt_value != 0) {
+                if (rs_value == 0x80000000u && rt_value == 0xFFFFFFFFu) {
+                    lo = rs_value;
+                    hi = 0;
+                } else {
+                    lo = (uint32_t)((int32_t)rs_value / (int32_t)rt_value);
+                    hi = (uint32_t)((int32_t)rs_value % (int32_t)rt_value);
                 }
-                if (branch_prediction_enabled) {
-                    branch_stats.total_branches++;
-                    bool predicted = predictBranch(pc);
-                    if (predicted == branch_taken) {
-                        branch_stats.correct_predictions++;
-                    } else {
-                        branch_stats.incorrect_predictions++;
-                    }
-                    updateBranchPredictor(pc, branch_taken);
+            }
+            break;
+        case MIPS::OP_DIVU:
+            if (rt_value != 0) {
+                lo = rs_value / rt_value;
+                hi = rs_value % rt_value;
+            }
+            break;
+        case MIPS::OP_MFHI:
+            registers[instr.rd] = hi;
+            break;
+        case MIPS::OP_MTHI:
+            hi = rs_value;
+            break;
+        case MIPS::OP_MFLO:
+            registers[instr.rd] = lo;
+            break;
+        case MIPS::OP_MTLO:
+            lo = rs_value;
+            break;
+        
+        // Loads and stores; an access outside memory, or a halfword or word
+        // access that is not aligned to its size, is an address error
+        case MIPS::OP_LB:
+            if (!loadMemory(address, 1, loaded)) return addressError(address, 1, false);
+            registers[instr.rt] = (uint32_t)(int32_t)(int8_t)loaded;
+            break;
+        case MIPS::OP_LBU:
+            if (!loadMemory(address, 1, loaded)) return addressError(address, 1, false);
+            registers[instr.rt] = loaded;
+            break;
+        case MIPS::OP_LH:
+            if (!loadMemory(address, 2, loaded)) return addressError(address, 2, false);
+            registers[instr.rt] = (uint32_t)(int32_t)(int16_t)loaded;
+            break;
+        case MIPS::OP_LHU:
+            if (!loadMemory(address, 2, loaded)) return addressError(address, 2, false);
+            registers[instr.rt] = loaded;
+            break;
+        case MIPS::OP_LW:
+            if (!loadMemory(address, 4, loaded)) return addressError(address, 4, false);
+            registers[instr.rt] = loaded;
+            break;
+        case MIPS::OP_LWL: {
+            // Bytes from address to the end of its word fill rt from the top
+            if (!loadMemory(address & ~3u, 4, loaded)) return addressError(address, 1, false);
+            uint32_t shift = (address & 3) * 8;
+            uint32_t keep = shift == 0 ? 0 : (1u << shift) - 1;
+            registers[instr.rt] = (loaded << shift) | (rt_value & keep);
+            break;
+        }
+        case MIPS::OP_LWR: {
+            // Bytes from the start of the word to address fill rt from the bottom
+            if (!loadMemory(address & ~3u, 4, loaded)) return addressError(address, 1, false);
+            uint32_t shift = (3 - (address & 3)) * 8;
+            uint32_t keep = shift == 0 ? 0 : ~(0xFFFFFFFFu >> shift);
+            registers[instr.rt] = (loaded >> shift) | (rt_value & keep);
+            break;
+        }
+        case MIPS::OP_SB:
+            if (!storeMemory(address, 1, rt_value)) return addressError(address, 1, true);
+            break;
+        case MIPS::OP_SH:
+            if (!storeMemory(address, 2, rt_value)) return addressError(address, 2, true);
+            break;
+        case MIPS::OP_SW:
+            if (!storeMemory(address, 4, rt_value)) return addressError(address, 4, true);
+            break;
+        case MIPS::OP_SWL:
+            // The bytes stay inside address's word, so only the first can fail
+            for (uint32_t i = 0; i <= 3 - (address & 3); i++) {
+                if (!storeMemory(address + i, 1, rt_value >> (24 - 8 * i))) return addressError(address, 1, true);
+            }
+            break;
+        case MIPS::OP_SWR:
+            for (uint32_t i = 0; i <= (address & 3); i++) {
+                if (!storeMemory(address - i, 1, rt_value >> (8 * i))) return addressError(address, 1, true);
+            }
+            break;
+        
+        // Coprocessor 1
+        case MIPS::OP_FADD:
+        case MIPS::OP_FSUB:
+        case MIPS::OP_FMUL:
+        case MIPS::OP_FDIV:
+        case MIPS::OP_FSQRT:
+        case MIPS::OP_FABS:
+        case MIPS::OP_FMOV:
+        case MIPS::OP_FNEG:
+        case MIPS::OP_CVT_S:
+        case MIPS::OP_CVT_D:
+        case MIPS::OP_CVT_W:
+        case MIPS::OP_FCMP:
+            fpu.execute(instr.raw, instr.info->operation);
+            fpu_used = true;
+            break;
+        case MIPS::OP_MFC1:
+            registers[instr.rt] = fpu.getRegister(instr.rd);
+            fpu_used = true;
+            break;
+        case MIPS::OP_MTC1:
+            fpu.setRegister(instr.rd, rt_value);
+            fpu_used = true;
+            break;
+        case MIPS::OP_CFC1:
+            registers[instr.rt] = fpu.readControl(instr.rd);
+            fpu_used = true;
+            break;
+        case MIPS::OP_CTC1:
+            fpu.writeControl(instr.rd, rt_value);
+            fpu_used = true;
+            break;
+        case MIPS::OP_LWC1:
+            if (!loadMemory(address, 4, loaded)) return addressError(address, 4, false);
+            fpu.setRegister(instr.rt, loaded);
+            fpu_used = true;
+            break;
+        case MIPS::OP_LDC1: {
+            // Big-endian doubleword: the high word is at the lower address
+            uint32_t low = 0;
+            if ((address & 7) != 0 || !loadMemory(address, 4, loaded) || !loadMemory(address + 4, 4, low)) {
+                return addressError(address, 8, false);
+            }
+            fpu.setDoubleBits(instr.rt, ((uint64_t)loaded << 32) | low);
+            fpu_used = true;
+            break;
+        }
+        case MIPS::OP_SWC1:
+            if (!storeMemory(address, 4, fpu.getRegister(instr.rt))) return addressError(address, 4, true);
+            fpu_used = true;
+            break;
+        case MIPS::OP_SDC1: {
+            // An aligned doubleword that starts in memory ends in it
+            uint64_t bits = fpu.getDoubleBits(instr.rt);
+            if ((address & 7) != 0 || !storeMemory(address, 4, (uint32_t)(bits >> 32))) {
+                return addressError(address, 8, true);
+            }
+            storeMemory(address + 4, 4, (uint32_t)bits);
+            fpu_used = true;
+            break;
+        }
+        
+        // Conditional branches resolve below
+        case MIPS::OP_BC1F:
+            branch_kind = BranchTargetPredictor::KIND_CONDITIONAL;
+            branch_taken = !fpu.getCondition();
+            break;
+        case MIPS::OP_BC1T:
+            branch_kind = BranchTargetPredictor::KIND_CONDITIONAL;
+            branch_taken = fpu.getCondition();
+            break;
+        case MIPS::OP_BEQ:
+            branch_kind = BranchTargetPredictor::KIND_CONDITIONAL;
+            branch_taken = rs_value == rt_value;
+            break;
+        case MIPS::OP_BNE:
+            branch_kind = BranchTargetPredictor::KIND_CONDITIONAL;
+            branch_taken = rs_value != rt_value;
+            break;
+        case MIPS::OP_BLEZ:
+            branch_kind = BranchTargetPredictor::KIND_CONDITIONAL;
+            branch_taken = (int32_t)rs_value <= 0;
+            break;
+        case MIPS::OP_BGTZ:
+            branch_kind = BranchTargetPredictor::KIND_CONDITIONAL;
+            branch_taken = (int32_t)rs_value > 0;
+            break;
+        case MIPS::OP_BLTZ:
+            branch_kind = BranchTargetPredictor::KIND_CONDITIONAL;
+            branch_taken = (int32_t)rs_value < 0;
+            break;
+        case MIPS::OP_BGEZ:
+            branch_kind = BranchTargetPredictor::KIND_CONDITIONAL;
+            branch_taken = (int32_t)rs_value >= 0;
+            break;
+        case MIPS::OP_BLTZAL:
+            branch_kind = BranchTargetPredictor::KIND_CONDITIONAL;
+            branch_taken = (int32_t)rs_value < 0;
+            registers[31] = pc + 8;
+            break;
+        case MIPS::OP_BGEZAL:
+            branch_kind = BranchTargetPredictor::KIND_CONDITIONAL;
+            branch_taken = (int32_t)rs_value >= 0;
+            registers[31] = pc + 8;
+            break;
+        
+        // Jumps
+        case MIPS::OP_J:
+            next_pc = (pc & 0xF0000000) | (instr.jump_addr << 2);
+            branch_taken = true;
+            branch_kind = BranchTargetPredictor::KIND_JUMP;
+            break;
+        case MIPS::OP_JAL:
+            registers[31] = pc + 8; // Return address
+            next_pc = (pc & 0xF0000000) | (instr.jump_addr << 2);
+            branch_taken = true;
+            branch_kind = BranchTargetPredictor::KIND_CALL;
+            break;
+        case MIPS::OP_JR:
+            next_pc = rs_value;
+            branch_taken = true;
+            branch_kind = (instr.rs == MIPS::REG_RA) ? BranchTargetPredictor::KIND_RETURN
+                                                     : BranchTargetPredictor::KIND_INDIRECT;
+            break;
+        case MIPS::OP_JALR:
+            registers[instr.rd] = pc + 8;
+            next_pc = rs_value;
+            branch_taken = true;
+            branch_kind = BranchTargetPredictor::KIND_CALL;
+            break;
+        
+        // SYSCALL exit services and BREAK end the program; they still count
+        // as executed
+        case MIPS::OP_SYSCALL:
+            if (registers[MIPS::REG_V0] == MIPS::SYSCALL_EXIT ||
+                registers[MIPS::REG_V0] == MIPS::SYSCALL_EXIT2) {
+                perf.class_counts[instr.perf_class]++;
+                return false;
+            }
+            break;
+        case MIPS::OP_BREAK:
+            perf.class_counts[instr.perf_class]++;
+            return false;
+        
+        // Also reached by breakpoint traps, which stop before executing
+        case MIPS::OP_INVALID:
+            if (instr.info == &TRAP_INFO) {
+                if (pc == resume_pc || stops_suspended || !breakpointStops(pc)) {
+                    resume_pc = ~0u;
+                    return executeInstruction<Policy>(decodeInstruction(instr.raw));
                 }
-                break;
+                stop_reason = STOP_BREAKPOINT;
+                return false;
+            }
+            break;
+    }
+    
+    if (branch_kind != BranchTargetPredictor::KIND_NONE) {
+        uint32_t target = pc + 4 + (imm_extended << 2);
+        if (branch_kind == BranchTargetPredictor::KIND_CONDITIONAL && branch_taken) {
+            next_pc = target;
         }
-    } else if (instr.type == "J") {
-        switch (instr.opcode) {
-            case MIPS::OPCODE_J:
-                next_pc = (pc & 0xF0000000) | (instr.jump_addr << 2);
-                break;
-            case MIPS::OPCODE_JAL:
-                registers[31] = pc + 8; // Return address
-                next_pc = (pc & 0xF0000000) | (instr.jump_addr << 2);
-                break;
+        retireBranch<Policy>(pc, branch_kind, branch_taken, target, next_pc);
+    }
+    
+    if (trace_writer != nullptr) {
+        traceRetired(instr, pc, address, next_pc);
+    }
+    if (profiler != nullptr) {
+        profileRetired(pc, branch_kind, next_pc);
+    }
+    perf.class_counts[instr.perf_class]++;
+    if (caches_enabled) {
+        accessCaches(instr, pc, address);
+    }
+    pc = next_pc;
+    return true;
+}
+
+// Execute a fused pair in one dispatch. Prediction, profiling and tracing
+// still see both instructions at their own PCs, so the statistics match
+// unfused execution.
+template <typename Policy>
+bool MIPSSimulator::executeFused(const Instruction& first) {
+    HOST_PHASE(PHASE_EXECUTE);
+    uint32_t first_pc = pc;
+    uint32_t predicted_pc = predictNextPC<Policy>(first_pc);
+    uint32_t rs_value = registers[first.rs];
+    uint32_t imm_extended = signExtend16(first.immediate);
+    switch (first.info->operation) {
+        case MIPS::OP_LUI:
+            if (trace_writer != nullptr) {
+                // Trace the value lui alone produces
+                registers[first.rt] = first.fused_value & 0xFFFF0000;
+                traceRetired(first, first_pc, 0, first_pc + 4);
+            }
+            registers[first.rt] = first.fused_value;
+            break;
+        case MIPS::OP_SLT:
+            registers[first.rd] = ALU::compute(rs_value, registers[first.rt], ALU::SLT);
+            break;
+        case MIPS::OP_SLTU:
+            registers[first.rd] = ALU::compute(rs_value, registers[first.rt], ALU::SLTU);
+            break;
+        case MIPS::OP_SLTI:
+            registers[first.rt] = ALU::compute(rs_value, imm_extended, ALU::SLT);
+            break;
+        case MIPS::OP_SLTIU:
+            registers[first.rt] = ALU::compute(rs_value, imm_extended, ALU::SLTU);
+            break;
+        case MIPS::OP_ADDI: {
+            ALU::Result result = ALU::execute(rs_value, imm_extended, ALU::ADD);
+            if (result.overflow()) return false;
+            registers[first.rt] = result.value;
+            break;
+        }
+        case MIPS::OP_ADDIU:
+            registers[first.rt] = rs_value + imm_extended;
+            break;
+        default:
+            break;
+    }
+    if (predicted_pc != first_pc + 4) {
+        recordRedirect(first_pc);
+    }
+    if (trace_writer != nullptr && first.fusion != FUSE_LUI_ORI) {
+        traceRetired(first, first_pc, 0, first_pc + 4);
+    }
+    if (profiler != nullptr) {
+        profileRetired(first_pc, BranchTargetPredictor::KIND_NONE, first_pc + 4);
+    }
+    perf.class_counts[first.perf_class]++;
+    if (caches_enabled) {
+        accessCaches(first, first_pc, 0);
+    }
+    
+    uint32_t second_pc = first_pc + 4;
+    predicted_pc = predictNextPC<Policy>(second_pc);
+    uint32_t next_pc = second_pc + 4;
+    // The second word was checked when the pair was fused
+    const Instruction& second = fetchDecoded(second_pc);
+    if (first.fusion != FUSE_LUI_ORI) {
+        const Instruction& branch = second;
+        bool taken = (registers[branch.rs] == registers[branch.rt]) == (branch.info->operation == MIPS::OP_BEQ);
+        uint32_t target = next_pc + (signExtend16(branch.immediate) << 2);
+        if (taken) {
+            next_pc = target;
         }
+        retireBranch<Policy>(second_pc, BranchTargetPredictor::KIND_CONDITIONAL, taken, target, next_pc);
+    }
+    if (trace_writer != nullptr) {
+        traceRetired(second, second_pc, 0, next_pc);
+    }
+    if (profiler != nullptr) {
+        profileRetired(second_pc, BranchTargetPredictor::KIND_CONDITIONAL, next_pc);
+    }
+    perf.class_counts[second.perf_class]++;
+    if (caches_enabled) {
+        accessCaches(second, second_pc, 0);
     }
     
     pc = next_pc;
+    if (pc != predicted_pc) {
+        recordRedirect(second_pc);
+    }
     return true;
 }
 
+// Profile entry of a branch, copied into the newest checkpoint before its
+// first update since then
+MIPSSimulator::BranchProfileEntry& MIPSSimulator::profileEntry(uint32_t branch_pc) {
+    uint32_t index = branch_pc >> 2;
+    if (history_enabled && !profile_saved[index / PROFILE_BLOCK]) {
+        saveProfileBlock(index / PROFILE_BLOCK);
+    }
+    return branch_profile[index];
+}
+
+// Predictor training, per-branch profile and trace for a retired control transfer
+template <typename Policy>
+void MIPSSimulator::retireBranch(uint32_t branch_pc, BranchTargetPredictor::BranchKind kind,
+                                 bool taken, uint32_t target, uint32_t next_pc) {
+    HOST_PHASE(PHASE_PREDICTOR);
+    bool conditional = kind == BranchTargetPredictor::KIND_CONDITIONAL;
+    if constexpr (Policy::enabled) {
+        if (conditional) {
+            branch_predictor.resolveWith<Policy>(branch_pc, taken, target);
+        }
+        target_predictor.update(branch_pc, kind, taken, next_pc);
+    }
+    
+    BranchProfileEntry& profile = profileEntry(branch_pc);
+    profile.executions++;
+    if (taken) profile.taken++;
+    if (conditional && taken) perf.taken_branches++;
+    
+    if (branch_trace != nullptr && conditional) {
+        branch_trace->push_back({branch_pc | (taken ? 1u : 0u), target});
+    }
+}
+
 uint32_t MIPSSimulator::signExtend16(uint16_t value) {
     if (value & 0x8000) {
         return value | 0xFFFF0000;
@@ -256,67 +1052,226 @@ bool MIPSSimulator::isValidAddress(uint32_t address) const {
     return address < memory.size() - 3;
 }
 
-void MIPSSimulator::initializePipeline() {
-    pipeline_stages.resize(5);
-    for (auto& stage : pipeline_stages) {
-        stage.instruction = 0;
-        stage.pc = 0;
-        stage.valid = false;
-        stage.stall = false;
-        stage.flush = false;
+bool MIPSSimulator::isValidFetchAddress(uint32_t address) const {
+    return (address & 3) == 0 && isValidAddress(address);
+}
+
+bool MIPSSimulator::loadMemory(uint32_t address, uint32_t size, uint32_t& value) {
+    HOST_PHASE(PHASE_MEMORY);
+    if (address >= memory.size() || memory.size() - address < size || (address & (size - 1)) != 0) {
+        return false;
+    }
+    value = 0;
+    for (uint32_t i = 0; i < size; i++) {
+        value = (value << 8) | memory[address + i];
+    }
+    if (page_watch[address / PAGE_SIZE] & WATCH_READ) {
+        const Watchpoint* watch = findWatchpoint(address, size, WATCH_READ);
+        if (watch) {
+            watchTriggered(*watch, address, false, watchedValue(*watch));
+        }
+    }
+    return true;
+}
+
+bool MIPSSimulator::addressError(uint32_t address, uint32_t size, bool write) {
+    address_error = {pc, address, size, write};
+    stop_reason = STOP_ADDRESS_ERROR;
+    return false;
+}
+
+bool MIPSSimulator::storeMemory(uint32_t address, uint32_t size, uint32_t value) {
+    HOST_PHASE(PHASE_MEMORY);
+    if (address >= memory.size() || memory.size() - address < size || (address & (size - 1)) != 0) {
+        return false;
+    }
+    if (history_enabled) {
+        uint32_t first = address / PAGE_SIZE, last = (address + size - 1) / PAGE_SIZE;
+        if (!page_saved[first]) savePage(first);
+        if (!page_saved[last]) savePage(last);
+    }
+    const Watchpoint* watch = nullptr;
+    uint32_t old_value = 0;
+    if (page_watch[address / PAGE_SIZE] & WATCH_WRITE) {
+        watch = findWatchpoint(address, size, WATCH_WRITE);
+        if (watch) old_value = watchedValue(*watch);
+    }
+    for (uint32_t i = 0; i < size; i++) {
+        memory[address + i] = (value >> (8 * (size - 1 - i))) & 0xFF;
     }
+    invalidateDecoded(address, size);
+    if (watch) {
+        watchTriggered(*watch, address, true, old_value);
+    }
+    return true;
+}
+
+void MIPSSimulator::initializePipeline() {
+    pipeline.reset();
+    fetch_pc = pc;
+    redirect_stall = 0;
+    pipeline_stats = {0, 0, 0, 0, 0, 0};
+    scoreboard.reset();
+    scoreboard_before_issue = scoreboard.getState();
 }
 
+template <typename Policy>
 void MIPSSimulator::advancePipeline() {
-    // Handle hazards
-    if (detectHazards()) {
+    HOST_PHASE(PHASE_PIPELINE);
+    Pipeline::PipelineRegister& latches = pipeline.getRegisters();
+    pipeline_stats.cycles++;
+    perf.cycles++;
+    
+    // Load-use hazard: hold the instruction in ID for one cycle
+    StallCause stall = detectHazards();
+    if (stall) {
         handleHazards();
-        return;
+    }
+    if (profiler != nullptr) {
+        profiler->recordCycle();
+        if (stall) profiler->recordStall(latches.if_id_pc, 1);
     }
     
-    // Advance pipeline stages
-    for (int i = 4; i >= 1; i--) {
-        pipeline_stages[i] = pipeline_stages[i - 1];
+    pipeline.advance();
+    if (latches.wb_valid) {
+        pipeline_stats.instructions++;
+        if (profiler != nullptr) profiler->recordRetire(latches.wb_pc);
     }
+    bool issued = !stall && issueUnits();
     
-    // Fetch new instruction
-    if (!halted && isValidAddress(pc)) {
-        uint32_t instruction = (memory[pc] << 24) | (memory[pc + 1] << 16) | 
-                              (memory[pc + 2] << 8) | memory[pc + 3];
-        pipeline_stages[0].instruction = instruction;
-        pipeline_stages[0].pc = pc;
-        pipeline_stages[0].valid = true;
-        pc += 4;
-    } else {
-        pipeline_stages[0].valid = false;
+    // Fetch along the predicted path, unless still paying for a redirect
+    bool refilling = false;
+    if (!stall && !halted) {
+        if (redirect_stall > 0) {
+            redirect_stall--;
+            refilling = true;
+            pipeline_stats.stall_cycles++;
+            perf.redirect_stalls++;
+        } else {
+            fetchInstruction<Policy>();
+        }
+    }
+    if (timeline_writer != nullptr) {
+        timeline_writer->recordCycle(latches, stall != STALL_NONE);
+        if (stall || refilling) timeline_writer->recordStall(STALL_NAMES[refilling ? 4 : stall]);
+    }
+    
+    // The instruction that completed EX resolves its real successor
+    if (latches.ex_mem_valid) {
+        pc = latches.ex_mem_pc;
+        Instruction instr = decodeInstruction(latches.ex_mem_instruction);
+        if (!executeInstruction<Policy>(instr)) {
+            // The older instruction in MEM/WB would still retire, and so
+            // would a SYSCALL or BREAK that ends the program; count them so
+            // the total matches the counters
+            bool completed = stop_reason == STOP_NONE;
+            pipeline_stats.instructions += latches.mem_wb_valid + completed;
+            if (profiler != nullptr) {
+                if (latches.mem_wb_valid) profiler->recordRetire(latches.mem_wb_pc);
+                if (completed) profiler->recordRetire(latches.ex_mem_pc);
+            }
+            halted = true;
+            return;
+        }
+        
+        if (pc != latches.ex_mem_predicted_pc) {
+            // Squash the wrong-path instructions in IF/ID and ID/EX
+            pipeline.flush();
+            if (issued) {
+                // The operation that just entered ID/EX was on the wrong path
+                scoreboard.setState(scoreboard_before_issue);
+            }
+            fetch_pc = pc;
+            redirect_stall = mispredict_penalty;
+            pipeline_stats.flushes++;
+            recordRedirect(latches.ex_mem_pc);
+            if (profiler != nullptr) profiler->recordStall(latches.ex_mem_pc, 2 + mispredict_penalty);
+            if (timeline_writer != nullptr) timeline_writer->recordFlush(latches.ex_mem_pc, 2 + mispredict_penalty);
+        }
+    }
+    
+    bool drained = !latches.if_id_valid && !latches.id_ex_valid &&
+                   !latches.ex_mem_valid && !latches.mem_wb_valid;
+    if (drained && !isValidFetchAddress(fetch_pc)) {
+        halted = true;
     }
 }
 
-bool MIPSSimulator::detectHazards() {
-    // Simplified hazard detection
-    if (!pipeline_stages[1].valid || !pipeline_stages[2].valid) {
-        return false;
+template <typename Policy>
+void MIPSSimulator::fetchInstruction() {
+    HOST_PHASE(PHASE_FETCH);
+    if (!isValidFetchAddress(fetch_pc)) {
+        return;
     }
     
-    Instruction id_instr = decodeInstruction(pipeline_stages[1].instruction);
-    Instruction ex_instr = decodeInstruction(pipeline_stages[2].instruction);
+    Pipeline::PipelineRegister& latches = pipeline.getRegisters();
+    latches.if_id_pc = fetch_pc;
+    latches.if_id_instruction = (memory[fetch_pc] << 24) | (memory[fetch_pc + 1] << 16) |
+                                (memory[fetch_pc + 2] << 8) | memory[fetch_pc + 3];
+    // Older copies of this branch still in ID/EX or EX/MEM have not trained
+    // the predictor yet (tight loops)
+    uint32_t in_flight = (latches.id_ex_valid && latches.id_ex_pc == fetch_pc) +
+                         (latches.ex_mem_valid && latches.ex_mem_pc == fetch_pc);
+    latches.if_id_predicted_pc = predictNextPC<Policy>(fetch_pc, in_flight);
+    latches.if_id_valid = true;
     
-    // Data hazard: RAW (Read After Write)
-    if (ex_instr.type == "R" || (ex_instr.type == "I" && ex_instr.opcode == MIPS::OPCODE_LW)) {
-        uint8_t dest_reg = (ex_instr.type == "R") ? ex_instr.rd : ex_instr.rt;
-        if (dest_reg != 0 && (dest_reg == id_instr.rs || dest_reg == id_instr.rt)) {
-            return true;
-        }
+    fetch_pc = latches.if_id_predicted_pc;
+}
+
+MIPSSimulator::StallCause MIPSSimulator::detectHazards() {
+    if (pipeline.detectLoadUseHazard()) {
+        perf.load_use_stalls++;
+        return STALL_LOAD_USE;
     }
-    
-    return false;
+    if (detectMulDivHazard()) {
+        pipeline_stats.hilo_stalls++;
+        perf.hilo_stalls++;
+        return STALL_HILO;
+    }
+    if (detectFPHazard()) {
+        pipeline_stats.fp_stalls++;
+        perf.fp_stalls++;
+        return STALL_FP;
+    }
+    return STALL_NONE;
+}
+
+// Instruction in IF/ID would move to ID/EX this cycle and execute next cycle
+bool MIPSSimulator::detectMulDivHazard() const {
+    const Pipeline::PipelineRegister& latches = pipeline.getRegisters();
+    return latches.if_id_valid &&
+           pipeline_stats.cycles < scoreboard.mulDivReadyCycle(InstructionDecoder::info(latches.if_id_instruction));
+}
+
+bool MIPSSimulator::detectFPHazard() const {
+    const Pipeline::PipelineRegister& latches = pipeline.getRegisters();
+    if (!latches.if_id_valid) {
+        return false;
+    }
+    uint32_t instruction = latches.if_id_instruction;
+    return pipeline_stats.cycles < scoreboard.fpReadyCycle(instruction, InstructionDecoder::info(instruction));
+}
+
+// Reserve the units of a multiply, divide or FPU operation that just
+// entered ID/EX
+bool MIPSSimulator::issueUnits() {
+    const Pipeline::PipelineRegister& latches = pipeline.getRegisters();
+    if (!latches.id_ex_valid) {
+        return false;
+    }
+    const MIPS::InstructionInfo& info = InstructionDecoder::info(latches.id_ex_instruction);
+    if (!HazardScoreboard::startsUnit(info)) {
+        return false;
+    }
+    scoreboard_before_issue = scoreboard.getState();
+    scoreboard.issue(latches.id_ex_instruction, info, pipeline_stats.cycles);
+    return true;
 }
 
 void MIPSSimulator::handleHazards() {
     // Insert pipeline stall
-    for (int i = 1; i < 5; i++) {
-        pipeline_stages[i].stall = true;
-    }
+    pipeline.requestStall(Pipeline::ID);
+    pipeline_stats.stall_cycles++;
 }
 
 // Getter and setter methods
@@ -327,6 +1282,7 @@ uint32_t MIPSSimulator::getRegister(int reg) const {
 
 void MIPSSimulator::setRegister(int reg, uint32_t value) {
     if (reg >= 1 && reg < 32) registers[reg] = value;
+    if (history_enabled) restartHistory();
 }
 
 uint32_t MIPSSimulator::getMemory(uint32_t address) const {
@@ -343,41 +1299,865 @@ void MIPSSimulator::setMemory(uint32_t address, uint32_t value) {
         memory[address + 1] = (value >> 16) & 0xFF;
         memory[address + 2] = (value >> 8) & 0xFF;
         memory[address + 3] = value & 0xFF;
+        invalidateDecoded(address, 4);
+        if (history_enabled) restartHistory();
     }
 }
 
-uint32_t MIPSSimulator::getPC() const { return pc; }
-void MIPSSimulator::setPC(uint32_t new_pc) { pc = new_pc; }
-bool MIPSSimulator::isHalted() const { return halted; }
-void MIPSSimulator::setStepMode(bool mode) { step_mode = mode; }
-bool MIPSSimulator::getStepMode() const { return step_mode; }
+void MIPSSimulator::recordRedirect(uint32_t branch_pc) {
+    HOST_PHASE(PHASE_PREDICTOR);
+    BranchProfileEntry& profile = profileEntry(branch_pc);
+    profile.mispredicts++;
+    branch_stats.fetch_redirects++;
+    perf.mispredicts++;
+    
+    // IF/ID and ID/EX are squashed, plus the configured refill penalty
+    if (pipeline_enabled) {
+        uint64_t lost = 2 + mispredict_penalty;
+        profile.cycles_lost += lost;
+        branch_stats.cycles_lost += lost;
+    }
+}
 
-void MIPSSimulator::enablePipeline(bool enable) {
-    pipeline_enabled = enable;
-    if (enable) initializePipeline();
+void MIPSSimulator::resetBranchStats() {
+    branch_stats = {0, 0};
+    branch_profile.assign(memory.size() / 4, {0, 0, 0, 0});
 }
 
-void MIPSSimulator::enableBranchPrediction(bool enable, const std::string& type) {
+void MIPSSimulator::setMispredictPenalty(int cycles) {
+    mispredict_penalty = cycles > 0 ? cycles : 0;
+}
+
+int MIPSSimulator::getMispredictPenalty() const {
+    return mispredict_penalty;
+}
+
+std::string MIPSSimulator::disassembleRange(uint32_t start, uint32_t end, unsigned threads) const {
+    start &= ~3u;
+    if (!isValidAddress(start) || end < start) {
+        return "";
+    }
+    size_t last = std::min<size_t>(end & ~3u, memory.size() - 4);
+    return InstructionDecoder::disassembleImage(&memory[start], last - start + 4, start, threads);
+}
+
+std::string MIPSSimulator::getBranchProfileString(int top_n) const {
+    HOST_PHASE(PHASE_FORMAT);
+    std::vector<uint32_t> branches;
+    for (uint32_t i = 0; i < branch_profile.size(); i++) {
+        if (branch_profile[i].executions > 0) branches.push_back(i);
+    }
+    
+    size_t count = std::min(branches.size(), (size_t)std::max(top_n, 0));
+    std::partial_sort(branches.begin(), branches.begin() + count, branches.end(),
+                      [this](uint32_t a, uint32_t b) {
+        const BranchProfileEntry& x = branch_profile[a];
+        const BranchProfileEntry& y = branch_profile[b];
+        if (x.mispredicts != y.mispredicts) return x.mispredicts > y.mispredicts;
+        return x.executions > y.executions;
+    });
+    
+    std::ostringstream oss;
+    oss << "Top " << count << " Branches by Mispredictions:\n";
+    oss << std::left << std::setw(10) << "PC" << std::right
+        << std::setw(8) << "Execs" << std::setw(11) << "Taken%"
+        << std::setw(10) << "Mispred" << std::setw(10) << "Cycles" << "  Instruction\n";
+    for (size_t i = 0; i < count; i++) {
+        uint32_t branch_pc = branches[i] << 2;
+        const BranchProfileEntry& profile = branch_profile[branches[i]];
+        double taken_rate = (double)profile.taken / profile.executions * 100.0;
+        char text[InstructionDecoder::MAX_DISASSEMBLY_LENGTH];
+        InstructionDecoder::disassemble(getMemory(branch_pc), text);
+        
+        oss << "0x" << std::hex << std::setw(8) << std::setfill('0') << branch_pc
+            << std::dec << std::setfill(' ')
+            << std::setw(8) << profile.executions
+            << std::setw(10) << std::fixed << std::setprecision(1) << taken_rate << "%"
+            << std::setw(10) << profile.mispredicts
+            << std::setw(10) << profile.cycles_lost
+            << "  " << text << "\n";
+    }
+    return oss.str();
+}
+
+void MIPSSimulator::setMulDivLatency(int multiply_cycles, int divide_cycles) {
+    scoreboard.setMulDivLatency(multiply_cycles, divide_cycles);
+}
+
+void MIPSSimulator::setMulDivPipelined(bool pipelined) {
+    scoreboard.setMulDivPipelined(pipelined);
+}
+
+bool MIPSSimulator::setFPLatency(const std::string& name, int cycles) {
+    return scoreboard.setFPLatency(name, cycles);
+}
+
+void MIPSSimulator::setBranchTrace(std::vector<BranchPredictor::BranchRecord>* trace) {
+    branch_trace = trace;
+}
+
+uint32_t MIPSSimulator::getPC() const { return pc; }
+uint32_t MIPSSimulator::getHI() const { return hi; }
+uint32_t MIPSSimulator::getLO() const { return lo; }
+FPU& MIPSSimulator::getFPU() { return fpu; }
+const FPU& MIPSSimulator::getFPU() const { return fpu; }
+void MIPSSimulator::setPC(uint32_t new_pc) {
+    pc = new_pc;
+    if (history_enabled) restartHistory();
+}
+bool MIPSSimulator::isHalted() const { return halted; }
+void MIPSSimulator::setStepMode(bool mode) { step_mode = mode; }
+bool MIPSSimulator::getStepMode() const { return step_mode; }
+
+void MIPSSimulator::enablePipeline(bool enable) {
+    pipeline_enabled = enable;
+    if (enable) {
+        initializePipeline();
+        enableReverseExecution(false);
+    } else {
+        stopTimeline();
+    }
+    if (profiler != nullptr) {
+        profiler->reset(pc, pipeline_enabled);
+    }
+    resetPerfCounters();
+}
+
+bool MIPSSimulator::enableBranchPrediction(bool enable, const std::string& type) {
+    BranchPredictor::PredictorType predictor_type = BranchPredictor::STATIC_NOT_TAKEN;
+    if (enable && !BranchPredictor::parseType(type, predictor_type)) {
+        return false;
+    }
+    
     branch_prediction_enabled = enable;
-    prediction_type = type;
+    branch_predictor.setPredictorType(predictor_type);
+    target_predictor.reset();
+    resetBranchStats();
+    selectStepFunction();
+    if (history_enabled) restartHistory();
+    return true;
+}
+
+void MIPSSimulator::enableLoopPredictor(bool enable) {
+    branch_predictor.enableLoopPredictor(enable);
+    resetBranchStats();
+    if (history_enabled) restartHistory();
 }
 
-bool MIPSSimulator::predictBranch(uint32_t pc) {
-    if (prediction_type == "static") {
-        return false; // Static not-taken
-    } else if (prediction_type == "dynamic") {
-        return branch_history_table[pc];
+void MIPSSimulator::selectStepFunction() {
+    if (!branch_prediction_enabled) {
+        useStepFunctions<BranchPolicy::Disabled>();
+        return;
+    }
+    
+    switch (branch_predictor.getPredictorType()) {
+        case BranchPredictor::STATIC_NOT_TAKEN:
+            useStepFunctions<BranchPolicy::StaticNotTaken>();
+            break;
+        case BranchPredictor::STATIC_TAKEN:
+            useStepFunctions<BranchPolicy::StaticTaken>();
+            break;
+        case BranchPredictor::DYNAMIC_1BIT:
+            useStepFunctions<BranchPolicy::OneBit>();
+            break;
+        case BranchPredictor::DYNAMIC_2BIT:
+            useStepFunctions<BranchPolicy::TwoBit>();
+            break;
+        case BranchPredictor::GSHARE:
+            useStepFunctions<BranchPolicy::Gshare>();
+            break;
+    }
+}
+
+bool MIPSSimulator::startTrace(const std::string& filename) {
+    stopTrace();
+    std::unique_ptr<TraceWriter> writer(new TraceWriter());
+    if (!writer->open(filename)) {
+        return false;
+    }
+    trace_writer = std::move(writer);
+    return true;
+}
+
+bool MIPSSimulator::stopTrace() {
+    if (trace_writer == nullptr) {
+        return true;
+    }
+    bool ok = trace_writer->close();
+    trace_records = trace_writer->getRecordCount();
+    trace_bytes = trace_writer->getByteCount();
+    trace_writer.reset();
+    return ok;
+}
+
+bool MIPSSimulator::startTimeline(const std::string& filename) {
+    stopTimeline();
+    if (!pipeline_enabled) {
+        return false;
+    }
+    std::unique_ptr<TimelineWriter> writer(new TimelineWriter());
+    if (!writer->open(filename)) {
+        return false;
+    }
+    timeline_writer = std::move(writer);
+    return true;
+}
+
+bool MIPSSimulator::stopTimeline() {
+    if (timeline_writer == nullptr) {
+        return true;
+    }
+    bool ok = timeline_writer->close();
+    timeline_events = timeline_writer->getEventCount();
+    timeline_writer.reset();
+    return ok;
+}
+
+bool MIPSSimulator::isRecordingTimeline() const {
+    return timeline_writer != nullptr;
+}
+
+uint64_t MIPSSimulator::getTimelineEventCount() const {
+    return timeline_writer != nullptr ? timeline_writer->getEventCount() : timeline_events;
+}
+
+void MIPSSimulator::enableProfiling(bool enable) {
+    if (!enable) {
+        profiler.reset();
+    } else if (profiler == nullptr) {
+        profiler = std::make_unique<Profiler>(memory.size(), pipeline_enabled);
+        profiler->reset(pc, pipeline_enabled);
+    }
+}
+
+bool MIPSSimulator::isProfiling() const {
+    return profiler != nullptr;
+}
+
+std::string MIPSSimulator::getProfileString(int top_n) const {
+    HOST_PHASE(PHASE_FORMAT);
+    if (profiler == nullptr) {
+        return "Profiling is off.\n";
+    }
+    return profiler->getReportString(memory.data(), memory.size(), top_n);
+}
+
+bool MIPSSimulator::writeCollapsedStacks(const std::string& filename) const {
+    return profiler != nullptr && profiler->writeCollapsedStacks(filename);
+}
+
+MIPSSimulator::PerfCounters MIPSSimulator::getPerfCounters() const {
+    PerfCounters counters = perf;
+    counters.instructions = 0;
+    for (int i = 0; i < CLASS_COUNT; i++) {
+        counters.instructions += perf.class_counts[i];
+    }
+    counters.loads = perf.class_counts[CLASS_LOAD];
+    counters.stores = perf.class_counts[CLASS_STORE];
+    counters.branches = perf.class_counts[CLASS_BRANCH];
+    counters.jumps = perf.class_counts[CLASS_JUMP];
+    counters.stall_cycles = perf.load_use_stalls + perf.hilo_stalls + perf.fp_stalls + perf.redirect_stalls;
+    if (!pipeline_enabled) {
+        counters.cycles = counters.instructions;
+    }
+    return counters;
+}
+
+void MIPSSimulator::resetPerfCounters() {
+    perf = PerfCounters();
+}
+
+const char* MIPSSimulator::getClassName(InstructionClass instruction_class) {
+    static const char* const NAMES[CLASS_COUNT] = {"alu", "muldiv", "load", "store", "branch", "jump", "fp", "system"};
+    return instruction_class < CLASS_COUNT ? NAMES[instruction_class] : "unknown";
+}
+
+std::string MIPSSimulator::getPerfCountersString() const {
+    HOST_PHASE(PHASE_FORMAT);
+    PerfCounters counters = getPerfCounters();
+    auto percent = [](uint64_t part, uint64_t whole) { return whole > 0 ? 100.0 * part / whole : 0.0; };
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(2);
+    oss << "Performance Counters:\n";
+    oss << "Cycles: " << counters.cycles << ", Instructions: " << counters.instructions;
+    if (counters.instructions > 0) {
+        oss << ", CPI: " << (double)counters.cycles / counters.instructions;
+    }
+    oss << "\n";
+    oss << "Loads: " << counters.loads << ", Stores: " << counters.stores << "\n";
+    oss << "Branches: " << counters.branches << " (" << counters.taken_branches << " taken, "
+        << percent(counters.taken_branches, counters.branches) << "%), Jumps: " << counters.jumps
+        << ", Mispredicts: " << counters.mispredicts << "\n";
+    oss << "Stall Cycles: " << counters.stall_cycles << " (load-use " << counters.load_use_stalls
+        << ", HI/LO " << counters.hilo_stalls << ", FP " << counters.fp_stalls
+        << ", redirect " << counters.redirect_stalls << ")\n";
+    if (instruction_cache.isEnabled()) {
+        oss << "I-Cache Accesses: " << counters.icache_accesses << ", Misses: " << counters.icache_misses
+            << " (" << percent(counters.icache_misses, counters.icache_accesses) << "%)\n";
+    }
+    if (data_cache.isEnabled()) {
+        oss << "D-Cache Accesses: " << counters.dcache_accesses << ", Misses: " << counters.dcache_misses
+            << " (" << percent(counters.dcache_misses, counters.dcache_accesses) << "%)\n";
+    }
+    oss << "Instruction Mix:";
+    for (int i = 0; i < CLASS_COUNT; i++) {
+        oss << (i > 0 ? "," : "") << " " << getClassName((InstructionClass)i) << " "
+            << counters.class_counts[i] << " (" << std::setprecision(1)
+            << percent(counters.class_counts[i], counters.instructions) << "%)";
+    }
+    oss << "\n";
+    return oss.str();
+}
+
+// One flat object of counters, with the stall causes and the mix nested
+std::string MIPSSimulator::getPerfCountersJSON() const {
+    HOST_PHASE(PHASE_FORMAT);
+    PerfCounters counters = getPerfCounters();
+    std::ostringstream oss;
+    oss << "{\n";
+    oss << "  \"model\": \"" << (pipeline_enabled ? "pipeline" : "functional") << "\",\n";
+    oss << "  \"cycles\": " << counters.cycles << ",\n";
+    oss << "  \"instructions\": " << counters.instructions << ",\n";
+    oss << "  \"loads\": " << counters.loads << ",\n";
+    oss << "  \"stores\": " << counters.stores << ",\n";
+    oss << "  \"branches\": " << counters.branches << ",\n";
+    oss << "  \"taken_branches\": " << counters.taken_branches << ",\n";
+    oss << "  \"jumps\": " << counters.jumps << ",\n";
+    oss << "  \"mispredicts\": " << counters.mispredicts << ",\n";
+    oss << "  \"stall_cycles\": " << counters.stall_cycles << ",\n";
+    oss << "  \"stalls\": {\"load_use\": " << counters.load_use_stalls
+        << ", \"hilo\": " << counters.hilo_stalls << ", \"fp\": " << counters.fp_stalls
+        << ", \"redirect\": " << counters.redirect_stalls << "},\n";
+    oss << "  \"icache\": {\"enabled\": " << (instruction_cache.isEnabled() ? "true" : "false")
+        << ", \"accesses\": " << counters.icache_accesses << ", \"misses\": " << counters.icache_misses << "},\n";
+    oss << "  \"dcache\": {\"enabled\": " << (data_cache.isEnabled() ? "true" : "false")
+        << ", \"accesses\": " << counters.dcache_accesses << ", \"misses\": " << counters.dcache_misses << "},\n";
+    oss << "  \"mix\": {";
+    for (int i = 0; i < CLASS_COUNT; i++) {
+        oss << (i > 0 ? ", " : "") << "\"" << getClassName((InstructionClass)i) << "\": " << counters.class_counts[i];
+    }
+    oss << "}\n";
+    oss << "}\n";
+    return oss.str();
+}
+
+bool MIPSSimulator::configureCache(bool instruction, const std::string& config) {
+    CacheModel& cache = instruction ? instruction_cache : data_cache;
+    uint32_t size, ways, line_size;
+    if (config == "off") {
+        cache.configure(0, 1, 1);
+    } else if (!CacheModel::parseConfig(config, size, ways, line_size) || !cache.configure(size, ways, line_size)) {
+        return false;
+    }
+    caches_enabled = instruction_cache.isEnabled() || data_cache.isEnabled();
+    return true;
+}
+
+bool MIPSSimulator::isTracing() const {
+    return trace_writer != nullptr;
+}
+
+uint64_t MIPSSimulator::getTraceRecordCount() const {
+    return trace_writer != nullptr ? trace_writer->getRecordCount() : trace_records;
+}
+
+uint64_t MIPSSimulator::getTraceByteCount() const {
+    return trace_writer != nullptr ? trace_writer->getByteCount() : trace_bytes;
+}
+
+bool MIPSSimulator::enableReverseExecution(bool enable) {
+    if (enable && pipeline_enabled) {
+        return false;
+    }
+    history_enabled = enable;
+    if (enable) {
+        restartHistory();
+    } else {
+        checkpoints.clear();
+    }
+    return true;
+}
+
+bool MIPSSimulator::isReverseExecutionEnabled() const {
+    return history_enabled;
+}
+
+uint64_t MIPSSimulator::getRetiredCount() const {
+    return retired;
+}
+
+bool MIPSSimulator::stepRecorded() {
+    if (retired >= next_checkpoint) {
+        takeCheckpoint();
+    }
+    bool running = (this->*step_function)();
+    if (running || stop_reason == STOP_WATCHPOINT) {
+        retired++;
+    }
+    return running;
+}
+
+// Drop the recorded history and start a new one at the current state
+void MIPSSimulator::restartHistory() {
+    checkpoints.clear();
+    takeCheckpoint();
+}
+
+void MIPSSimulator::takeCheckpoint() {
+    Checkpoint checkpoint;
+    checkpoint.position = retired;
+    std::copy(registers.begin(), registers.end(), checkpoint.registers);
+    checkpoint.hi = hi;
+    checkpoint.lo = lo;
+    checkpoint.pc = pc;
+    checkpoint.fpu = fpu;
+    checkpoint.fpu_used = fpu_used;
+    checkpoint.branch_stats = branch_stats;
+    if (branch_prediction_enabled) {
+        checkpoint.predictors = std::make_unique<TrainedPredictors>(TrainedPredictors{branch_predictor, target_predictor});
+    }
+    checkpoints.push_back(std::move(checkpoint));
+    
+    std::fill(page_saved.begin(), page_saved.end(), 0);
+    std::fill(profile_saved.begin(), profile_saved.end(), 0);
+    next_checkpoint = retired + checkpoint_interval;
+    if (checkpoints.size() > MAX_CHECKPOINTS) {
+        thinCheckpoints();
+    }
+}
+
+// Copy a page, before its first store since the newest checkpoint
+void MIPSSimulator::savePage(uint32_t page) {
+    Checkpoint& checkpoint = checkpoints.back();
+    const uint8_t* data = &memory[page * PAGE_SIZE];
+    checkpoint.pages.push_back(page);
+    checkpoint.page_data.insert(checkpoint.page_data.end(), data, data + PAGE_SIZE);
+    page_saved[page] = 1;
+}
+
+void MIPSSimulator::saveProfileBlock(uint32_t block) {
+    Checkpoint& checkpoint = checkpoints.back();
+    const BranchProfileEntry* data = &branch_profile[block * PROFILE_BLOCK];
+    checkpoint.profile_blocks.push_back(block);
+    checkpoint.profile_data.insert(checkpoint.profile_data.end(), data, data + PROFILE_BLOCK);
+    profile_saved[block] = 1;
+}
+
+// Merge every other checkpoint of the older half into its predecessor. A
+// page in the dropped checkpoint that the predecessor lacks was not stored
+// to in between, so its copy also holds the predecessor's contents.
+void MIPSSimulator::thinCheckpoints() {
+    size_t older = checkpoints.size() / 2;
+    std::vector<Checkpoint> kept;
+    kept.reserve(checkpoints.size() - older / 2);
+    for (size_t i = 0; i < checkpoints.size(); i++) {
+        if (i >= older || i % 2 == 0) {
+            kept.push_back(std::move(checkpoints[i]));
+            continue;
+        }
+        Checkpoint& earlier = kept.back();
+        const Checkpoint& dropped = checkpoints[i];
+        for (size_t j = 0; j < dropped.pages.size(); j++) {
+            if (std::find(earlier.pages.begin(), earlier.pages.end(), dropped.pages[j]) == earlier.pages.end()) {
+                const uint8_t* data = &dropped.page_data[j * PAGE_SIZE];
+                earlier.pages.push_back(dropped.pages[j]);
+                earlier.page_data.insert(earlier.page_data.end(), data, data + PAGE_SIZE);
+            }
+        }
+        for (size_t j = 0; j < dropped.profile_blocks.size(); j++) {
+            if (std::find(earlier.profile_blocks.begin(), earlier.profile_blocks.end(), dropped.profile_blocks[j]) ==
+                earlier.profile_blocks.end()) {
+                const BranchProfileEntry* data = &dropped.profile_data[j * PROFILE_BLOCK];
+                earlier.profile_blocks.push_back(dropped.profile_blocks[j]);
+                earlier.profile_data.insert(earlier.profile_data.end(), data, data + PROFILE_BLOCK);
+            }
+        }
+    }
+    checkpoints = std::move(kept);
+}
+
+// Return to a checkpoint, which becomes the newest one
+void MIPSSimulator::restoreCheckpoint(size_t index) {
+    for (size_t i = checkpoints.size(); i-- > index;) {
+        const Checkpoint& checkpoint = checkpoints[i];
+        for (size_t j = 0; j < checkpoint.pages.size(); j++) {
+            uint32_t address = checkpoint.pages[j] * PAGE_SIZE;
+            std::copy(&checkpoint.page_data[j * PAGE_SIZE], &checkpoint.page_data[j * PAGE_SIZE] + PAGE_SIZE,
+                      &memory[address]);
+            // Clear the predecoded words, and the one before whose fusion may change
+            for (uint32_t word = address / 4; word < (address + PAGE_SIZE) / 4; word++) {
+                decode_cache[word].info = nullptr;
+            }
+            if (address >= 4) {
+                decode_cache[address / 4 - 1].info = nullptr;
+            }
+        }
+        for (size_t j = 0; j < checkpoint.profile_blocks.size(); j++) {
+            const BranchProfileEntry* data = &checkpoint.profile_data[j * PROFILE_BLOCK];
+            std::copy(data, data + PROFILE_BLOCK, &branch_profile[checkpoint.profile_blocks[j] * PROFILE_BLOCK]);
+        }
+    }
+    checkpoints.resize(index + 1);
+    
+    const Checkpoint& checkpoint = checkpoints.back();
+    std::copy(checkpoint.registers, checkpoint.registers + 32, registers.begin());
+    hi = checkpoint.hi;
+    lo = checkpoint.lo;
+    pc = checkpoint.pc;
+    fpu = checkpoint.fpu;
+    fpu_used = checkpoint.fpu_used;
+    branch_stats = checkpoint.branch_stats;
+    if (checkpoint.predictors != nullptr) {
+        branch_predictor = checkpoint.predictors->branch;
+        target_predictor = checkpoint.predictors->target;
+    }
+    halted = false;
+    retired = checkpoint.position;
+    next_checkpoint = retired + checkpoint_interval;
+    std::fill(page_saved.begin(), page_saved.end(), 0);
+    for (uint32_t page : checkpoint.pages) {
+        page_saved[page] = 1;
+    }
+    std::fill(profile_saved.begin(), profile_saved.end(), 0);
+    for (uint32_t block : checkpoint.profile_blocks) {
+        profile_saved[block] = 1;
+    }
+}
+
+// Restore the nearest checkpoint at or before position and re-execute up
+// to it. Replays slower than the target halve the checkpoint spacing, much
+// faster ones double it.
+bool MIPSSimulator::rewindTo(uint64_t position) {
+    if (!history_enabled || checkpoints.empty() || position < checkpoints.front().position) {
+        return false;
+    }
+    stop_reason = STOP_NONE;
+    size_t index = checkpoints.size() - 1;
+    while (checkpoints[index].position > position) {
+        index--;
+    }
+    
+    const double TARGET_SECONDS = 0.0002;
+    const uint64_t MIN_INTERVAL = 256, MAX_INTERVAL = 1u << 20;
+    uint64_t replayed = position - checkpoints[index].position;
+    auto start = std::chrono::steady_clock::now();
+    restoreCheckpoint(index);
+    
+    // Replayed instructions were already traced, profiled and counted, and
+    // run past breakpoints and watchpoints. The predictors and branch
+    // profile came back with the checkpoint, so replay retrains them.
+    std::unique_ptr<TraceWriter> paused_trace = std::move(trace_writer);
+    std::unique_ptr<Profiler> paused_profiler = std::move(profiler);
+    std::vector<BranchPredictor::BranchRecord>* paused_branch_trace = branch_trace;
+    branch_trace = nullptr;
+    PerfCounters counted = perf;
+    bool caches_configured = caches_enabled;
+    caches_enabled = false;
+    stops_suspended = true;
+    while (retired < position && stepRecorded()) {
+    }
+    stops_suspended = false;
+    trace_writer = std::move(paused_trace);
+    profiler = std::move(paused_profiler);
+    branch_trace = paused_branch_trace;
+    perf = counted;
+    caches_enabled = caches_configured;
+    
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (seconds > TARGET_SECONDS && checkpoint_interval > MIN_INTERVAL) {
+        checkpoint_interval /= 2;
+    } else if (seconds < TARGET_SECONDS / 4 && replayed * 2 >= checkpoint_interval &&
+               checkpoint_interval < MAX_INTERVAL) {
+        checkpoint_interval *= 2;
+    }
+    return retired == position;
+}
+
+// A halted simulator sits just before the instruction that halted it, so
+// the first step back only clears the halt
+bool MIPSSimulator::reverseStep(uint64_t count) {
+    uint64_t current = retired + (halted ? 1 : 0);
+    if (count > current) {
+        return false;
+    }
+    return rewindTo(current - count);
+}
+
+// Search the history backwards, one checkpoint interval at a time, for
+// the last position before the current one where a breakpoint stops, or
+// just after the last watched access; without one, go back to the start
+// of the history
+bool MIPSSimulator::reverseContinue() {
+    if (!history_enabled || checkpoints.empty()) {
+        return false;
+    }
+    uint64_t end = retired + (halted ? 1 : 0);
+    uint64_t start = checkpoints.front().position;
+    uint64_t stop = start;
+    StopReason found = STOP_NONE;
+    WatchHit found_hit = watch_hit;
+    stop_reason = STOP_NONE;
+    
+    std::unique_ptr<TraceWriter> paused_trace = std::move(trace_writer);
+    std::unique_ptr<Profiler> paused_profiler = std::move(profiler);
+    std::vector<BranchPredictor::BranchRecord>* paused_branch_trace = branch_trace;
+    branch_trace = nullptr;
+    PerfCounters counted = perf;
+    bool caches_configured = caches_enabled;
+    caches_enabled = false;
+    stops_suspended = true;
+    while ((!breakpoints.empty() || !watchpoints.empty()) && found == STOP_NONE && end > start) {
+        size_t index = checkpoints.size() - 1;
+        while (checkpoints[index].position >= end) {
+            index--;
+        }
+        uint64_t segment_start = checkpoints[index].position;
+        restoreCheckpoint(index);
+        while (retired < end) {
+            if (breakpointStops(pc)) {
+                stop = retired;
+                found = STOP_BREAKPOINT;
+            }
+            watch_seen = false;
+            bool running = stepRecorded();
+            // The access that ends at the current position was reported by
+            // the stop that brought us here
+            if (watch_seen && retired < end) {
+                stop = retired;
+                found = STOP_WATCHPOINT;
+                found_hit = watch_hit;
+            }
+            if (!running) {
+                break;
+            }
+        }
+        end = segment_start;
+    }
+    stops_suspended = false;
+    trace_writer = std::move(paused_trace);
+    profiler = std::move(paused_profiler);
+    branch_trace = paused_branch_trace;
+    perf = counted;
+    caches_enabled = caches_configured;
+    
+    if (!rewindTo(stop)) {
+        return false;
+    }
+    stop_reason = found;
+    watch_hit = found_hit;
+    return true;
+}
+
+void MIPSSimulator::requestStop() {
+    stop_requested = 1;
+}
+
+bool MIPSSimulator::takeStopRequest() {
+    if (!stop_requested) {
+        return false;
+    }
+    stop_requested = 0;
+    stop_reason = STOP_INTERRUPTED;
+    return true;
+}
+
+// Clear the stop state, and let the instruction at the PC execute even if
+// it has a breakpoint
+void MIPSSimulator::beginExecution() {
+    stop_reason = STOP_NONE;
+    resume_pc = pc;
+}
+
+// A watchpoint stops the run loop by halting after its instruction
+// completes; undo the halt so execution can continue from there
+void MIPSSimulator::endExecution() {
+    if (stop_reason == STOP_WATCHPOINT) {
+        halted = false;
+    } else if (halted && stop_reason != STOP_ADDRESS_ERROR) {
+        stop_reason = STOP_HALTED;
+    }
+}
+
+const MIPSSimulator::Breakpoint* MIPSSimulator::findBreakpoint(uint32_t address) const {
+    for (const Breakpoint& breakpoint : breakpoints) {
+        if (breakpoint.address == address) {
+            return &breakpoint;
+        }
+    }
+    return nullptr;
+}
+
+bool MIPSSimulator::breakpointStops(uint32_t address) const {
+    const Breakpoint* breakpoint = findBreakpoint(address);
+    return breakpoint != nullptr && (breakpoint->reg < 0 || registers[breakpoint->reg] == breakpoint->value);
+}
+
+bool MIPSSimulator::addBreakpoint(uint32_t address, int reg, uint32_t value) {
+    if (!isValidAddress(address) || (address & 3) != 0 || reg >= 32) {
+        return false;
+    }
+    removeBreakpoint(address);
+    breakpoints.push_back({address, reg < 0 ? -1 : reg, value});
+    // Redecode the word, and the one before whose fusion would skip it
+    invalidateDecoded(address, 4);
+    return true;
+}
+
+bool MIPSSimulator::removeBreakpoint(uint32_t address) {
+    for (size_t i = 0; i < breakpoints.size(); i++) {
+        if (breakpoints[i].address == address) {
+            breakpoints.erase(breakpoints.begin() + i);
+            invalidateDecoded(address, 4);
+            return true;
+        }
     }
     return false;
 }
 
-void MIPSSimulator::updateBranchPredictor(uint32_t pc, bool taken) {
-    if (prediction_type == "dynamic") {
-        branch_history_table[pc] = taken;
+void MIPSSimulator::clearBreakpoints() {
+    while (!breakpoints.empty()) {
+        removeBreakpoint(breakpoints.back().address);
+    }
+}
+
+const std::vector<MIPSSimulator::Breakpoint>& MIPSSimulator::getBreakpoints() const {
+    return breakpoints;
+}
+
+bool MIPSSimulator::isAtBreakpoint() const {
+    return stop_reason == STOP_BREAKPOINT;
+}
+
+MIPSSimulator::StopReason MIPSSimulator::getStopReason() const {
+    return stop_reason;
+}
+
+bool MIPSSimulator::addWatchpoint(uint32_t address, uint32_t size, bool read, bool write) {
+    if ((size != 1 && size != 2 && size != 4) || address >= memory.size() ||
+        memory.size() - address < size || (!read && !write)) {
+        return false;
+    }
+    removeWatchpoint(address);
+    watchpoints.push_back({address, size, read, write});
+    updatePageWatch();
+    return true;
+}
+
+bool MIPSSimulator::removeWatchpoint(uint32_t address) {
+    for (size_t i = 0; i < watchpoints.size(); i++) {
+        if (watchpoints[i].address == address) {
+            watchpoints.erase(watchpoints.begin() + i);
+            updatePageWatch();
+            return true;
+        }
+    }
+    return false;
+}
+
+void MIPSSimulator::clearWatchpoints() {
+    watchpoints.clear();
+    updatePageWatch();
+}
+
+const std::vector<MIPSSimulator::Watchpoint>& MIPSSimulator::getWatchpoints() const {
+    return watchpoints;
+}
+
+const MIPSSimulator::WatchHit& MIPSSimulator::getWatchHit() const {
+    return watch_hit;
+}
+
+const MIPSSimulator::AddressError& MIPSSimulator::getAddressError() const {
+    return address_error;
+}
+
+std::string MIPSSimulator::getAddressErrorString() const {
+    const AddressError& error = address_error;
+    std::ostringstream oss;
+    oss << "Address error: " << error.size << "-byte " << (error.write ? "store to" : "load from")
+        << " 0x" << std::hex << std::setfill('0') << std::setw(8) << error.address;
+    if (error.address >= memory.size() || memory.size() - error.address < error.size) {
+        oss << " (outside memory)";
+    } else {
+        oss << " (not aligned)";
+    }
+    oss << " at PC 0x" << std::setw(8) << error.pc;
+    return oss.str();
+}
+
+// Accesses are at most 4 bytes and are filtered by the page of their first
+// byte, so a watch also marks the page holding the 3 bytes before it
+void MIPSSimulator::updatePageWatch() {
+    std::fill(page_watch.begin(), page_watch.end(), 0);
+    for (const Watchpoint& watch : watchpoints) {
+        uint8_t kind = (watch.read ? WATCH_READ : 0) | (watch.write ? WATCH_WRITE : 0);
+        uint32_t first = (watch.address < 3 ? 0 : watch.address - 3) / PAGE_SIZE;
+        uint32_t last = (watch.address + watch.size - 1) / PAGE_SIZE;
+        for (uint32_t page = first; page <= last; page++) {
+            page_watch[page] |= kind;
+        }
+    }
+}
+
+const MIPSSimulator::Watchpoint* MIPSSimulator::findWatchpoint(uint32_t address, uint32_t size,
+                                                               uint8_t kind) const {
+    for (const Watchpoint& watch : watchpoints) {
+        bool watched = (kind == WATCH_READ) ? watch.read : watch.write;
+        if (watched && address < watch.address + watch.size && watch.address < address + size) {
+            return &watch;
+        }
+    }
+    return nullptr;
+}
+
+uint32_t MIPSSimulator::watchedValue(const Watchpoint& watch) const {
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < watch.size; i++) {
+        value = (value << 8) | memory[watch.address + i];
+    }
+    return value;
+}
+
+// Called during the access, before pc moves on; the run loop sees the halt
+// once the instruction completes
+void MIPSSimulator::watchTriggered(const Watchpoint& watch, uint32_t address, bool write, uint32_t old_value) {
+    if (pipeline_enabled) {
+        return;
+    }
+    watch_hit = {pc, watch.address, address, write, old_value, watchedValue(watch)};
+    watch_seen = true;
+    if (!stops_suspended) {
+        stop_reason = STOP_WATCHPOINT;
+        halted = true;
+    }
+}
+
+template <typename Policy>
+void MIPSSimulator::useStepFunctions() {
+    step_function = &MIPSSimulator::stepWith<Policy, false>;
+    run_function = &MIPSSimulator::stepWith<Policy, true>;
+}
+
+template <typename Policy>
+uint32_t MIPSSimulator::predictNextPC(uint32_t pc, uint32_t in_flight) {
+    if constexpr (!Policy::enabled) {
+        return pc + 4;
+    } else {
+        HOST_PHASE(PHASE_PREDICTOR);
+        BranchTargetPredictor::Prediction prediction = target_predictor.predict(pc);
+        if (!prediction.hit) {
+            return pc + 4;
+        }
+        if (prediction.kind == BranchTargetPredictor::KIND_CONDITIONAL &&
+            !branch_predictor.predictWith<Policy>(pc, in_flight)) {
+            return pc + 4;
+        }
+        return prediction.target;
     }
 }
 
 std::string MIPSSimulator::getStateString() const {
+    HOST_PHASE(PHASE_FORMAT);
     std::ostringstream oss;
     oss << "PC: 0x" << std::hex << std::setw(8) << std::setfill('0') << pc << "\n";
     oss << "Registers:\n";
@@ -388,36 +2168,63 @@ std::string MIPSSimulator::getStateString() const {
         }
         oss << "\n";
     }
+    oss << "HI: 0x" << std::hex << std::setw(8) << std::setfill('0') << hi
+        << " LO: 0x" << std::setw(8) << std::setfill('0') << lo << "\n";
+    if (fpu_used) {
+        oss << fpu.getStateString();
+    }
     oss << "Halted: " << (halted ? "Yes" : "No") << "\n";
     return oss.str();
 }
 
 std::string MIPSSimulator::getPipelineStateString() const {
+    HOST_PHASE(PHASE_FORMAT);
     std::ostringstream oss;
+    const Pipeline::PipelineRegister& latches = pipeline.getRegisters();
+    
     oss << "Pipeline State:\n";
     const std::string stage_names[] = {"IF", "ID", "EX", "MEM", "WB"};
+    const bool valid[] = {latches.if_id_valid, latches.id_ex_valid, latches.ex_mem_valid,
+                          latches.mem_wb_valid, latches.wb_valid};
+    const uint32_t instructions[] = {latches.if_id_instruction, latches.id_ex_instruction,
+                                     latches.ex_mem_instruction, latches.mem_wb_instruction,
+                                     latches.wb_instruction};
     for (int i = 0; i < 5; i++) {
         oss << stage_names[i] << ": ";
-        if (pipeline_stages[i].valid) {
+        if (valid[i]) {
             oss << "0x" << std::hex << std::setw(8) << std::setfill('0') 
-                << pipeline_stages[i].instruction;
+                << instructions[i];
         } else {
             oss << "NOP";
         }
         oss << "\n";
     }
+    
+    oss << std::dec;
+    oss << "Cycles: " << pipeline_stats.cycles
+        << ", Instructions: " << pipeline_stats.instructions
+        << ", Stalls: " << pipeline_stats.stall_cycles
+        << ", Flushes: " << pipeline_stats.flushes << "\n";
+    oss << "HI/LO Interlock Stalls: " << pipeline_stats.hilo_stalls
+        << " (mult " << scoreboard.getMultiplyLatency() << ", div " << scoreboard.getDivideLatency()
+        << " cycles, " << (scoreboard.isMulDivPipelined() ? "pipelined" : "unpipelined") << ")\n";
+    oss << "FP Interlock Stalls: " << pipeline_stats.fp_stalls << "\n";
+    if (pipeline_stats.instructions > 0) {
+        double cpi = (double)pipeline_stats.cycles / pipeline_stats.instructions;
+        oss << "CPI: " << std::fixed << std::setprecision(2) << cpi << "\n";
+    }
     return oss.str();
 }
 
 std::string MIPSSimulator::getBranchPredictionStats() const {
+    HOST_PHASE(PHASE_FORMAT);
     std::ostringstream oss;
-    oss << "Branch Prediction Statistics:\n";
-    oss << "Total Branches: " << branch_stats.total_branches << "\n";
-    oss << "Correct Predictions: " << branch_stats.correct_predictions << "\n";
-    oss << "Incorrect Predictions: " << branch_stats.incorrect_predictions << "\n";
-    if (branch_stats.total_branches > 0) {
-        double accuracy = (double)branch_stats.correct_predictions / branch_stats.total_branches * 100.0;
-        oss << "Accuracy: " << std::fixed << std::setprecision(2) << accuracy << "%\n";
+    oss << branch_predictor.getStatsString();
+    oss << "Fetch Redirects: " << branch_stats.fetch_redirects << "\n";
+    if (pipeline_enabled) {
+        oss << "Mispredict Penalty: " << mispredict_penalty << " extra cycles\n";
+        oss << "Cycles Lost to Mispredictions: " << branch_stats.cycles_lost << "\n";
     }
+    oss << "\n" << target_predictor.getStatsString();
     return oss.str();
 }
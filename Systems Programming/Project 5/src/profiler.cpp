@@ -0,0 +1,220 @@
+#include "profiler.hpp"
+#include "instruction_decoder.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+Profiler::Profiler(uint32_t memory_size, bool count_cycles) : entries(memory_size / 4) {
+    reset(0, count_cycles);
+}
+
+void Profiler::reset(uint32_t entry_pc, bool count_cycles) {
+    std::fill(entries.begin(), entries.end(), Entry{0, 0, 0});
+    this->count_cycles = count_cycles;
+    instructions = 0;
+    cycles = 0;
+    last_retire = 0;
+    call_nodes.assign(1, CallNode{entry_pc, -1, 0});
+    call_children.clear();
+    current_node = 0;
+    path_start = 0;
+}
+
+bool Profiler::isCountingCycles() const {
+    return count_cycles;
+}
+
+void Profiler::chargePath() {
+    uint64_t now = clock();
+    call_nodes[current_node].weight += now - path_start;
+    path_start = now;
+}
+
+void Profiler::recordCall(uint32_t target) {
+    chargePath();
+    uint64_t key = ((uint64_t)current_node << 32) | target;
+    auto child = call_children.find(key);
+    if (child != call_children.end()) {
+        current_node = child->second;
+        return;
+    }
+    call_nodes.push_back({target, current_node, 0});
+    current_node = call_nodes.size() - 1;
+    call_children.emplace(key, current_node);
+}
+
+// A return from the outermost function (e.g. a program that returns
+// through $ra at the end) stays at the root
+void Profiler::recordReturn() {
+    chargePath();
+    if (call_nodes[current_node].parent >= 0) {
+        current_node = call_nodes[current_node].parent;
+    }
+}
+
+const Profiler::Entry& Profiler::getEntry(uint32_t pc) const {
+    return entries[pc >> 2];
+}
+
+uint64_t Profiler::getInstructionCount() const {
+    return instructions;
+}
+
+uint64_t Profiler::getCycleCount() const {
+    return cycles;
+}
+
+std::string Profiler::getReportString(const uint8_t* image, size_t size, int top_n) const {
+    uint32_t words = std::min(entries.size(), size / 4);
+    auto word = [image](uint32_t index) {
+        const uint8_t* bytes = image + index * 4;
+        return ((uint32_t)bytes[0] << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+    };
+    auto weight = [this](uint32_t index) {
+        return count_cycles ? entries[index].cycles : entries[index].executions;
+    };
+    uint64_t total = count_cycles ? cycles : instructions;
+    const char* unit = count_cycles ? "Cycles" : "Executions";
+
+    std::vector<uint32_t> executed;
+    for (uint32_t i = 0; i < words; i++) {
+        if (entries[i].executions > 0) executed.push_back(i);
+    }
+
+    std::ostringstream oss;
+    oss << "Execution Profile: " << instructions << " instructions";
+    if (count_cycles) {
+        oss << ", " << cycles << " cycles";
+    }
+    oss << "\n\n";
+
+    // Hot instructions
+    size_t count = std::min(executed.size(), (size_t)std::max(top_n, 0));
+    std::vector<uint32_t> hottest = executed;
+    std::partial_sort(hottest.begin(), hottest.begin() + count, hottest.end(),
+                      [&](uint32_t a, uint32_t b) { return weight(a) > weight(b); });
+    oss << "Top " << count << " Instructions by " << unit << ":\n";
+    oss << std::left << std::setw(10) << "PC" << std::right << std::setw(12) << "Execs";
+    if (count_cycles) {
+        oss << std::setw(12) << "Cycles" << std::setw(10) << "Stalls";
+    }
+    oss << std::setw(9) << "Share" << "  Instruction\n";
+    for (size_t i = 0; i < count; i++) {
+        const Entry& entry = entries[hottest[i]];
+        char text[InstructionDecoder::MAX_DISASSEMBLY_LENGTH];
+        InstructionDecoder::disassemble(word(hottest[i]), text);
+        oss << "0x" << std::hex << std::setw(8) << std::setfill('0') << (hottest[i] << 2)
+            << std::dec << std::setfill(' ') << std::setw(12) << entry.executions;
+        if (count_cycles) {
+            oss << std::setw(12) << entry.cycles << std::setw(10) << entry.stall_cycles;
+        }
+        oss << std::setw(8) << std::fixed << std::setprecision(1)
+            << (total ? weight(hottest[i]) * 100.0 / total : 0.0) << "%  " << text << "\n";
+    }
+
+    // Block leaders: direct branch and jump targets, words after a control
+    // transfer, and words executed a different number of times than the
+    // word before (entered from elsewhere, e.g. by JR)
+    std::vector<bool> leader(words + 1, false);
+    for (uint32_t i : executed) {
+        uint32_t instruction = word(i);
+        const MIPS::InstructionInfo& info = InstructionDecoder::info(instruction);
+        if (info.control.branch) {
+            uint32_t target = i + 1 + (uint32_t)(int32_t)(int16_t)(instruction & 0xFFFF);
+            if (target < words) leader[target] = true;
+        } else if (info.control.jump && info.layout == MIPS::LAYOUT_TARGET) {
+            uint32_t target = (((i << 2) & 0xF0000000) | ((instruction & 0x3FFFFFF) << 2)) >> 2;
+            if (target < words) leader[target] = true;
+        }
+        if (info.control.branch || info.control.jump) {
+            leader[i + 1] = true;
+        }
+    }
+
+    struct Block {
+        uint32_t first, last;
+        uint64_t instructions, weight;
+    };
+    std::vector<Block> blocks;
+    for (uint32_t i : executed) {
+        bool extends = !blocks.empty() && blocks.back().last + 1 == i && !leader[i] &&
+                       entries[i].executions == entries[i - 1].executions;
+        if (!extends) {
+            blocks.push_back({i, i, 0, 0});
+        }
+        blocks.back().last = i;
+        blocks.back().instructions += entries[i].executions;
+        blocks.back().weight += weight(i);
+    }
+
+    count = std::min(blocks.size(), (size_t)std::max(top_n, 0));
+    std::partial_sort(blocks.begin(), blocks.begin() + count, blocks.end(),
+                      [](const Block& a, const Block& b) { return a.weight > b.weight; });
+    oss << "\nTop " << count << " Basic Blocks by " << unit << ":\n";
+    oss << std::left << std::setw(22) << "Block" << std::right << std::setw(12) << "Execs"
+        << std::setw(14) << "Instructions";
+    if (count_cycles) {
+        oss << std::setw(12) << "Cycles";
+    }
+    oss << std::setw(9) << "Share" << "\n";
+    const uint32_t MAX_LISTED = 12;
+    for (size_t i = 0; i < count; i++) {
+        const Block& block = blocks[i];
+        oss << "0x" << std::hex << std::setw(8) << std::setfill('0') << (block.first << 2)
+            << "-0x" << std::setw(8) << (block.last << 2) << std::dec << std::setfill(' ')
+            << std::setw(12) << entries[block.first].executions << std::setw(14) << block.instructions;
+        if (count_cycles) {
+            oss << std::setw(12) << block.weight;
+        }
+        oss << std::setw(8) << std::fixed << std::setprecision(1)
+            << (total ? block.weight * 100.0 / total : 0.0) << "%\n";
+        for (uint32_t index = block.first; index <= block.last && index < block.first + MAX_LISTED; index++) {
+            char text[InstructionDecoder::MAX_DISASSEMBLY_LENGTH];
+            InstructionDecoder::disassemble(word(index), text);
+            oss << "    0x" << std::hex << std::setw(8) << std::setfill('0') << (index << 2)
+                << std::dec << std::setfill(' ') << "  " << text << "\n";
+        }
+        if (block.last - block.first + 1 > MAX_LISTED) {
+            oss << "    ... " << block.last - block.first + 1 - MAX_LISTED << " more\n";
+        }
+    }
+    return oss.str();
+}
+
+std::string Profiler::pathName(int32_t node) const {
+    std::vector<uint32_t> functions;
+    for (; node >= 0; node = call_nodes[node].parent) {
+        functions.push_back(call_nodes[node].function);
+    }
+    std::ostringstream oss;
+    oss << std::hex << std::setfill('0');
+    for (size_t i = functions.size(); i-- > 0;) {
+        oss << "0x" << std::setw(8) << functions[i] << (i > 0 ? ";" : "");
+    }
+    return oss.str();
+}
+
+std::string Profiler::getCollapsedStacks() const {
+    std::ostringstream oss;
+    for (size_t node = 0; node < call_nodes.size(); node++) {
+        uint64_t weight = call_nodes[node].weight;
+        if ((int32_t)node == current_node) {
+            weight += clock() - path_start; // Not yet charged
+        }
+        if (weight > 0) {
+            oss << pathName(node) << " " << weight << "\n";
+        }
+    }
+    return oss.str();
+}
+
+bool Profiler::writeCollapsedStacks(const std::string& filename) const {
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        return false;
+    }
+    file << getCollapsedStacks();
+    file.close();
+    return !file.fail();
+}
@@ -0,0 +1,156 @@
+#include "trace_reader.hpp"
+#include "trace_replayer.hpp"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+
+void printUsage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " <trace_file> [options]\n";
+    std::cout << "\nReplays a trace recorded with mips_simulator --trace through the\n";
+    std::cout << "pipeline, cache and branch predictor timing models.\n";
+    std::cout << "\nOptions:\n";
+    std::cout << "  --branch-pred    Enable branch prediction\n";
+    std::cout << "  --pred-type TYPE Set branch predictor type (static|taken|1bit|2bit|gshare)\n";
+    std::cout << "  --loop-pred      Add the loop predictor to the branch predictor\n";
+    std::cout << "  --penalty N      Extra cycles charged per misprediction\n";
+    std::cout << "  --mult-latency N Multiply result latency in cycles (default 12)\n";
+    std::cout << "  --div-latency N  Divide result latency in cycles (default 35)\n";
+    std::cout << "  --muldiv-pipelined  Let a multiply/divide start every cycle\n";
+    std::cout << "  --fp-latency LIST   FPU latencies, e.g. mul=4,div.d=19\n";
+    std::cout << "  --icache CONFIG  Instruction cache SIZE:WAYS:LINE, e.g. 8k:2:32\n";
+    std::cout << "  --dcache CONFIG  Data cache SIZE:WAYS:LINE\n";
+    std::cout << "  --miss-penalty N Cycles per cache miss (default 10)\n";
+    std::cout << "  --help           Show this help message\n";
+    std::cout << "\nExample:\n";
+    std::cout << "  " << program_name << " run.trc --branch-pred --pred-type gshare --dcache 4k:2:16\n";
+}
+
+// Apply "class=cycles" entries separated by commas
+bool setFPLatencies(TraceReplayer& replayer, const std::string& list) {
+    std::istringstream entries(list);
+    std::string entry;
+    while (std::getline(entries, entry, ',')) {
+        size_t equals = entry.find('=');
+        if (equals == std::string::npos) {
+            return false;
+        }
+        int cycles = std::atoi(entry.c_str() + equals + 1);
+        if (cycles < 1 || !replayer.setFPLatency(entry.substr(0, equals), cycles)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool configureCache(CacheModel& cache, const std::string& config) {
+    uint32_t size, ways, line_size;
+    return CacheModel::parseConfig(config, size, ways, line_size) && cache.configure(size, ways, line_size);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::string trace_file = argv[1];
+    bool branch_prediction = false;
+    std::string predictor_type = "static";
+    bool loop_predictor = false;
+    int mispredict_penalty = 0;
+    int multiply_latency = 12;
+    int divide_latency = 35;
+    bool muldiv_pipelined = false;
+    std::string fp_latencies;
+    std::string icache_config;
+    std::string dcache_config;
+    int miss_penalty = 10;
+
+    // Parse command line arguments
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else if (arg == "--branch-pred") {
+            branch_prediction = true;
+        } else if (arg == "--pred-type" && has_value) {
+            predictor_type = argv[++i];
+        } else if (arg == "--loop-pred") {
+            loop_predictor = true;
+        } else if (arg == "--penalty" && has_value) {
+            mispredict_penalty = std::atoi(argv[++i]);
+        } else if (arg == "--mult-latency" && has_value) {
+            multiply_latency = std::atoi(argv[++i]);
+        } else if (arg == "--div-latency" && has_value) {
+            divide_latency = std::atoi(argv[++i]);
+        } else if (arg == "--muldiv-pipelined") {
+            muldiv_pipelined = true;
+        } else if (arg == "--fp-latency" && has_value) {
+            fp_latencies = argv[++i];
+        } else if (arg == "--icache" && has_value) {
+            icache_config = argv[++i];
+        } else if (arg == "--dcache" && has_value) {
+            dcache_config = argv[++i];
+        } else if (arg == "--miss-penalty" && has_value) {
+            miss_penalty = std::atoi(argv[++i]);
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    TraceReplayer replayer;
+    replayer.setMispredictPenalty(mispredict_penalty);
+    replayer.setMulDivLatency(multiply_latency, divide_latency);
+    replayer.setMulDivPipelined(muldiv_pipelined);
+    replayer.setCacheMissPenalty(miss_penalty);
+    if (!setFPLatencies(replayer, fp_latencies)) {
+        std::cerr << "Error: Invalid FP latency list: " << fp_latencies << std::endl;
+        return 1;
+    }
+    if (!icache_config.empty() && !configureCache(replayer.getInstructionCache(), icache_config)) {
+        std::cerr << "Error: Invalid instruction cache configuration: " << icache_config << std::endl;
+        return 1;
+    }
+    if (!dcache_config.empty() && !configureCache(replayer.getDataCache(), dcache_config)) {
+        std::cerr << "Error: Invalid data cache configuration: " << dcache_config << std::endl;
+        return 1;
+    }
+    replayer.enableLoopPredictor(loop_predictor);
+    if (!replayer.enableBranchPrediction(branch_prediction, predictor_type)) {
+        std::cerr << "Error: Unknown branch predictor type: " << predictor_type << std::endl;
+        return 1;
+    }
+
+    TraceReader reader;
+    if (!reader.open(trace_file)) {
+        std::cerr << "Error: Could not open trace file: " << trace_file << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    bool complete = replayer.replay(reader);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!complete) {
+        std::cerr << "Warning: Trace is truncated after " << reader.getRecordCount() << " records\n";
+    }
+
+    std::cout << "MIPS Trace Replay\n";
+    std::cout << "=================\n";
+    std::cout << "Trace: " << trace_file << " (" << reader.getFileSize() << " bytes)\n\n";
+    std::cout << replayer.getStatsString();
+    std::cout << "\nReplay time: " << std::fixed << std::setprecision(3) << seconds * 1000 << " ms";
+    if (seconds > 0) {
+        std::cout << " (" << std::setprecision(1) << reader.getRecordCount() / seconds / 1e6
+                  << " M records/s)";
+    }
+    std::cout << "\n";
+    return complete ? 0 : 1;
+}
@@ -0,0 +1,165 @@
+#include "timeline_writer.hpp"
+#include "instruction_decoder.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+static const char* const TRACK_NAMES[TimelineWriter::TRACK_COUNT] = {"IF", "ID", "EX", "MEM", "WB", "Stalls"};
+
+TimelineWriter::TimelineWriter()
+    : buffer(BUFFER_SIZE), used(0), write_failed(false), bytes_written(0), events(0),
+      cycle(0), stages(), stall_cause(nullptr), stall_start(0), stall_cycle(0) {}
+
+TimelineWriter::~TimelineWriter() {
+    close();
+}
+
+bool TimelineWriter::open(const std::string& filename) {
+    close();
+    file.open(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+    used = 0;
+    write_failed = false;
+    bytes_written = 0;
+    events = 0;
+    cycle = 0;
+    std::fill(stages, stages + TRACK_STALLS, Occupant{false, 0, 0, 0});
+    stall_cause = nullptr;
+
+    // Name the tracks and keep them in pipeline order
+    used += std::snprintf(reserve(), MAX_EVENT_SIZE,
+                          "{\"traceEvents\":[\n"
+                          "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"MIPS pipeline\"}}");
+    for (int track = 0; track < TRACK_COUNT; track++) {
+        used += std::snprintf(reserve(), MAX_EVENT_SIZE,
+                              ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}"
+                              ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"sort_index\":%d}}",
+                              track + 1, TRACK_NAMES[track], track + 1, track);
+    }
+    return true;
+}
+
+bool TimelineWriter::close() {
+    if (!file.is_open()) {
+        return !write_failed;
+    }
+    for (int track = 0; track < TRACK_STALLS; track++) {
+        if (stages[track].valid) {
+            endSlice(track, stages[track]);
+            stages[track].valid = false;
+        }
+    }
+    endStall();
+    used += std::snprintf(reserve(), MAX_EVENT_SIZE, "\n]}\n");
+    flushBuffer();
+    file.close();
+    if (file.fail()) {
+        write_failed = true;
+    }
+    return !write_failed;
+}
+
+bool TimelineWriter::isOpen() const {
+    return file.is_open();
+}
+
+void TimelineWriter::recordCycle(const Pipeline::PipelineRegister& latches, bool held) {
+    const bool valid[] = {latches.if_id_valid, latches.id_ex_valid, latches.ex_mem_valid,
+                          latches.mem_wb_valid, latches.wb_valid};
+    const uint32_t pcs[] = {latches.if_id_pc, latches.id_ex_pc, latches.ex_mem_pc,
+                            latches.mem_wb_pc, latches.wb_pc};
+    const uint32_t instructions[] = {latches.if_id_instruction, latches.id_ex_instruction,
+                                     latches.ex_mem_instruction, latches.mem_wb_instruction,
+                                     latches.wb_instruction};
+    for (int track = 0; track < TRACK_STALLS; track++) {
+        Occupant& occupant = stages[track];
+        bool stays = track == TRACK_IF && held && valid[track] && occupant.valid &&
+                     occupant.pc == pcs[track] && occupant.instruction == instructions[track];
+        if (stays) {
+            continue;
+        }
+        if (occupant.valid) {
+            endSlice(track, occupant);
+        }
+        occupant = {valid[track], pcs[track], instructions[track], cycle};
+    }
+    cycle++;
+}
+
+// Consecutive stall cycles with the same cause make one slice
+void TimelineWriter::recordStall(const char* cause) {
+    uint64_t current = cycle - 1;
+    if (stall_cause != nullptr && std::strcmp(stall_cause, cause) == 0 && stall_cycle + 1 == current) {
+        stall_cycle = current;
+        return;
+    }
+    endStall();
+    stall_cause = cause;
+    stall_start = current;
+    stall_cycle = current;
+}
+
+void TimelineWriter::recordFlush(uint32_t branch_pc, int bubbles) {
+    commit(std::snprintf(reserve(), MAX_EVENT_SIZE,
+                         ",\n{\"name\":\"flush\",\"cat\":\"flush\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%d,"
+                         "\"ts\":%llu,\"args\":{\"branch\":\"0x%08x\",\"bubbles\":%d}}",
+                         TRACK_EX + 1, (unsigned long long)(cycle - 1), branch_pc, bubbles));
+}
+
+void TimelineWriter::endSlice(int track, const Occupant& occupant) {
+    char text[InstructionDecoder::MAX_DISASSEMBLY_LENGTH];
+    InstructionDecoder::disassemble(occupant.instruction, text);
+    commit(std::snprintf(reserve(), MAX_EVENT_SIZE,
+                         ",\n{\"name\":\"%s\",\"cat\":\"stage\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                         "\"ts\":%llu,\"dur\":%llu,\"args\":{\"pc\":\"0x%08x\"}}",
+                         text, track + 1, (unsigned long long)occupant.start,
+                         (unsigned long long)(cycle - occupant.start), occupant.pc));
+}
+
+void TimelineWriter::endStall() {
+    if (stall_cause == nullptr) {
+        return;
+    }
+    commit(std::snprintf(reserve(), MAX_EVENT_SIZE,
+                         ",\n{\"name\":\"%s\",\"cat\":\"stall\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                         "\"ts\":%llu,\"dur\":%llu}",
+                         stall_cause, TRACK_STALLS + 1, (unsigned long long)stall_start,
+                         (unsigned long long)(stall_cycle - stall_start + 1)));
+    stall_cause = nullptr;
+}
+
+char* TimelineWriter::reserve() {
+    if (BUFFER_SIZE - used < MAX_EVENT_SIZE) {
+        flushBuffer();
+    }
+    return buffer.data() + used;
+}
+
+// Count one event of the length snprintf returned for it
+void TimelineWriter::commit(int length) {
+    used += std::min<size_t>(std::max(length, 0), MAX_EVENT_SIZE - 1);
+    events++;
+}
+
+void TimelineWriter::flushBuffer() {
+    file.write(buffer.data(), used);
+    if (!file.good()) {
+        write_failed = true;
+    }
+    bytes_written += used;
+    used = 0;
+}
+
+uint64_t TimelineWriter::getCycleCount() const {
+    return cycle;
+}
+
+uint64_t TimelineWriter::getEventCount() const {
+    return events;
+}
+
+uint64_t TimelineWriter::getByteCount() const {
+    return bytes_written + used;
+}
@@ -0,0 +1,118 @@
+#include "trace_reader.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+TraceReader::TraceReader()
+    : base(nullptr), length(0), cursor(nullptr), end(nullptr), chunk_end(nullptr), corrupt(false) {
+    resetDecoder();
+}
+
+TraceReader::~TraceReader() {
+    close();
+}
+
+void TraceReader::resetDecoder() {
+    last_pc = 0u - 4;
+    last_address = 0;
+    std::fill(last_value, last_value + 32, 0);
+    std::fill(word_pc, word_pc + TraceWriter::WORD_TABLE_SIZE, 0xFFFFFFFF);
+    std::fill(word_value, word_value + TraceWriter::WORD_TABLE_SIZE, 0);
+    records = 0;
+}
+
+bool TraceReader::open(const std::string& filename) {
+    close();
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(TraceWriter::MAGIC)) {
+        ::close(fd);
+        return false;
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    base = (const uint8_t*)mapping;
+    length = info.st_size;
+    if (std::memcmp(base, TraceWriter::MAGIC, sizeof(TraceWriter::MAGIC)) != 0) {
+        close();
+        return false;
+    }
+
+    madvise(mapping, length, MADV_SEQUENTIAL);
+    madvise(mapping, std::min(length, CHUNK_SIZE), MADV_WILLNEED);
+    cursor = base + sizeof(TraceWriter::MAGIC);
+    end = base + length;
+    chunk_end = base + std::min(length, CHUNK_SIZE);
+    corrupt = false;
+    resetDecoder();
+    return true;
+}
+
+void TraceReader::close() {
+    if (base != nullptr) {
+        munmap((void*)base, length);
+    }
+    base = cursor = end = chunk_end = nullptr;
+    length = 0;
+}
+
+bool TraceReader::isOpen() const {
+    return base != nullptr;
+}
+
+// Read the following window ahead and release the one before the cursor
+// Windows are [k * CHUNK_SIZE, (k + 1) * CHUNK_SIZE) clipped to the file;
+// offsets keep the last, partial one inside the mapping
+void TraceReader::nextChunk() {
+    size_t offset = chunk_end - base;
+    size_t chunk_start = offset > 0 ? (offset - 1) / CHUNK_SIZE * CHUNK_SIZE : 0;
+    size_t ahead = std::min(length - offset, CHUNK_SIZE);
+    if (ahead > 0) {
+        madvise((void*)chunk_end, ahead, MADV_WILLNEED);
+    }
+    madvise((void*)(base + chunk_start), offset - chunk_start, MADV_DONTNEED);
+    chunk_end = base + offset + ahead;
+}
+
+// The last few records are decoded from a zero-padded copy, so a record cut
+// short by a truncated file is caught instead of read past the mapping
+bool TraceReader::nextTail(Record& record) {
+    size_t remaining = end - cursor;
+    if (remaining == 0) {
+        return false;
+    }
+    uint8_t tail[MAX_RECORD_SIZE] = {};
+    std::memcpy(tail, cursor, remaining);
+    size_t used = decode(tail, record) - tail;
+    if (used > remaining) {
+        corrupt = true;
+        cursor = end;
+        return false;
+    }
+    cursor += used;
+    records++;
+    return true;
+}
+
+bool TraceReader::isCorrupt() const {
+    return corrupt;
+}
+
+uint64_t TraceReader::getRecordCount() const {
+    return records;
+}
+
+uint64_t TraceReader::getFileSize() const {
+    return length;
+}
@@ -0,0 +1,256 @@
+#include "trace_replayer.hpp"
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+TraceReplayer::TraceReplayer()
+    : branch_prediction_enabled(false), mispredict_penalty(0), miss_penalty(10) {
+    resetModels();
+}
+
+TraceReplayer::~TraceReplayer() {}
+
+bool TraceReplayer::enableBranchPrediction(bool enable, const std::string& type) {
+    BranchPredictor::PredictorType predictor_type = BranchPredictor::STATIC_NOT_TAKEN;
+    if (enable && !BranchPredictor::parseType(type, predictor_type)) {
+        return false;
+    }
+    branch_prediction_enabled = enable;
+    branch_predictor.setPredictorType(predictor_type);
+    return true;
+}
+
+void TraceReplayer::enableLoopPredictor(bool enable) {
+    branch_predictor.enableLoopPredictor(enable);
+}
+
+void TraceReplayer::setMispredictPenalty(int cycles) {
+    mispredict_penalty = cycles > 0 ? cycles : 0;
+}
+
+void TraceReplayer::setMulDivLatency(int multiply_cycles, int divide_cycles) {
+    units.setMulDivLatency(multiply_cycles, divide_cycles);
+}
+
+void TraceReplayer::setMulDivPipelined(bool pipelined) {
+    units.setMulDivPipelined(pipelined);
+}
+
+bool TraceReplayer::setFPLatency(const std::string& name, int cycles) {
+    return units.setFPLatency(name, cycles);
+}
+
+CacheModel& TraceReplayer::getInstructionCache() {
+    return instruction_cache;
+}
+
+CacheModel& TraceReplayer::getDataCache() {
+    return data_cache;
+}
+
+void TraceReplayer::setCacheMissPenalty(int cycles) {
+    miss_penalty = cycles > 0 ? cycles : 0;
+}
+
+void TraceReplayer::resetModels() {
+    branch_predictor.reset();
+    target_predictor.reset();
+    instruction_cache.reset();
+    data_cache.reset();
+    scoreboard = {};
+    units.reset();
+    stats = {};
+}
+
+bool TraceReplayer::replay(TraceReader& reader) {
+    resetModels();
+    if (!branch_prediction_enabled) {
+        replayWith<BranchPolicy::Disabled>(reader);
+    } else {
+        switch (branch_predictor.getPredictorType()) {
+            case BranchPredictor::STATIC_NOT_TAKEN:
+                replayWith<BranchPolicy::StaticNotTaken>(reader);
+                break;
+            case BranchPredictor::STATIC_TAKEN:
+                replayWith<BranchPolicy::StaticTaken>(reader);
+                break;
+            case BranchPredictor::DYNAMIC_1BIT:
+                replayWith<BranchPolicy::OneBit>(reader);
+                break;
+            case BranchPredictor::DYNAMIC_2BIT:
+                replayWith<BranchPolicy::TwoBit>(reader);
+                break;
+            case BranchPredictor::GSHARE:
+                replayWith<BranchPolicy::Gshare>(reader);
+                break;
+        }
+    }
+    return !reader.isCorrupt();
+}
+
+// A record's successor is the next record's PC. The last one has none, so
+// its target is rebuilt from the word or the traced register values.
+template <typename Policy>
+void TraceReplayer::replayWith(TraceReader& reader) {
+    TraceReader::Record records[2];
+    int current = 0;
+    if (!reader.next(records[current])) {
+        return;
+    }
+    while (true) {
+        TraceReader::Record& record = records[current];
+        TraceReader::Record& following = records[current ^ 1];
+        if (!reader.next(following)) {
+            uint32_t next_pc = record.pc + 4;
+            if (record.flags & TraceWriter::TRACE_TAKEN) {
+                const MIPS::InstructionInfo& info = InstructionDecoder::info(record.word);
+                if (info.control.branch) {
+                    next_pc += (uint32_t)(int16_t)record.word << 2;
+                } else if (info.operation == MIPS::OP_J || info.operation == MIPS::OP_JAL) {
+                    next_pc = (record.pc & 0xF0000000) | ((record.word & 0x03FFFFFF) << 2);
+                } else {
+                    next_pc = reader.getRegister((record.word >> 21) & 0x1F);
+                }
+            }
+            retire<Policy>(record, next_pc);
+            break;
+        }
+        retire<Policy>(record, following.pc);
+        current ^= 1;
+    }
+
+    // The last instruction still passes EX, MEM and WB
+    stats.cycles = scoreboard.last_issue + scoreboard.bubbles + 3;
+}
+
+template <typename Policy>
+uint32_t TraceReplayer::predictNextPC(uint32_t pc) {
+    if constexpr (!Policy::enabled) {
+        return pc + 4;
+    } else {
+        BranchTargetPredictor::Prediction prediction = target_predictor.predict(pc);
+        if (!prediction.hit) {
+            return pc + 4;
+        }
+        if (prediction.kind == BranchTargetPredictor::KIND_CONDITIONAL &&
+            !branch_predictor.predictWith<Policy>(pc)) {
+            return pc + 4;
+        }
+        return prediction.target;
+    }
+}
+
+template <typename Policy>
+void TraceReplayer::retire(const TraceReader::Record& record, uint32_t next_pc) {
+    const MIPS::InstructionInfo& info = InstructionDecoder::info(record.word);
+    uint32_t predicted_pc = predictNextPC<Policy>(record.pc);
+    scoreboard.last_issue = issueCycle(record, info);
+    stats.instructions++;
+
+    if (record.flags & TraceWriter::TRACE_BRANCH) {
+        bool taken = (record.flags & TraceWriter::TRACE_TAKEN) != 0;
+        BranchTargetPredictor::BranchKind kind = BranchTargetPredictor::KIND_CONDITIONAL;
+        switch (info.operation) {
+            case MIPS::OP_J:
+                kind = BranchTargetPredictor::KIND_JUMP;
+                break;
+            case MIPS::OP_JAL:
+            case MIPS::OP_JALR:
+                kind = BranchTargetPredictor::KIND_CALL;
+                break;
+            case MIPS::OP_JR:
+                kind = (((record.word >> 21) & 0x1F) == MIPS::REG_RA) ? BranchTargetPredictor::KIND_RETURN
+                                                                     : BranchTargetPredictor::KIND_INDIRECT;
+                break;
+            default:
+                break;
+        }
+        if constexpr (Policy::enabled) {
+            if (kind == BranchTargetPredictor::KIND_CONDITIONAL) {
+                uint32_t target = record.pc + 4 + ((uint32_t)(int16_t)record.word << 2);
+                branch_predictor.resolveWith<Policy>(record.pc, taken, target);
+            }
+            target_predictor.update(record.pc, kind, taken, next_pc);
+        }
+    }
+
+    // IF/ID and ID/EX are squashed, plus the configured refill penalty
+    if (next_pc != predicted_pc) {
+        uint64_t lost = 2 + mispredict_penalty;
+        stats.redirects++;
+        stats.redirect_cycles += lost;
+        scoreboard.bubbles += lost;
+    }
+}
+
+// Cycle at which the instruction enters ID/EX, charging each stall to the
+// first cause that holds it back
+uint64_t TraceReplayer::issueCycle(const TraceReader::Record& record, const MIPS::InstructionInfo& info) {
+    uint64_t issue = scoreboard.last_issue + 1 + scoreboard.bubbles;
+    scoreboard.bubbles = 0;
+    if (!instruction_cache.access(record.pc, false)) {
+        issue += miss_penalty;
+        stats.cache_stalls += miss_penalty;
+    }
+
+    if (HazardScoreboard::readsLoadResult(record.word, info, scoreboard.load_dest) &&
+        issue < scoreboard.last_issue + 2) {
+        stats.load_use_stalls += scoreboard.last_issue + 2 - issue;
+        issue = scoreboard.last_issue + 2;
+    }
+
+    uint64_t ready = units.mulDivReadyCycle(info);
+    if (ready > issue) {
+        stats.hilo_stalls += ready - issue;
+        issue = ready;
+    }
+    ready = units.fpReadyCycle(record.word, info);
+    if (ready > issue) {
+        stats.fp_stalls += ready - issue;
+        issue = ready;
+    }
+    if (HazardScoreboard::startsUnit(info)) {
+        units.issue(record.word, info, issue);
+    }
+
+    // The data cache is accessed in MEM; a miss holds the next instruction
+    if (record.flags & TraceWriter::TRACE_MEMORY) {
+        if (!data_cache.access(record.address, info.control.mem_write)) {
+            scoreboard.bubbles += miss_penalty;
+            stats.cache_stalls += miss_penalty;
+        }
+    }
+    scoreboard.load_dest = info.control.mem_read ? record.dest : 0;
+    return issue;
+}
+
+TraceReplayer::ReplayStats TraceReplayer::getStats() const {
+    return stats;
+}
+
+std::string TraceReplayer::getStatsString() const {
+    std::ostringstream oss;
+    oss << "Replay Statistics:\n";
+    oss << "Instructions: " << stats.instructions << ", Cycles: " << stats.cycles << "\n";
+    oss << "Load-Use Stalls: " << stats.load_use_stalls << "\n";
+    oss << "HI/LO Interlock Stalls: " << stats.hilo_stalls
+        << " (mult " << units.getMultiplyLatency() << ", div " << units.getDivideLatency() << " cycles, "
+        << (units.isMulDivPipelined() ? "pipelined" : "unpipelined") << ")\n";
+    oss << "FP Interlock Stalls: " << stats.fp_stalls << "\n";
+    oss << "Cache Miss Stalls: " << stats.cache_stalls << " (" << miss_penalty << " cycles per miss)\n";
+    oss << "Fetch Redirects: " << stats.redirects << "\n";
+    oss << "Mispredict Penalty: " << mispredict_penalty << " extra cycles\n";
+    oss << "Cycles Lost to Mispredictions: " << stats.redirect_cycles << "\n";
+    if (stats.instructions > 0) {
+        double cpi = (double)stats.cycles / stats.instructions;
+        oss << "CPI: " << std::fixed << std::setprecision(2) << cpi << "\n";
+    }
+
+    oss << "\n" << instruction_cache.getStatsString("Instruction Cache");
+    oss << data_cache.getStatsString("Data Cache");
+    if (branch_prediction_enabled) {
+        oss << "\n" << branch_predictor.getStatsString();
+        oss << "\n" << target_predictor.getStatsString();
+    }
+    return oss.str();
+}
@@ -0,0 +1,117 @@
+#include "trace_writer.hpp"
+#include <algorithm>
+
+constexpr char TraceWriter::MAGIC[8];
+
+TraceWriter::TraceWriter()
+    : active(0), cursor(nullptr), limit(nullptr), pending(false), pending_buffer(0), pending_size(0),
+      stopping(false), write_failed(false), bytes_written(0), records(0) {
+    buffers[0].resize(BUFFER_SIZE);
+    buffers[1].resize(BUFFER_SIZE);
+    resetEncoder();
+}
+
+TraceWriter::~TraceWriter() {
+    close();
+}
+
+void TraceWriter::resetEncoder() {
+    active = 0;
+    cursor = buffers[0].data();
+    limit = cursor + BUFFER_SIZE - MAX_RECORD_SIZE;
+    last_pc = 0u - 4; // A trace starting at address 0 begins sequentially
+    last_address = 0;
+    std::fill(last_value, last_value + 32, 0);
+    std::fill(word_pc, word_pc + WORD_TABLE_SIZE, 0xFFFFFFFF);
+    std::fill(word_value, word_value + WORD_TABLE_SIZE, 0);
+    records = 0;
+}
+
+bool TraceWriter::open(const std::string& filename) {
+    close();
+    file.open(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+    file.write(MAGIC, sizeof(MAGIC));
+
+    resetEncoder();
+    pending = false;
+    stopping = false;
+    write_failed = !file.good();
+    bytes_written = sizeof(MAGIC);
+    writer = std::thread(&TraceWriter::writerLoop, this);
+    return true;
+}
+
+bool TraceWriter::close() {
+    if (!writer.joinable()) {
+        return !write_failed;
+    }
+    if (cursor != buffers[active].data()) {
+        submit();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    ready.notify_all();
+    writer.join();
+
+    file.close();
+    if (file.fail()) {
+        write_failed = true;
+    }
+    return !write_failed;
+}
+
+bool TraceWriter::isOpen() const {
+    return writer.joinable();
+}
+
+// Hand the filled buffer to the writer thread and continue in the other
+// one, waiting only if the previous hand-off is still being written
+void TraceWriter::submit() {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [this] { return !pending; });
+        pending_buffer = active;
+        pending_size = cursor - buffers[active].data();
+        pending = true;
+    }
+    ready.notify_all();
+
+    active ^= 1;
+    cursor = buffers[active].data();
+    limit = cursor + BUFFER_SIZE - MAX_RECORD_SIZE;
+}
+
+void TraceWriter::writerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        ready.wait(lock, [this] { return pending || stopping; });
+        if (!pending) {
+            break;
+        }
+
+        const char* data = (const char*)buffers[pending_buffer].data();
+        size_t size = pending_size;
+        lock.unlock();
+        file.write(data, size);
+        bool ok = file.good();
+        lock.lock();
+
+        if (!ok) write_failed = true;
+        bytes_written += size;
+        pending = false;
+        ready.notify_all();
+    }
+}
+
+uint64_t TraceWriter::getRecordCount() const {
+    return records;
+}
+
+uint64_t TraceWriter::getByteCount() const {
+    return bytes_written;
+}
@@ -11,11 +11,11 @@ class MIPSSimulatorWrapper:
         self.simulator_path = "../build/mips_simulator"
         self.temp_dir = tempfile.mkdtemp()
     
-    def run_simulator(self, program, mode="step", pipeline=False, branch_prediction=False):
+    def run_simulator(self, program, mode="step", pipeline=False, branch_prediction=False, assembly=False):
         """Run the MIPS simulator with given parameters"""
         try:
             # Create temporary program file
-            program_file = os.path.join(self.temp_dir, "program.txt")
+            program_file = os.path.join(self.temp_dir, "program.s" if assembly else "program.txt")
             with open(program_file, 'w') as f:
                 f.write(program)
             
@@ -27,6 +27,8 @@ class MIPSSimulatorWrapper:
                 cmd.append("--pipeline")
             if branch_prediction:
                 cmd.append("--branch-prediction")
+            if assembly:
+                cmd.append("--asm")
             
             # Execute simulator
             result = subprocess.run(cmd, capture_output=True, text=True, timeout=30)
@@ -73,6 +75,7 @@ def simulate():
     mode = data.get('mode', 'step')
     pipeline = data.get('pipeline', False)
     branch_prediction = data.get('branch_prediction', False)
+    assembly = data.get('assembly', False)
     
     if not program:
         return jsonify({
@@ -80,7 +83,7 @@ def simulate():
             'error': 'No program provided'
         })
     
-    result = simulator.run_simulator(program, mode, pipeline, branch_prediction)
+    result = simulator.run_simulator(program, mode, pipeline, branch_prediction, assembly)
     return jsonify(result)
 
 @app.route('/api/examples')